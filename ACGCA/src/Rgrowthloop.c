@@ -1,7 +1,122 @@
 #include "head_files/misc_growth_funcs.h"
 #include "head_files/growthloop.h"
+#include "head_files/checkpoint.h"
+#include "head_files/flightrec.h"
+#include "head_files/growthfork.h"
+#include "head_files/encoding.h"
+#include "head_files/resultstore.h"
+#include "head_files/mcmc.h"
+#include "head_files/sensitivity.h"
+#include "head_files/simcache.h"
+#include "head_files/growthad.h"
+#include "head_files/explore.h"
+#include "head_files/surrogate.h"
+#include "head_files/gperf.h"
+#include "head_files/gprofile.h"
+#include "head_files/gtrace.h"
+#include <string.h>
 #include <R.h>
 
+// Copies the event log of a run to the array returned to R:
+//   [0-7]   steps in growth_st 0 to 6 and error codes
+//   [8]     OR of errorind, [9] number of events, [10] occurrences lost
+//   [11-13] first step with an event, its errorind and growth_st
+//   [14 + 5*k] kind, code, count, first and last step of event k
+static void rgrowthloop_events(geventlog *ev, int *events, double *evsnap)
+{
+	int k;
+
+	for(k = 0; k < EV_NSTATE; k++){
+		events[k] = ev->nstate[k];
+	}
+	events[8] = ev->mask;
+	events[9] = ev->nevent;
+	events[10] = ev->lost;
+	events[11] = ev->first;
+	events[12] = ev->firsterr;
+	events[13] = ev->firstst;
+	for(k = 0; k < ev->nevent; k++){
+		events[14 + 5*k] = ev->event[k].kind;
+		events[15 + 5*k] = ev->event[k].code;
+		events[16 + 5*k] = ev->event[k].count;
+		events[17 + 5*k] = ev->event[k].first;
+		events[18 + 5*k] = ev->event[k].last;
+	}
+	for(k = 0; k < GF_NDOUBLE; k++){
+		evsnap[k] = ev->snap[k];
+	}
+}
+
+// Counts before a run, see rgrowthloop_perf().
+typedef struct{
+	unsigned long long hw[GPERF_N];
+	double calls[GP_NBRANCH], ticks[GP_NBRANCH], trans[GP_NSTATE*GP_NSTATE];
+	double bhw[GP_NBRANCH*GPERF_N];
+	int avail;
+} rperfmark;
+
+// With perf NULL starts the hardware counters of this thread and saves the
+// counts in m.  Otherwise stops them and returns the counts since m to perf:
+//   [0 to GPERF_N-1]  instructions, cycles, ... of the run (gperf_names)
+//   [GPERF_N]         counters available (bit k for counter k)
+//   [GPERF_N+1]       1 if the branches are profiled (ACGCA_PROFILE)
+//   [GPERF_N+2]       steps simulated (t)
+//   [GPERF_N+3 + b*(GPERF_N+1)]  calls of branch b (gprof_names) followed
+//                     by its counts
+static void rgrowthloop_perf(rperfmark *m, double *perf, int t)
+{
+	unsigned long long hw[GPERF_N];
+	double calls[GP_NBRANCH], ticks[GP_NBRANCH], trans[GP_NSTATE*GP_NSTATE];
+	double bhw[GP_NBRANCH*GPERF_N];
+	double *b;
+	int k, j;
+
+	if(perf == NULL){
+		m->avail = gprof_hwstart();
+		gprof_read(m->calls, m->ticks, m->trans);
+		gprof_readhw(m->bhw);
+		gprof_hwnow(m->hw);
+		return;
+	}
+	gprof_hwnow(hw);
+	gprof_read(calls, ticks, trans);
+	perf[GPERF_N + 1] = gprof_readhw(bhw);
+	gprof_hwstop();
+
+	for(k = 0; k < GPERF_N; k++){
+		perf[k] = (double) (hw[k] - m->hw[k]);
+	}
+	perf[GPERF_N] = m->avail;
+	perf[GPERF_N + 2] = t;
+	for(j = 0; j < GP_NBRANCH; j++){
+		b = perf + GPERF_N + 3 + j*(GPERF_N + 1);
+		b[0] = calls[j] - m->calls[j];
+		for(k = 0; k < GPERF_N; k++){
+			b[1 + k] = bhw[j*GPERF_N + k] - m->bhw[j*GPERF_N + k];
+		}
+	}
+}
+
+// Appends the outputs of a run to the result store file ("" for none).
+static void rgrowthloop_store(char *file, int *ctrl, double *gp2, int lenvars,
+	int t, goutput *out)
+{
+	rstore rs;
+	int err;
+
+	if(file[0] == '\0'){
+		return;
+	}
+	err = rstore_open(&rs, file, lenvars, out, ctrl[1], gp2[4]);
+	if(err == 0){
+		err = rstore_append(&rs, ctrl[0], t + 1, out);
+		rstore_close(&rs);
+	}
+	if(err != 0){
+		error("Rgrowthloop: could not append to result store %s (code %i)", file, err);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////
 // This code is to create a call to the growthloop from R
 // I am hoping to avoid the structure that is causing problems.
@@ -68,7 +183,20 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	double *sparms2, //60
 	int *startIndex,
 	int *stopIndex,
-	int *parameterLength
+	int *parameterLength,
+	char **files, // [0] checkpoint to restart from, [1] file to save the final state to,
+	              // [2] result store to append the run to, [3] replay file
+	              // written if the run fails ("" for none)
+	int *ctrl, // [0] run id used in the result store, [1] encoding of the result
+	          // store (ENC_*, gp2[4] holds the error bound of ENC_QUANT),
+	          // [2] 1 to use the result cache (see simcache.c), [3] 1 to return
+	          // errorind and growth_st at each step, 0 if they have length 1,
+	          // [4] steps kept by the flight recorder (0 for none), returns
+	          // [5] the failing step written to files[3], -1 if none, [6] 1 to
+	          // count hardware events into perf
+	int *events, // event log (see rgrowthloop_events())
+	double *evsnap, // outputs (gfield) after the first step with an event
+	double *perf // hardware counts of the run (see rgrowthloop_perf())
 
 	// double *hmax, //60
 	// double *phih,
@@ -116,18 +244,67 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
   //double *odemandout,
   //double *odrout)
 {
-	// Rprintf("start function. \n");
-
-	// Rprintf("sparms2 values: \n");
-	// for(int i = 0; i < 36; i++){
-	// 	Rprintf("%g\n", sparms2[i]);
-	// }
 	///////////////////////////////////////////////////////////////////////////
 	// Declare two structs and use them to store the simulation parameters
 	// and the simulation control variables.
 	///////////////////////////////////////////////////////////////////////////
 	sparms p;
   	gparms gp;
+	geventlog ev;
+
+	// Without the per step arrays errorind and growth_st are kept in scratch
+	// arrays, the cache, the result store and the event log need them.
+	if(ctrl[3] == 0){
+		errorind = (int *) R_alloc(*lenvars, sizeof(int));
+		growth_st = (int *) R_alloc(*lenvars, sizeof(int));
+		memset(errorind, 0, *lenvars*sizeof(int));
+		memset(growth_st, 0, *lenvars*sizeof(int));
+	}
+	goutput out = {
+		{APARout, h, hh, hC, hB, hBH, r, rB, rC, rBH, sw, vts, vt, vth, sa,
+		la, ra, dr, xa, bl, br, bt, bts, bth, boh, bos, bo, bs, cs, clr, fl,
+		fr, ft, fo, rfl, rfr, rfs, egrow, ex, rtrans, light, nut, deltas, LAI},
+		{status, errorind, growth_st}
+	};
+
+	// The flight recorder keeps the inputs of the last ctrl[4] steps.
+	gflightrec rec;
+	ctrl[5] = -1;
+	if(ctrl[4] > 0){
+		growthloop_recinit(&rec, (gframe *) R_alloc(ctrl[4], sizeof(gframe)), ctrl[4]);
+	}
+
+	// Identical runs are answered from the result cache.  Runs that restart
+	// from or save a checkpoint or are recorded are always simulated.
+	simkey key;
+	int usecache = ctrl[2] != 0 && files[0][0] == '\0' && files[1][0] == '\0' &&
+		ctrl[4] <= 0 && ctrl[6] == 0;
+	if(usecache){
+		key = simcache_key(gp2, r0, *lenvars, Io, Hc, LAIF, kF, intF, slopeF,
+			sparms2, startIndex, parameterLength);
+		if(simcache_get(&key, *lenvars, &out, t) >= 0){
+			rgrowthloop_store(files[2], ctrl, gp2, *lenvars, *t, &out);
+			growthloop_eventscan(&out, *t, &ev);
+			rgrowthloop_events(&ev, events, evsnap);
+			GTRACE(GT_run, 1, *t, 0, 0);
+			return;
+		}
+	}
+
+	// Restart from a saved checkpoint if one was given.  The species
+	// parameters given from R replace the ones in the checkpoint.
+	gcheckpoint ckin, ckout;
+	int ckerr;
+	if(files[0][0] != '\0'){
+		ckerr = checkpoint_read(files[0], &ckin);
+		if(ckerr != 0){
+			error("Rgrowthloop: could not read checkpoint file %s (code %i)", files[0], ckerr);
+		}
+		if(fabs(ckin.deltat - gp2[0]) > 1e-12){
+			error("Rgrowthloop: checkpoint %s was simulated with steps=%g but this run uses steps=%g",
+				files[0], 1/ckin.deltat, 1/gp2[0]);
+		}
+	}
 
 	// // NOTE: all indicies -1 because C starts at 0 while R starts at 1
 	// // Define p(plant) parameters based on R array
@@ -207,9 +384,6 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 
 	double *sla;
 	sla = malloc(parameterLength[17]*sizeof(double));
-	// Rprintf("sla length: %i\n", parameterLength[17]);
-	// Rprintf("sizeof double %i\n", sizeof(double));
-	// Rprintf("sizeof sla %i\n", sizeof(sla));
 
 	double *sr;
 	sr = malloc(parameterLength[18]*sizeof(double));
@@ -248,16 +422,9 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	double *drcrit;
 	drcrit = malloc(parameterLength[35]*sizeof(double));
 
-	// for(int i=0; i < 36; i++){
-	// 	Rprintf("value of index: %i value of parameterLength: %i\n", i, parameterLength[i]);
-	// }
-
 	for(int i=0; i < parameterLength[0]; i++){
-		//Rprintf("i: %i\n", i);
 		int index = startIndex[0] + i;
-		//Rprintf("index: %i\n", index);
 		hmax[i] = sparms2[index];
-		//Rprintf("sparms2[index]: %g\n", sparms2[index]);
 	}
 	for(int i=0; i < parameterLength[1]; i++){
 		int index = startIndex[1] + i;
@@ -326,13 +493,8 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	for(int i=0; i < parameterLength[17]; i++){
 		int index = startIndex[17] + i;
 		sla[i] = sparms2[index];
-		// Rprintf("SLA value %i: %g\n", i, sla[i]);	
 	}
 
-	// Rprintf("sla length: %i\n", parameterLength[17]);
-	// Rprintf("sizeof double %i\n", sizeof(double));
-	// Rprintf("sizeof sla %i\n", sizeof(sla));
-
 	for(int i=0; i < parameterLength[18]; i++){
 		int index = startIndex[18] + i;
 		sr[i] = sparms2[index];
@@ -400,12 +562,10 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	for(int i=0; i < parameterLength[34]; i++){
 		int index = startIndex[34] + i;
 		drinit[i] = sparms2[index];
-		// Rprintf("drinit value %i: %g\n", i, drinit[i]);	
 	}
 	for(int i=0; i < parameterLength[35]; i++){
 		int index = startIndex[35] + i;
 		drcrit[i] = sparms2[index];
-		// Rprintf("drcrit value %i: %g\n", i, drcrit[i]);	
 	}
 
 	// NOTE: all indicies -1 because C starts at 0 while R starts at 1
@@ -477,6 +637,12 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	address of something carrying an address.  At least that is how I think
 	this is working (MKF 7/21/2014).
 	*/
+	// Hardware counts of the run and of its branches (ACGCA_PROFILE).
+	rperfmark pm;
+	if(ctrl[6] != 0){
+		rgrowthloop_perf(&pm, NULL, 0);
+	}
+
   // Hc and LAIF were added on 3/16/2018 by MKF to allow gap dynamics
   // simulations.
 	growthloop(&p,&gp, Io, r0, t,
@@ -568,7 +734,10 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 		R0,
 		R40,
 
-		parameterLength
+		parameterLength,
+		(files[0][0] != '\0') ? &ckin : NULL,
+		&ckout,
+		(ctrl[4] > 0) ? &rec : NULL
 	//tolout,
 	//errorout,
     //drout,
@@ -576,6 +745,9 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
     //odemandout,
     //odrout
 	);
+	if(ctrl[6] != 0){
+		rgrowthloop_perf(&pm, perf, *t);
+	}
 
 	// Make sure memory is freed before returning to R
 	free(hmax);
@@ -614,6 +786,32 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 	free(gammaw);
 	free(drinit);
 	free(drcrit);
+
+	// Append the run to the result store.
+	if(usecache){
+		simcache_put(&key, *lenvars, *t, &out);
+	}
+	rgrowthloop_store(files[2], ctrl, gp2, *lenvars, *t, &out);
+	growthloop_eventscan(&out, *t, &ev);
+	rgrowthloop_events(&ev, events, evsnap);
+	GTRACE(GT_run, 0, *t, 0, 0);
+
+	// Write the steps up to the failure so they can be replayed (Rreplay).
+	if(ctrl[4] > 0 && rec.fail >= 0 && files[3][0] != '\0'){
+		ckerr = flightrec_write(files[3], &gp, &ForParms, &rec);
+		if(ckerr != 0){
+			error("Rgrowthloop: could not write replay file %s (code %i)", files[3], ckerr);
+		}
+		ctrl[5] = rec.fail;
+	}
+
+	// Save the final state so the run can be continued later.
+	if(files[1][0] != '\0'){
+		ckerr = checkpoint_write(files[1], &ckout);
+		if(ckerr != 0){
+			error("Rgrowthloop: could not write checkpoint file %s (code %i)", files[1], ckerr);
+		}
+	}
 } // End of Rgrowthloop
 
 
@@ -621,3 +819,787 @@ void Rgrowthloop(double *gp2, double *Io, double *r0, int *t,
 
 
 
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// Run several futures from one saved tree (see forkacgca() in R).  All inputs
+// and outputs are stacked by branch.  Branch b uses
+//   Io, Hc, LAIF   [b*lenvars + j]
+//   sparms2        packed as in Rgrowthloop, startIndex and parameterLength
+//                  [b*36 + k] with startIndex absolute into sparms2
+//   out            [(b*nfields + f)*lenvars + j] for the gfield indices in fields
+//   iout           [(b*3 + k)*lenvars + j] for status, errorind, growth_st
+//   t              [b] steps taken
+// If storefile is not "" each branch is appended to that result store with
+// run id *runid + b, encoded with *storeenc (ENC_*) and error bound gp2[4].
+//////////////////////////////////////////////////////////////////////////////////
+void Rgrowthfork(double *gp2, char **ckfile, int *nbranch, int *lenvars,
+	double *Io, double *Hc, double *LAIF, double *kF, double *intF,
+	double *slopeF, double *sparms2, int *startIndex, int *parameterLength,
+	int *nfields, int *fields, double *out, int *iout, int *t, int *nthreads,
+	char **storefile, int *runid, int *storeenc)
+{
+	gparms gp;
+	gcheckpoint ck;
+	Forestparms ForParms;
+	int ckerr, b, k, nb = *nbranch, n = *lenvars;
+
+	gp.deltat=gp2[0];
+	gp.T=gp2[1];
+	gp.tolerance=gp2[2];
+	gp.BH=gp2[3];
+
+	ForParms.kF = *kF;
+	ForParms.intF = *intF;
+	ForParms.slopeF = *slopeF;
+
+	for(k=0; k < *nfields; k++){
+		if(fields[k] < 0 || fields[k] >= GF_NDOUBLE){
+			error("Rgrowthfork: output field %i does not exist", fields[k]);
+		}
+	}
+
+	ckerr = checkpoint_read(ckfile[0], &ck);
+	if(ckerr != 0){
+		error("Rgrowthfork: could not read checkpoint file %s (code %i)", ckfile[0], ckerr);
+	}
+	if(fabs(ck.deltat - gp.deltat) > 1e-12){
+		error("Rgrowthfork: checkpoint %s was simulated with steps=%g but this run uses steps=%g",
+			ckfile[0], 1/ck.deltat, 1/gp.deltat);
+	}
+
+	sparms *p = (sparms *) R_alloc(nb, sizeof(sparms));
+	pschedule *ps = (pschedule *) R_alloc(nb, sizeof(pschedule));
+	gforcing *forc = (gforcing *) R_alloc(nb, sizeof(gforcing));
+	goutput *gout = (goutput *) R_alloc(nb, sizeof(goutput));
+
+	for(b=0; b < nb; b++){
+		growthloop_unpack(sparms2, startIndex + b*NSPARMS,
+			parameterLength + b*NSPARMS, &p[b], &ps[b]);
+
+		forc[b].Io = Io + b*n;
+		forc[b].Hc = Hc + b*n;
+		forc[b].LAIF = LAIF + b*n;
+		forc[b].ForParms = &ForParms;
+		forc[b].drref = NULL;
+
+		for(k=0; k < GF_NDOUBLE; k++){
+			gout[b].v[k] = NULL;
+			gout[b].f[k] = NULL;
+		}
+		for(k=0; k < *nfields; k++){
+			gout[b].v[fields[k]] = out + (b * *nfields + k)*n;
+		}
+		for(k=0; k < GI_NINT; k++){
+			gout[b].iv[k] = iout + (b*GI_NINT + k)*n;
+		}
+		gout[b].ev = NULL;
+		gout[b].fr = NULL;
+	}
+
+	rstore rs;
+	if(storefile[0][0] != '\0'){
+		ckerr = rstore_open(&rs, storefile[0], n, &gout[0], *storeenc, gp2[4]);
+		if(ckerr != 0){
+			error("Rgrowthfork: could not open result store %s (code %i)", storefile[0], ckerr);
+		}
+	}
+
+	ckerr = growthloop_fork(&gp, &ck, nb, p, ps, forc, gout,
+		(int) ceil(gp.T/gp.deltat), t, *nthreads,
+		(storefile[0][0] != '\0') ? &rs : NULL, *runid);
+
+	if(storefile[0][0] != '\0'){
+		rstore_close(&rs);
+	}
+	if(ckerr != 0){
+		error("Rgrowthfork: could not append to result store %s", storefile[0]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Describe a result store (see readstore() in R).
+//   info  [0] lenvars, [1] number of double fields, [2] number of integer
+//         fields, followed by the gfield indices of the double fields and
+//         the gifield indices of the integer fields
+//   nrec  number of runs in the store
+//////////////////////////////////////////////////////////////////////////////////
+void Rstore_info(char **file, int *info, double *nrec)
+{
+	rstore rs;
+	int k, err;
+
+	err = rstore_openread(&rs, file[0]);
+	if(err != 0){
+		error("Rstore_info: could not open result store %s (code %i)", file[0], err);
+	}
+	info[0] = rs.lenvars;
+	info[1] = rs.nd;
+	info[2] = rs.ni;
+	for(k=0; k < rs.nd; k++){
+		info[3 + k] = rs.did[k];
+	}
+	for(k=0; k < rs.ni; k++){
+		info[3 + rs.nd + k] = rs.iid[k];
+	}
+	*nrec = (double) rs.nrec;
+	rstore_close(&rs);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Read columns of the runs recs (0 based record numbers) from a result
+// store.  dfields and ifields index the double and integer fields of the
+// store.  Outputs are stacked by run:
+//   runid, nstored  [r]
+//   out             [(r*ndf + f)*lenvars + j]
+//   iout            [(r*nif + f)*lenvars + j]
+//////////////////////////////////////////////////////////////////////////////////
+void Rstore_read(char **file, int *nrun, double *recs, int *ndf, int *dfields,
+	int *nif, int *ifields, double *runid, int *nstored, double *out, int *iout)
+{
+	rstore rs;
+	int r, k, err;
+
+	err = rstore_openread(&rs, file[0]);
+	if(err != 0){
+		error("Rstore_read: could not open result store %s (code %i)", file[0], err);
+	}
+	for(r=0; r < *nrun && err == 0; r++){
+		long long rec = (long long) recs[r];
+		runid[r] = (double) rstore_runid(&rs, rec);
+		nstored[r] = rstore_nstored(&rs, rec);
+		err = (nstored[r] < 0);
+		for(k=0; k < *ndf && err == 0; k++){
+			err = rstore_column(&rs, rec, dfields[k],
+				out + ((long long) r * *ndf + k)*rs.lenvars);
+		}
+		for(k=0; k < *nif && err == 0; k++){
+			err = rstore_icolumn(&rs, rec, ifields[k],
+				iout + ((long long) r * *nif + k)*rs.lenvars);
+		}
+	}
+	rstore_close(&rs);
+	if(err != 0){
+		error("Rstore_read: could not read run %i from result store %s", r, file[0]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Adaptive Metropolis sampler with several chains and parallel tempering
+// (see mcmcacgca() in R).
+//   gp2, Io, ..., parameterLength   the model set up as in Rgrowthloop
+//   park, ptype, pa, pb             sparms index and prior (MP_*) of each of
+//                                   the npar free parameters
+//   theta0, scale                   starting values [c*npar + k] of chain c
+//                                   and initial proposal sd
+//   ostep, ofield, olag, omult,     the nobs observations (see mobs in
+//   oy, osd                         mcmc.h)
+//   ctrl                            [0] iterations, [1] thinning interval,
+//                                   [2] iterations before adaptation, [3] seed,
+//                                   [4] chains, [5] temperatures, [6]
+//                                   iterations between swaps, [7] threads,
+//                                   [8] burn-in iterations, [9] 1 to warm
+//                                   start the radius solvers
+//   temps                           temperature ladder, temps[0] = 1
+//   stopcrit                        stop once all R-hat < stopcrit[0] and
+//                                   all ESS > stopcrit[1] (0 never stops)
+//   file                            "" or a csv file the draws are written to
+//   draws, logpost                  kept draws [(c*npar + k)*ndraw + i],
+//                                   ndraw = (iterations - burn-in)/thin
+//   accept                          acceptance rate of each chain
+//   swaprate                        acceptance rate of the replica swaps
+//   rhat, ess                       convergence diagnostics per parameter
+//   coarse                          [0] steps per year of the screening
+//                                   simulations (0 none), [1] their tolerance
+//   niter                           iterations run, draws kept per chain,
+//                                   mean time steps simulated per iteration,
+//                                   the same for the screening simulations,
+//                                   the fraction of proposals passing the screen
+//                                   and the mean radius solver evaluations per
+//                                   simulated step
+//////////////////////////////////////////////////////////////////////////////////
+void Rmcmc(double *gp2, int *lenvars, double *Io, double *Hc, double *LAIF,
+	double *kF, double *intF, double *slopeF, double *r0, double *sparms2,
+	int *startIndex, int *parameterLength, int *npar, int *park, int *ptype,
+	double *pa, double *pb, double *theta0, double *scale, int *nobs,
+	int *ostep, int *ofield, int *olag, double *omult, double *oy, double *osd,
+	int *ctrl, double *temps, double *stopcrit, char **file, double *draws,
+	double *logpost, double *accept, double *swaprate, double *rhat,
+	double *ess, double *coarse, double *niter)
+{
+	mtarget tg, tc;
+	mcmcopts o;
+	mcmcres res;
+	pschedule ps;
+	Forestparms ForParms;
+	int k, err, fct;
+
+	if(*npar < 1 || *npar > MCMC_MAXPAR){
+		error("Rmcmc: between 1 and %i free parameters are needed", MCMC_MAXPAR);
+	}
+
+	tg.gp.deltat=gp2[0];
+	tg.gp.T=gp2[1];
+	tg.gp.tolerance=gp2[2];
+	tg.gp.BH=gp2[3];
+
+	ForParms.kF = *kF;
+	ForParms.intF = *intF;
+	ForParms.slopeF = *slopeF;
+	tg.f.Io = Io;
+	tg.f.Hc = Hc;
+	tg.f.LAIF = LAIF;
+	tg.f.ForParms = &ForParms;
+	tg.f.drref = NULL;
+
+	growthloop_unpack(sparms2, startIndex, parameterLength, &tg.p, &ps);
+	tg.ps = &ps;
+	tg.r0 = *r0;
+
+	tg.npar = *npar;
+	for(k=0; k < tg.npar; k++){
+		if(park[k] < 0 || park[k] >= NSPARMS || parameterLength[park[k]] != 1){
+			error("Rmcmc: free parameter %i has to be a constant species parameter", k + 1);
+		}
+		tg.park[k] = park[k];
+		tg.prior[k].type = ptype[k];
+		tg.prior[k].a = pa[k];
+		tg.prior[k].b = pb[k];
+	}
+
+	tg.nobs = *nobs;
+	tg.obs = (mobs *) R_alloc(tg.nobs, sizeof(mobs));
+	for(k=0; k < tg.nobs; k++){
+		if(ofield[k] < 0 || ofield[k] >= GF_NDOUBLE || osd[k] <= 0){
+			error("Rmcmc: observation %i has an unknown field or sd <= 0", k + 1);
+		}
+		tg.obs[k].step = ostep[k];
+		tg.obs[k].field = ofield[k];
+		tg.obs[k].lag = olag[k];
+		tg.obs[k].mult = omult[k];
+		tg.obs[k].y = oy[k];
+		tg.obs[k].sd = osd[k];
+	}
+	if(mcmc_obs_sort(&tg) != 0 || tg.nsteps > *lenvars - 1){
+		error("Rmcmc: observations have to be within the simulated years");
+	}
+
+	// The screening target simulates every fct-th step of the full one
+	tg.warm = ctrl[9];
+	tg.coarse = NULL;
+	if(coarse[0] > 0){
+		fct = (int) round(1.0/(tg.gp.deltat*coarse[0]));
+		if(fct < 1 || fabs(fct*coarse[0]*tg.gp.deltat - 1.0) > 1e-9){
+			error("Rmcmc: the steps per year have to be a multiple of the coarse steps");
+		}
+		for(k=0; k < NSPARMS; k++){
+			if(parameterLength[k] != 1){
+				error("Rmcmc: coarse screening needs constant species parameters");
+			}
+		}
+		tc = tg;
+		tc.gp.deltat = tg.gp.deltat*fct;
+		tc.gp.tolerance = coarse[1];
+		tc.f.Io = (double *) R_alloc(*lenvars/fct + 1, sizeof(double));
+		tc.f.Hc = (double *) R_alloc(*lenvars/fct + 1, sizeof(double));
+		tc.f.LAIF = (double *) R_alloc(*lenvars/fct + 1, sizeof(double));
+		for(k=0; k*fct < *lenvars; k++){
+			tc.f.Io[k] = Io[k*fct];
+			tc.f.Hc[k] = Hc[k*fct];
+			tc.f.LAIF[k] = LAIF[k*fct];
+		}
+		tc.obs = (mobs *) R_alloc(tg.nobs, sizeof(mobs));
+		for(k=0; k < tg.nobs; k++){
+			if(tg.obs[k].step % fct != 0 || tg.obs[k].lag % fct != 0){
+				error("Rmcmc: observation %i is not at a coarse step", k + 1);
+			}
+			tc.obs[k] = tg.obs[k];
+			tc.obs[k].step /= fct;
+			tc.obs[k].lag /= fct;
+		}
+		mcmc_obs_sort(&tc);
+		tg.coarse = &tc;
+	}
+
+	o.niter = ctrl[0];
+	o.thin = ctrl[1];
+	o.adaptstart = ctrl[2];
+	o.seed = (uint64_t) ctrl[3];
+	o.nchain = ctrl[4];
+	o.ntemp = ctrl[5];
+	o.swapevery = ctrl[6];
+	o.nthreads = ctrl[7];
+	o.burnin = ctrl[8];
+	o.temps = temps;
+	o.stoprhat = stopcrit[0];
+	o.stopess = stopcrit[1];
+	if(o.nchain < 1 || o.ntemp < 1 || o.thin < 1 || o.swapevery < 1 ||
+		temps[0] != 1){
+		error("Rmcmc: invalid chains, temperatures, thin or swap interval");
+	}
+
+	res.draws = draws;
+	res.lp = logpost;
+	res.ndraw = (o.niter - o.burnin)/o.thin;
+	res.accept = accept;
+	res.rhat = rhat;
+	res.ess = ess;
+	res.fp = NULL;
+	if(file[0][0] != '\0'){
+		res.fp = fopen(file[0], "w");
+		if(res.fp == NULL){
+			error("Rmcmc: could not open %s", file[0]);
+		}
+		mcmc_write_header(res.fp, &tg);
+	}
+
+	err = mcmc_sample(&tg, theta0, scale, &o, &res);
+	if(res.fp != NULL){
+		fclose(res.fp);
+	}
+	if(err == 1){
+		error("Rmcmc: could not allocate memory");
+	}else if(err == 2){
+		error("Rmcmc: the (coarse) posterior density is 0 at the starting values");
+	}
+	*swaprate = res.swaprate;
+	niter[0] = (double) res.iter;
+	niter[1] = (double) res.kept;
+	niter[2] = res.steps;
+	niter[3] = res.csteps;
+	niter[4] = res.screen;
+	niter[5] = res.solveiter;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Global sensitivity analysis (see sensacgca() in R).
+//   gp2, Io, ..., parameterLength   the model set up as in Rgrowthloop
+//   park, lo, hi                    sparms index and range of each of the npar
+//                                   varied parameters
+//   ofield, omult                   the nout outputs (gfield, SA_DEATH or
+//                                   SA_BIOMASS) and their multipliers
+//   ctrl                            [0] method (0 Sobol, 1 Morris), [1] rows
+//                                   or trajectories, [2] Morris levels,
+//                                   [3] seed, [4] threads
+//   idx                             indices [(j*nout + o)*npar + k]: S1, ST
+//                                   and their standard errors for Sobol, mu,
+//                                   mu* and sigma for Morris
+//   mean, var                       mean and variance of each output (Sobol)
+//   nused                           rows or trajectories used and skipped
+//////////////////////////////////////////////////////////////////////////////////
+void Rsens(double *gp2, int *lenvars, double *Io, double *Hc, double *LAIF,
+	double *kF, double *intF, double *slopeF, double *r0, double *sparms2,
+	int *startIndex, int *parameterLength, int *npar, int *park, double *lo,
+	double *hi, int *nout, int *ofield, double *omult, int *ctrl, double *idx,
+	double *mean, double *var, double *nused)
+{
+	satarget t;
+	pschedule ps;
+	Forestparms ForParms;
+	int k, err, m = *nout * *npar;
+
+	if(*npar < 1 || *npar > NSPARMS || *nout < 1 || *nout > SA_MAXOUT){
+		error("Rsens: between 1 and %i parameters and 1 and %i outputs are needed",
+			NSPARMS, SA_MAXOUT);
+	}
+
+	t.gp.deltat=gp2[0];
+	t.gp.T=gp2[1];
+	t.gp.tolerance=gp2[2];
+	t.gp.BH=gp2[3];
+	t.nsteps = *lenvars - 1;
+
+	ForParms.kF = *kF;
+	ForParms.intF = *intF;
+	ForParms.slopeF = *slopeF;
+	t.f.Io = Io;
+	t.f.Hc = Hc;
+	t.f.LAIF = LAIF;
+	t.f.ForParms = &ForParms;
+	t.f.drref = NULL;
+
+	growthloop_unpack(sparms2, startIndex, parameterLength, &t.p, &ps);
+	t.ps = &ps;
+	t.r0 = *r0;
+
+	t.npar = *npar;
+	for(k=0; k < t.npar; k++){
+		if(park[k] < 0 || park[k] >= NSPARMS || parameterLength[park[k]] != 1){
+			error("Rsens: parameter %i has to be a constant species parameter", k + 1);
+		}
+		t.park[k] = park[k];
+		t.lo[k] = lo[k];
+		t.hi[k] = hi[k];
+	}
+	t.nout = *nout;
+	for(k=0; k < t.nout; k++){
+		if(ofield[k] < SA_BIOMASS || ofield[k] >= GF_NDOUBLE){
+			error("Rsens: output %i does not exist", k + 1);
+		}
+		t.out[k] = ofield[k];
+		t.mult[k] = omult[k];
+	}
+
+	if(ctrl[0] == 0){
+		sasobol r;
+		r.mean = mean;
+		r.var = var;
+		r.S1 = idx;
+		r.ST = idx + m;
+		r.S1se = idx + 2*m;
+		r.STse = idx + 3*m;
+		err = sa_sobol(&t, ctrl[1], (uint64_t) ctrl[3], ctrl[4], &r);
+		nused[0] = (double) r.n;
+		nused[1] = (double) r.nskip;
+	}else{
+		samorris r;
+		r.mu = idx;
+		r.mustar = idx + m;
+		r.sigma = idx + 2*m;
+		err = sa_morris(&t, ctrl[1], ctrl[2], (uint64_t) ctrl[3], ctrl[4], &r);
+		nused[0] = (double) r.n;
+		nused[1] = (double) r.nskip;
+	}
+	if(err == 1){
+		error("Rsens: could not allocate memory");
+	}else if(err == 2){
+		error("Rsens: the number of levels has to be even");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Outputs of a run and their derivatives with respect to species parameters
+// by forward mode automatic differentiation (see gradacgca() in R).
+//   gp2, Io, ..., parameterLength   the model set up as in Rgrowthloop
+//   park                            sparms index of each of the npar
+//                                   constant parameters
+//   fields                          the nfield outputs (gfield)
+//   value                           value[f*lenvars + j] of field f at step j
+//   grad                            derivatives [(f*npar + k)*lenvars + j]
+//   t                               the last step simulated
+//////////////////////////////////////////////////////////////////////////////////
+void Rgrad(double *gp2, int *lenvars, double *Io, double *Hc, double *LAIF,
+	double *kF, double *intF, double *slopeF, double *r0, double *sparms2,
+	int *startIndex, int *parameterLength, int *npar, int *park, int *nfield,
+	int *fields, double *value, double *grad, int *t)
+{
+	double forparms[3] = {*kF, *intF, *slopeF};
+	int k;
+
+	for(k=0; k < *npar; k++){
+		if(park[k] < 0 || park[k] >= NSPARMS || parameterLength[park[k]] != 1){
+			error("Rgrad: parameter %i has to be a constant species parameter", k + 1);
+		}
+	}
+	for(k=0; k < *nfield; k++){
+		if(fields[k] < 0 || fields[k] >= GF_NDOUBLE){
+			error("Rgrad: output %i does not exist", k + 1);
+		}
+	}
+
+	*t = growthad_run(gp2, r0, *lenvars - 1, Io, Hc, LAIF, forparms, sparms2,
+		startIndex, parameterLength, *npar, park, *nfield, fields, value, grad);
+	if(*t < 0){
+		error("Rgrad: could not allocate memory");
+	}
+}
+
+// Fills the model set up and the varied parameters of an extarget, shared by
+// Rexplore and the emulator.  ForParms and ps are pointed to by t.
+static void rexplore_target(extarget *t, pschedule *ps, Forestparms *ForParms,
+	double *gp2, int *lenvars, double *Io, double *Hc, double *LAIF, double *kF,
+	double *intF, double *slopeF, double *r0, double *sparms2, int *startIndex,
+	int *parameterLength, int *npar, int *park, double *lo, double *hi,
+	int *scale, const char *caller)
+{
+	int k;
+
+	if(*npar < 1 || *npar > NSPARMS){
+		error("%s: between 1 and %i parameters are needed", caller, NSPARMS);
+	}
+
+	t->gp.deltat=gp2[0];
+	t->gp.T=gp2[1];
+	t->gp.tolerance=gp2[2];
+	t->gp.BH=gp2[3];
+	t->nsteps = *lenvars - 1;
+
+	ForParms->kF = *kF;
+	ForParms->intF = *intF;
+	ForParms->slopeF = *slopeF;
+	t->f.Io = Io;
+	t->f.Hc = Hc;
+	t->f.LAIF = LAIF;
+	t->f.ForParms = ForParms;
+	t->f.drref = NULL;
+
+	growthloop_unpack(sparms2, startIndex, parameterLength, &t->p, ps);
+	t->ps = ps;
+	t->r0 = *r0;
+
+	t->npar = *npar;
+	for(k=0; k < t->npar; k++){
+		if(park[k] < 0 || park[k] >= NSPARMS || parameterLength[park[k]] != 1){
+			error("%s: parameter %i has to be a constant species parameter", caller, k + 1);
+		}
+		t->park[k] = park[k];
+		t->lo[k] = lo[k];
+		t->hi[k] = hi[k];
+		t->scale[k] = scale[k];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Trait space exploration (see exploreacgca() in R).
+//   gp2, Io, ..., parameterLength   the model set up as in Rgrowthloop
+//   park, lo, hi, scale             the npar varied parameters, their ranges
+//                                   and scales (EX_LINEAR, EX_LOG, EX_LOGIT)
+//   range                           n (points in the design), from and to
+//                                   (points from, ..., to - 1 are run)
+//   ctrl                            design (EX_SOBOL, EX_LHS), seed, threads
+//   file                            the table the summaries are written to
+//////////////////////////////////////////////////////////////////////////////////
+void Rexplore(double *gp2, int *lenvars, double *Io, double *Hc, double *LAIF,
+	double *kF, double *intF, double *slopeF, double *r0, double *sparms2,
+	int *startIndex, int *parameterLength, int *npar, int *park, double *lo,
+	double *hi, int *scale, double *range, int *ctrl, char **file)
+{
+	extarget t;
+	pschedule ps;
+	Forestparms ForParms;
+	int err;
+
+	rexplore_target(&t, &ps, &ForParms, gp2, lenvars, Io, Hc, LAIF, kF, intF,
+		slopeF, r0, sparms2, startIndex, parameterLength, npar, park, lo, hi, scale,
+		"Rexplore");
+
+	err = ex_run(&t, file[0], ctrl[0], (long long) range[0],
+		(long long) range[1], (long long) range[2], (uint64_t) ctrl[1], ctrl[2]);
+	if(err == 1){
+		error("Rexplore: could not allocate memory");
+	}else if(err == 2){
+		error("Rexplore: could not write %s", file[0]);
+	}else if(err == 3){
+		error("Rexplore: invalid design, points or ranges");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Trains the emulator of yearly DBH and survival (see emulateacgca() in R).
+//   gp2, ..., scale   the model set up and varied parameters as in Rexplore
+//   every             steps between outputs (steps per year)
+//   ctrl              N (training points), degree, seed, threads and the
+//                     number of validation points
+//   alpha, coef       the polynomials and their coefficients (see sgmodel)
+//   loo               relative leave one out error of each output
+//   ypred, ytrue      emulated and simulated outputs of the validation points
+//////////////////////////////////////////////////////////////////////////////////
+void Rsurrogate_train(double *gp2, int *lenvars, double *Io, double *Hc,
+	double *LAIF, double *kF, double *intF, double *slopeF, double *r0,
+	double *sparms2, int *startIndex, int *parameterLength, int *npar, int *park,
+	double *lo, double *hi, int *scale, int *every, int *ctrl, int *alpha,
+	double *coef, double *loo, double *ypred, double *ytrue)
+{
+	extarget t;
+	pschedule ps;
+	Forestparms ForParms;
+	sgmodel m;
+	int err;
+
+	rexplore_target(&t, &ps, &ForParms, gp2, lenvars, Io, Hc, LAIF, kF, intF,
+		slopeF, r0, sparms2, startIndex, parameterLength, npar, park, lo, hi, scale,
+		"Rsurrogate_train");
+	if(*every < 1 || ctrl[1] < 0 || ctrl[1] > SG_MAXDEG){
+		error("Rsurrogate_train: the degree has to be between 0 and %i", SG_MAXDEG);
+	}
+
+	m.npar = *npar;
+	m.deg = ctrl[1];
+	m.nbasis = sg_nbasis(m.npar, m.deg);
+	m.alpha = alpha;
+	m.nout = 2*(t.nsteps / *every + 1);
+	m.coef = coef;
+	sg_multiindex(m.npar, m.deg, m.alpha);
+
+	err = sg_train(&t, *every, ctrl[0], (uint64_t) ctrl[2], ctrl[3], &m, loo);
+	if(err == 0 && ctrl[4] > 0){
+		err = sg_validate(&t, *every, &m, ctrl[0], ctrl[4], (uint64_t) ctrl[2],
+			ctrl[3], ypred, ytrue);
+	}
+	if(err == 1){
+		error("Rsurrogate_train: could not allocate memory");
+	}else if(err == 3){
+		error("Rsurrogate_train: invalid design or ranges");
+	}else if(err == 4){
+		error("Rsurrogate_train: %i points are too few for %i polynomials of degree %i",
+			ctrl[0], m.nbasis, m.deg);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Predicts yearly DBH and survival with the emulator (see predict_acgca() in
+// R).
+//   gp2, ..., every   as in Rsurrogate_train
+//   deg, alpha, coef  the emulator
+//   nx, x             the points, x[i*npar + k] is parameter k of point i
+//   ctrl              fallback (0 extrapolate, 1 simulate points outside the
+//                     ranges) and threads
+//   y, sim            the outputs of each point and 1 if it was simulated
+//////////////////////////////////////////////////////////////////////////////////
+void Rsurrogate_predict(double *gp2, int *lenvars, double *Io, double *Hc,
+	double *LAIF, double *kF, double *intF, double *slopeF, double *r0,
+	double *sparms2, int *startIndex, int *parameterLength, int *npar, int *park,
+	double *lo, double *hi, int *scale, int *every, int *deg, int *alpha,
+	double *coef, int *nx, double *x, int *ctrl, double *y, int *sim)
+{
+	extarget t;
+	pschedule ps;
+	Forestparms ForParms;
+	sgmodel m;
+
+	rexplore_target(&t, &ps, &ForParms, gp2, lenvars, Io, Hc, LAIF, kF, intF,
+		slopeF, r0, sparms2, startIndex, parameterLength, npar, park, lo, hi, scale,
+		"Rsurrogate_predict");
+	if(*every < 1 || *deg < 0 || *deg > SG_MAXDEG){
+		error("Rsurrogate_predict: invalid emulator");
+	}
+
+	m.npar = *npar;
+	m.deg = *deg;
+	m.nbasis = sg_nbasis(m.npar, m.deg);
+	m.alpha = alpha;
+	m.nout = 2*(t.nsteps / *every + 1);
+	m.coef = coef;
+
+	if(sg_predict(&t, *every, &m, *nx, x, (ctrl[0] != 0), ctrl[1], y, sim)){
+		error("Rsurrogate_predict: could not allocate memory");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Configures the result cache used by Rgrowthloop and returns its counters.
+// size is the memory budget in bytes (< 0 keeps it), dir the directory of the
+// cache on disk ("" for none) and ctrl [0] 1 to set dir, [1] 1 to clear the
+// cache in memory.  stats returns hits, disk hits, misses, evictions,
+// entries, bytes and the budget.
+//////////////////////////////////////////////////////////////////////////////////
+void Rcache(double *size, char **dir, int *ctrl, double *stats)
+{
+	simstats s;
+
+	if(ctrl[1] != 0){
+		simcache_clear();
+	}
+	if(simcache_config((long long) *size, (ctrl[0] != 0) ? dir[0] : NULL) != 0){
+		error("Rcache: %s is not a directory", dir[0]);
+	}
+
+	simcache_stats(&s);
+	stats[0] = (double) s.hits;
+	stats[1] = (double) s.dhits;
+	stats[2] = (double) s.misses;
+	stats[3] = (double) s.evictions;
+	stats[4] = (double) s.entries;
+	stats[5] = (double) s.bytes;
+	stats[6] = (double) s.maxbytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Reads the counters of the branch profiler (gprofile.c).  ctrl [0] 1 to
+// zero the counters after reading them and returns [1] the unit of ticks
+// (0 ns, 1 TSC cycles, -1 if the package is built without ACGCA_PROFILE).
+// calls and ticks are per branch (gprof_names), trans the growth_st
+// transitions [from*8 + to].
+//////////////////////////////////////////////////////////////////////////////////
+void Rprofile(int *ctrl, double *calls, double *ticks, double *trans)
+{
+	ctrl[1] = gprof_read(calls, ticks, trans);
+	if(ctrl[0] != 0){
+		gprof_reset();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Configures and reads the trace probes (gtrace.c).  ctrl [0] 1 to drop all
+// records and set the probes to mask (bit k for probe k, gtrace_names) and
+// the records kept per thread to ctrl[2] (<= 0 keeps it), [1] 1 to copy up to
+// ctrl[3] records to rec and val.  Returns ctrl [3] the number of records
+// copied (or kept if [1] is 0), [4] records dropped and [5] 1 if the package
+// is built with ACGCA_TRACE.  rec [4*k] probe, thread, step and code and val
+// [3*k] a, b and c of record k.
+//////////////////////////////////////////////////////////////////////////////////
+void Rtrace(int *ctrl, double *mask, int *rec, double *val)
+{
+	long long n, dropped, k;
+	gtrecord *r;
+
+	if(ctrl[0] != 0){
+		gtrace_config((unsigned int) *mask, ctrl[2]);
+	}
+	n = gtrace_count(&dropped);
+	if(ctrl[1] != 0){
+		if(n > ctrl[3]){
+			n = ctrl[3];
+		}
+		r = (gtrecord *) R_alloc(n > 0 ? n : 1, sizeof(gtrecord));
+		n = gtrace_read(r, n);
+		for(k = 0; k < n; k++){
+			rec[4*k] = r[k].probe;
+			rec[4*k + 1] = r[k].thread;
+			rec[4*k + 2] = r[k].step;
+			rec[4*k + 3] = r[k].code;
+			val[3*k] = r[k].v[0];
+			val[3*k + 1] = r[k].v[1];
+			val[3*k + 2] = r[k].v[2];
+		}
+	}
+	ctrl[3] = (int) n;
+	ctrl[4] = (int) (dropped < 2147483647 ? dropped : 2147483647);
+	ctrl[5] = gtrace_compiled();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Replays the steps kept in a replay file of the flight recorder (see
+// flightrec.c), each on its own.  ctrl [0] is the number of frames in which
+// (0 to only read the header) and returns [1] the frames in the file, [2] the
+// failing step, [3] its errorind and [4] its growth_st.  For frame which[k]
+// (0 the oldest) step[k] returns its step, match[k] 1 if the replay gave the
+// recorded result (flightrec_replay()), out [k*GF_NDOUBLE + f] the outputs
+// and iout [k*3 + m] status, errorind and growth_st after the step.
+//////////////////////////////////////////////////////////////////////////////////
+void Rreplay(char **file, int *ctrl, int *which, int *step, int *match,
+	double *out, int *iout)
+{
+	gparms gp;
+	Forestparms fp;
+	gflightrec rec;
+	gcheckpoint ck;
+	goutput o;
+	int k, m, err;
+
+	err = flightrec_read(file[0], &gp, &fp, &rec);
+	if(err != 0){
+		error("Rreplay: could not read replay file %s (code %i)", file[0], err);
+	}
+	ctrl[1] = flightrec_count(&rec);
+	ctrl[2] = rec.fail;
+	ctrl[3] = rec.errorind;
+	ctrl[4] = rec.growth_st;
+
+	for(k = 0; k < ctrl[0]; k++){
+		if(which[k] < 0 || which[k] >= ctrl[1]){
+			free(rec.frame);
+			error("Rreplay: %s has no frame %i", file[0], which[k] + 1);
+		}
+		memset(&o, 0, sizeof(goutput));
+		for(m = 0; m < GF_NDOUBLE; m++){
+			o.v[m] = &out[k*GF_NDOUBLE + m];
+		}
+		for(m = 0; m < GI_NINT; m++){
+			o.iv[m] = &iout[k*GI_NINT + m];
+		}
+		step[k] = flightrec_frame(&rec, which[k])->j;
+		match[k] = flightrec_replay(&gp, &fp, &rec, which[k], &ck, &o);
+	}
+	free(rec.frame);
+}
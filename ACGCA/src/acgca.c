@@ -0,0 +1,431 @@
+/// \file acgca.c
+/// \brief C library interface (see head_files/acgca.h).  Wraps the
+/// growthloop_init() and growthloop_step() functions in growthloop.c behind
+/// opaque handles.
+///
+/// \author Michael Fell
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/acgca.h"
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+
+// The field numbers of the interface are the gfield numbers followed by the
+// gifield numbers.  Fails to compile if they get out of step.
+typedef char acgca_fields_check[(ACGCA_NFIELDS == GF_NDOUBLE + GI_NINT &&
+  (int)ACGCA_LAI == (int)GF_LAI &&
+  (int)ACGCA_status == (int)GF_NDOUBLE + (int)GI_status) ? 1 : -1];
+
+struct acgca_params{
+  acgca_allocator alloc;
+  double v[NSPARMS]; ///< in the order of sparms_names
+  int rhominset;     ///< 1 once rhomin was set, otherwise it follows rho
+};
+
+/// \brief A forcing series (parmax, Hc or LAIF).
+typedef struct{
+  double *v;
+  int n;
+  double c; ///< value when n == 0
+} aseries;
+
+struct acgca_driver{
+  acgca_allocator alloc;
+  gparms gp;
+  double r0;
+  Forestparms ForParms;
+  aseries Io, Hc, LAIF;
+};
+
+struct acgca_sim{
+  acgca_allocator alloc;
+  const acgca_driver *driver;
+  gparms gp;
+  gcheckpoint ck;
+  pschedule ps;
+  int plen[NSPARMS]; ///< all 1, parameters only change through acgca_sim_set()
+  int rhominset;     ///< 1 if rhomin was set, otherwise it follows rho
+  double force[3];   ///< parmax, Hc and LAIF replacing the driver, NAN if not
+  int errorind, growth_st, status;
+};
+
+static void *acgca_defalloc(size_t size, void *ctx){
+  (void)ctx;
+  return malloc(size);
+}
+
+static void acgca_deffree(void *ptr, void *ctx){
+  (void)ctx;
+  free(ptr);
+}
+
+static void *acgca_alloc(const acgca_allocator *alloc, size_t size){
+  void *ptr;
+  acgca_allocator a;
+
+  if(alloc == NULL || alloc->alloc == NULL){
+    a.alloc = acgca_defalloc;
+    a.release = acgca_deffree;
+    a.ctx = NULL;
+  }else{
+    a = *alloc;
+  }
+  ptr = a.alloc(size, a.ctx);
+  if(ptr != NULL){
+    memset(ptr, 0, size);
+    // Every handle starts with its allocator
+    memcpy(ptr, &a, sizeof(acgca_allocator));
+  }
+  return ptr;
+}
+
+static void acgca_release(void *ptr){
+  acgca_allocator a;
+  if(ptr != NULL){
+    memcpy(&a, ptr, sizeof(acgca_allocator));
+    a.release(ptr, a.ctx);
+  }
+}
+
+int acgca_version(void){
+  return ACGCA_API_VERSION;
+}
+
+const char *acgca_field_name(int field){
+  if(field < 0 || field >= ACGCA_NFIELDS){
+    return NULL;
+  }
+  return (field < GF_NDOUBLE) ? gfield_names[field] :
+    gifield_names[field - GF_NDOUBLE];
+}
+
+int acgca_field_index(const char *name){
+  for(int k = 0; k < ACGCA_NFIELDS; k++){
+    if(strcmp(name, acgca_field_name(k)) == 0){
+      return k;
+    }
+  }
+  return -1;
+}
+
+/******************************************************************************
+ * Species parameters
+ *****************************************************************************/
+
+acgca_params *acgca_params_create(const char *species,
+  const acgca_allocator *alloc){
+
+  acgca_params *params;
+  double v[NSPARMS];
+
+  if(species != NULL && species_parms(species, v) != 0){
+    return NULL;
+  }
+  params = acgca_alloc(alloc, sizeof(acgca_params));
+  if(params == NULL){
+    return NULL;
+  }
+  if(species != NULL){
+    memcpy(params->v, v, sizeof(v));
+  }else{
+    species_parms("acru", v);
+    memcpy(params->v + 33, v + 33, 3*sizeof(double));
+  }
+  return params;
+}
+
+int acgca_params_set(acgca_params *params, const char *name, double value){
+  int k = sparms_index(name);
+
+  if(k < 0){
+    return ACGCA_EINVAL;
+  }
+  params->v[k] = value;
+  if(k == 32){
+    params->rhominset = 1;
+  }
+  return ACGCA_OK;
+}
+
+int acgca_params_get(const acgca_params *params, const char *name,
+  double *value){
+
+  int k = sparms_index(name);
+
+  if(k < 0){
+    return ACGCA_EINVAL;
+  }
+  *value = (k == 32 && !params->rhominset) ? params->v[6] : params->v[k];
+  return ACGCA_OK;
+}
+
+void acgca_params_destroy(acgca_params *params){
+  acgca_release(params);
+}
+
+/******************************************************************************
+ * Drivers
+ *****************************************************************************/
+
+acgca_driver *acgca_driver_create(int steps, const acgca_allocator *alloc){
+  acgca_driver *driver;
+
+  if(steps < 1){
+    return NULL;
+  }
+  driver = acgca_alloc(alloc, sizeof(acgca_driver));
+  if(driver == NULL){
+    return NULL;
+  }
+  // The defaults of runacgca()
+  driver->gp.deltat = 1.0/steps;
+  driver->gp.T = 0;
+  driver->gp.BH = 1.37;
+  driver->gp.tolerance = 0.00001;
+  driver->r0 = 0.05;
+  driver->ForParms.kF = 0.6;
+  driver->ForParms.intF = 3.4;
+  driver->ForParms.slopeF = -5.5;
+  driver->Io.c = 2060;
+  driver->Hc.c = -99;
+  driver->LAIF.c = 0;
+  return driver;
+}
+
+static aseries *acgca_series(acgca_driver *driver, const char *name){
+  if(strcmp(name, "parmax") == 0){
+    return &driver->Io;
+  }else if(strcmp(name, "Hc") == 0){
+    return &driver->Hc;
+  }else if(strcmp(name, "LAIF") == 0){
+    return &driver->LAIF;
+  }
+  return NULL;
+}
+
+static void acgca_series_clear(acgca_driver *driver, aseries *s){
+  if(s->v != NULL){
+    driver->alloc.release(s->v, driver->alloc.ctx);
+  }
+  s->v = NULL;
+  s->n = 0;
+}
+
+int acgca_driver_set(acgca_driver *driver, const char *name, double value){
+  aseries *s = acgca_series(driver, name);
+
+  if(s != NULL){
+    acgca_series_clear(driver, s);
+    s->c = value;
+  }
+  else if(strcmp(name, "r0") == 0) driver->r0 = value;
+  else if(strcmp(name, "breast.height") == 0) driver->gp.BH = value;
+  else if(strcmp(name, "tolerance") == 0) driver->gp.tolerance = value;
+  else if(strcmp(name, "kF") == 0) driver->ForParms.kF = value;
+  else if(strcmp(name, "intF") == 0) driver->ForParms.intF = value;
+  else if(strcmp(name, "slopeF") == 0) driver->ForParms.slopeF = value;
+  else return ACGCA_EINVAL;
+
+  return ACGCA_OK;
+}
+
+int acgca_driver_series(acgca_driver *driver, const char *name,
+  const double *values, int n){
+
+  aseries *s = acgca_series(driver, name);
+  double *v;
+
+  if(s == NULL || n < 1){
+    return ACGCA_EINVAL;
+  }
+  v = driver->alloc.alloc(n*sizeof(double), driver->alloc.ctx);
+  if(v == NULL){
+    return ACGCA_ENOMEM;
+  }
+  memcpy(v, values, n*sizeof(double));
+  acgca_series_clear(driver, s);
+  s->v = v;
+  s->n = n;
+  s->c = values[n - 1];
+  return ACGCA_OK;
+}
+
+void acgca_driver_destroy(acgca_driver *driver){
+  if(driver != NULL){
+    acgca_series_clear(driver, &driver->Io);
+    acgca_series_clear(driver, &driver->Hc);
+    acgca_series_clear(driver, &driver->LAIF);
+  }
+  acgca_release(driver);
+}
+
+// Value of a forcing series at step j.
+static double acgca_series_at(const aseries *s, int j){
+  return (j < s->n) ? s->v[j] : s->c;
+}
+
+/******************************************************************************
+ * Simulations
+ *****************************************************************************/
+
+acgca_sim *acgca_sim_create(const acgca_params *params,
+  const acgca_driver *driver){
+
+  acgca_sim *sim = acgca_alloc(&params->alloc, sizeof(acgca_sim));
+  sparms p;
+  double r0 = driver->r0;
+  int k;
+
+  if(sim == NULL){
+    return NULL;
+  }
+  sim->driver = driver;
+  sim->gp = driver->gp;
+  for(k = 0; k < NSPARMS; k++){
+    acgca_params_get(params, sparms_names[k], SPARMS_REF(&p, k));
+    sim->plen[k] = 1;
+  }
+  // The schedule is never read since all parameters have length 1
+  sim->ps.parameterLength = sim->plen;
+  sim->rhominset = params->rhominset;
+  sim->force[0] = sim->force[1] = sim->force[2] = NAN;
+
+  growthloop_init(&p, &sim->gp, &r0, &sim->ck);
+  sim->status = sim->ck.st.status;
+  return sim;
+}
+
+int acgca_sim_step(acgca_sim *sim, int n){
+  return acgca_sim_run(sim, n, NULL, NULL);
+}
+
+int acgca_sim_run(acgca_sim *sim, int n, acgca_input_fn input, void *ctx){
+  const acgca_driver *d = sim->driver;
+  double forcing[3];
+  gforcing f = {&forcing[0], &forcing[1], &forcing[2],
+    (Forestparms *)&d->ForParms};
+  goutput out;
+  int j, k, start = sim->ck.step;
+
+  // Only the integer outputs are kept, the rest is read from the state.
+  memset(&out, 0, sizeof(goutput));
+  out.iv[GI_status] = &sim->status;
+  out.iv[GI_errorind] = &sim->errorind;
+  out.iv[GI_growth_st] = &sim->growth_st;
+
+  for(k = 0; k < n && sim->ck.st.status != 0; k++){
+    // Steps are passed to growthloop_step() as index 0 of one element arrays
+    j = sim->ck.step + 1;
+    forcing[0] = isnan(sim->force[0]) ? acgca_series_at(&d->Io, j) : sim->force[0];
+    forcing[1] = isnan(sim->force[1]) ? acgca_series_at(&d->Hc, j) : sim->force[1];
+    forcing[2] = isnan(sim->force[2]) ? acgca_series_at(&d->LAIF, j) : sim->force[2];
+    if(input != NULL && input(sim, j, forcing, ctx) != 0){
+      break;
+    }
+    if(growthloop_step(&sim->gp, &sim->ck, &sim->ps, &f, &out, 0)){
+      break;
+    }
+  }
+  return sim->ck.step - start;
+}
+
+int acgca_sims_step(acgca_sim **sims, int nsims, int n, int nthreads){
+  int b, total = 0;
+
+#ifdef _OPENMP
+  if(nthreads <= 0){
+    nthreads = omp_get_max_threads();
+  }
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+:total)
+#else
+  (void)nthreads;
+#endif
+  for(b = 0; b < nsims; b++){
+    total += acgca_sim_step(sims[b], n);
+  }
+  return total;
+}
+
+int acgca_sim_force(acgca_sim *sim, const char *name, double value){
+  if(strcmp(name, "parmax") == 0){
+    sim->force[0] = value;
+  }else if(strcmp(name, "Hc") == 0){
+    sim->force[1] = value;
+  }else if(strcmp(name, "LAIF") == 0){
+    sim->force[2] = value;
+  }else{
+    return ACGCA_EINVAL;
+  }
+  return ACGCA_OK;
+}
+
+int acgca_sim_set(acgca_sim *sim, const char *name, double value){
+  int k = sparms_index(name);
+
+  if(k < 0){
+    return ACGCA_EINVAL;
+  }
+  if(k == 32){
+    sim->rhominset = 1;
+  }
+  sparms_set(&sim->ck.p, k, value, sim->rhominset);
+  return ACGCA_OK;
+}
+
+int acgca_sim_param(const acgca_sim *sim, const char *name, double *value){
+  int k = sparms_index(name);
+
+  if(k < 0){
+    return ACGCA_EINVAL;
+  }
+  *value = *SPARMS_REF((sparms *)&sim->ck.p, k);
+  return ACGCA_OK;
+}
+
+int acgca_sim_time(const acgca_sim *sim){
+  return sim->ck.step;
+}
+
+int acgca_sim_getv(const acgca_sim *sim, int nfields, const int *fields,
+  double *buf){
+
+  for(int k = 0; k < nfields; k++){
+    if(acgca_sim_get(sim, fields[k], buf + k) != ACGCA_OK){
+      return ACGCA_EINVAL;
+    }
+  }
+  return ACGCA_OK;
+}
+
+int acgca_sim_get(const acgca_sim *sim, int field, double *buf){
+  goutput out;
+
+  if(field < 0 || field >= ACGCA_NFIELDS){
+    return ACGCA_EINVAL;
+  }
+  if(field < GF_NDOUBLE){
+    memset(&out, 0, sizeof(goutput));
+    out.v[field] = buf;
+    growthloop_store((gcheckpoint *)&sim->ck, (gparms *)&sim->gp, &out, 0);
+  }
+  else if(field == ACGCA_status){
+    *buf = sim->ck.st.status;
+  }
+  else if(field == ACGCA_errorind){
+    *buf = sim->errorind;
+  }
+  else{
+    *buf = sim->growth_st;
+  }
+  return ACGCA_OK;
+}
+
+void acgca_sim_destroy(acgca_sim *sim){
+  acgca_release(sim);
+}
@@ -0,0 +1,156 @@
+/// \file checkpoint.c
+/// \brief Saves and restores the state of the growthloop so a simulation
+/// can be continued later (checkpoint/restart).
+///
+/// The file is binary: an 8 byte magic string "ACGCACK", the layout
+/// version, a byte order marker, the number of species parameters and tree
+/// states, followed by the growthloop state.  Species parameters and tree
+/// states are written one by one through the name/offset tables in
+/// misc_growth_funcs.c so the file does not depend on struct padding.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/checkpoint.h"
+
+static const char ckmagic[8] = "ACGCACK";
+static const int ckendian = 0x01020304;
+
+/// checkpoint_fwrite() writes the state of ck that is kept in a checkpoint
+/// file after its header (status, deltat, rhist, species parameters, tree
+/// states, leaf area) to fp.  Also used for the frames of flightrec.c.
+///
+/// Returns 1 on success, 0 if the write failed.
+///
+int checkpoint_fwrite(FILE *fp, gcheckpoint *ck){
+	int k, ok=1;
+	double lai[6];
+
+	lai[0] = ck->LAI.tot; lai[1] = ck->LAI.top; lai[2] = ck->LAI.bot;
+	lai[3] = ck->LA.tot; lai[4] = ck->LA.top; lai[5] = ck->LA.bot;
+
+	ok = ok && fwrite(&ck->st.status, sizeof(int), 1, fp) == 1;
+	ok = ok && fwrite(&ck->deltat, sizeof(double), 1, fp) == 1;
+	ok = ok && fwrite(ck->rhist, sizeof(double), 2, fp) == 2;
+	for (k = 0; k < NSPARMS; k++){
+		ok = ok && fwrite(SPARMS_REF(&ck->p, k), sizeof(double), 1, fp) == 1;
+	}
+	for (k = 0; k < NTSTATES; k++){
+		ok = ok && fwrite(TSTATES_REF(&ck->st, k), sizeof(double), 1, fp) == 1;
+	}
+	ok = ok && fwrite(lai, sizeof(double), 6, fp) == 6;
+
+	return ok;
+}
+
+/// checkpoint_fread() reads the state written by checkpoint_fwrite() into
+/// ck, leaving the other members of ck as they are.
+///
+/// Returns 1 on success, 0 if the file is truncated.
+///
+int checkpoint_fread(FILE *fp, gcheckpoint *ck){
+	int k, ok=1;
+	double lai[6];
+
+	ok = ok && fread(&ck->st.status, sizeof(int), 1, fp) == 1;
+	ok = ok && fread(&ck->deltat, sizeof(double), 1, fp) == 1;
+	ok = ok && fread(ck->rhist, sizeof(double), 2, fp) == 2;
+	for (k = 0; k < NSPARMS; k++){
+		ok = ok && fread(SPARMS_REF(&ck->p, k), sizeof(double), 1, fp) == 1;
+	}
+	for (k = 0; k < NTSTATES; k++){
+		ok = ok && fread(TSTATES_REF(&ck->st, k), sizeof(double), 1, fp) == 1;
+	}
+	ok = ok && fread(lai, sizeof(double), 6, fp) == 6;
+	if (!ok){
+		return 0;
+	}
+
+	ck->LAI.tot = lai[0]; ck->LAI.top = lai[1]; ck->LAI.bot = lai[2];
+	ck->LA.tot = lai[3]; ck->LA.top = lai[4]; ck->LA.bot = lai[5];
+
+	return 1;
+}
+
+/// checkpoint_write() writes the growthloop state ck to file.
+///
+/// \param file     name of the file to (over)write
+/// \param ck       growthloop state
+///
+/// Returns 0 on success, 1 if the file could not be opened and 2 if the
+/// write failed.
+///
+int checkpoint_write(const char *file, gcheckpoint *ck){
+	FILE *fp;
+	int ok=1;
+	int hdr[6];
+
+	fp = fopen(file, "wb");
+	if (fp == NULL){
+		return 1;
+	}
+
+	hdr[0] = CHECKPOINT_VERSION;
+	hdr[1] = ckendian;
+	hdr[2] = NSPARMS;
+	hdr[3] = NTSTATES;
+	hdr[4] = ck->growthflag;
+	hdr[5] = ck->step;
+
+	ok = ok && fwrite(ckmagic, 1, 8, fp) == 8;
+	ok = ok && fwrite(hdr, sizeof(int), 6, fp) == 6;
+	ok = ok && checkpoint_fwrite(fp, ck);
+
+	if (fclose(fp) != 0){
+		ok = 0;
+	}
+
+	return (ok ? 0 : 2);
+}
+
+/// checkpoint_read() reads a growthloop state written by checkpoint_write().
+///
+/// \param file     name of the checkpoint file
+/// \param ck       returns the growthloop state
+///
+/// Returns 0 on success, 1 if the file could not be opened, 2 if it is not a
+/// checkpoint or is truncated and 3 if it was written by a different version
+/// or on a machine with different byte order.
+///
+int checkpoint_read(const char *file, gcheckpoint *ck){
+	FILE *fp;
+	int ok;
+	int hdr[6];
+	char magic[8];
+
+	fp = fopen(file, "rb");
+	if (fp == NULL){
+		return 1;
+	}
+
+	if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, ckmagic, 8) != 0 ||
+		fread(hdr, sizeof(int), 6, fp) != 6){
+		fclose(fp);
+		return 2;
+	}
+	if (hdr[0] != CHECKPOINT_VERSION || hdr[1] != ckendian ||
+		hdr[2] != NSPARMS || hdr[3] != NTSTATES){
+		fclose(fp);
+		return 3;
+	}
+
+	memset(ck, 0, sizeof(gcheckpoint));
+	ck->growthflag = hdr[4];
+	ck->step = hdr[5];
+
+	ok = checkpoint_fread(fp, ck);
+	fclose(fp);
+
+	return (ok ? 0 : 2);
+}
@@ -0,0 +1,295 @@
+/// \file encoding.c
+/// \brief Compression of output columns for the result store.
+///
+/// Most output series (h, r, bt, vt, ...) are smooth and monotone and the
+/// integer codes (status, errorind, growth_st) change rarely, so:
+///   - lossless doubles are XORed with a prediction (the previous value or
+///     the linear extrapolation of the last two values, whichever is
+///     smaller) and only the non-zero bytes of the result are kept,
+///   - quantized doubles are rounded to a multiple of
+///     2*errbound*max|x| and the second differences of the multiples are
+///     written as variable length integers,
+///   - ints are run length encoded.
+/// Every chunk starts with a mode byte (CHUNK_*) so the decoder needs no
+/// other information.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "head_files/encoding.h"
+
+// Unsigned LEB128 variable length integers.
+static size_t put_varint(unsigned char *buf, uint64_t v){
+	size_t n = 0;
+	while (v >= 0x80){
+		buf[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	buf[n++] = (unsigned char)v;
+	return n;
+}
+
+static size_t get_varint(const unsigned char *buf, size_t len, uint64_t *v){
+	size_t n = 0;
+	int shift = 0;
+	*v = 0;
+	while (n < len && shift < 64){
+		*v |= (uint64_t)(buf[n] & 0x7f) << shift;
+		if ((buf[n++] & 0x80) == 0){
+			return n;
+		}
+		shift += 7;
+	}
+	return 0;
+}
+
+// Map signed to unsigned so small magnitudes give short varints.
+static uint64_t zigzag(int64_t v){
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v){
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint64_t dbits(double x){
+	uint64_t u;
+	memcpy(&u, &x, sizeof(double));
+	return u;
+}
+
+static double bitsd(uint64_t u){
+	double x;
+	memcpy(&x, &u, sizeof(double));
+	return x;
+}
+
+// Prediction of x[i] from the already decoded values.
+static double predict(const double *x, int i, int mode){
+	if (i == 0){
+		return 0.0;
+	}
+	if (mode == CHUNK_XORLIN && i > 1){
+		return 2.0*x[i-1] - x[i-2];
+	}
+	return x[i-1];
+}
+
+// XOR encoding with the given predictor.  Each value is a control byte
+// holding the number of leading (high nibble) and trailing (low nibble)
+// zero bytes of the XOR followed by the remaining bytes.
+static size_t enc_xor(const double *x, int n, int mode, unsigned char *buf){
+	size_t len = 0;
+	int i, lz, tz, b;
+
+	buf[len++] = (unsigned char)mode;
+	for (i = 0; i < n; i++){
+		uint64_t v = dbits(x[i]) ^ dbits(predict(x, i, mode));
+		if (v == 0){
+			buf[len++] = 0x80;
+			continue;
+		}
+		for (lz = 0; ((v >> (56 - 8*lz)) & 0xff) == 0; lz++);
+		for (tz = 0; ((v >> (8*tz)) & 0xff) == 0; tz++);
+		buf[len++] = (unsigned char)((lz << 4) | tz);
+		for (b = 7 - lz; b >= tz; b--){
+			buf[len++] = (unsigned char)(v >> (8*b));
+		}
+	}
+	return len;
+}
+
+static int dec_xor(const unsigned char *buf, size_t len, double *x, int n, int mode){
+	size_t pos = 1;
+	int i, lz, tz, b;
+
+	for (i = 0; i < n; i++){
+		uint64_t v = 0;
+		if (pos >= len){
+			return 1;
+		}
+		lz = buf[pos] >> 4;
+		tz = buf[pos++] & 0x0f;
+		if (lz + tz > 8 || pos + (8 - lz - tz) > len){
+			return 1;
+		}
+		for (b = 7 - lz; b >= tz && lz < 8; b--){
+			v |= (uint64_t)buf[pos++] << (8*b);
+		}
+		x[i] = bitsd(v ^ dbits(predict(x, i, mode)));
+	}
+	return (pos == len) ? 0 : 1;
+}
+
+// Quantized encoding.  Returns 0 if x can not be quantized (non-finite
+// values or a bound too small to be represented).
+static size_t enc_quant(const double *x, int n, double errbound, unsigned char *buf){
+	size_t len = 0;
+	double maxabs = 0, step;
+	int64_t q, q1 = 0, q2 = 0;
+	int i;
+
+	if (!(errbound >= ENC_MINBOUND)){
+		return 0;
+	}
+	for (i = 0; i < n; i++){
+		if (!isfinite(x[i])){
+			return 0;
+		}
+		maxabs = fmax(maxabs, fabs(x[i]));
+	}
+	step = 2.0*errbound*maxabs;
+
+	buf[len++] = CHUNK_QUANT;
+	memcpy(buf + len, &step, sizeof(double));
+	len += sizeof(double);
+	if (step == 0){
+		return len;  // all zero
+	}
+	for (i = 0; i < n; i++){
+		q = llround(x[i]/step);
+		len += put_varint(buf + len, zigzag(q - 2*q1 + q2));
+		q2 = q1;
+		q1 = q;
+	}
+	return len;
+}
+
+static int dec_quant(const unsigned char *buf, size_t len, double *x, int n){
+	size_t pos = 1 + sizeof(double), k;
+	double step;
+	int64_t q, q1 = 0, q2 = 0;
+	uint64_t v;
+	int i;
+
+	if (len < pos){
+		return 1;
+	}
+	memcpy(&step, buf + 1, sizeof(double));
+	for (i = 0; i < n; i++){
+		if (step == 0){
+			x[i] = 0;
+			continue;
+		}
+		k = get_varint(buf + pos, len - pos, &v);
+		if (k == 0){
+			return 1;
+		}
+		pos += k;
+		q = unzigzag(v) + 2*q1 - q2;
+		x[i] = q*step;
+		q2 = q1;
+		q1 = q;
+	}
+	return (pos == len) ? 0 : 1;
+}
+
+/// enc_doubles() encodes n doubles into buf, which must hold ENC_BOUND(n)
+/// bytes.  With ENC_QUANT every decoded value is within errbound*max|x| of
+/// the original (up to rounding of the final multiplication); columns that
+/// can not be quantized are encoded losslessly.
+///
+/// Returns the number of bytes written.
+///
+size_t enc_doubles(const double *x, int n, int encoding, double errbound,
+	unsigned char *buf){
+
+	size_t len, len2;
+	unsigned char *tmp;
+
+	if (encoding == ENC_QUANT){
+		len = enc_quant(x, n, errbound, buf);
+		if (len > 0){
+			return len;
+		}
+	}
+	if (encoding == ENC_RAW){
+		buf[0] = CHUNK_RAW;
+		memcpy(buf + 1, x, n*sizeof(double));
+		return 1 + n*sizeof(double);
+	}
+
+	// Lossless, keep the better of the two predictors
+	len = enc_xor(x, n, CHUNK_XOR, buf);
+	tmp = malloc(ENC_BOUND(n));
+	if (tmp != NULL){
+		len2 = enc_xor(x, n, CHUNK_XORLIN, tmp);
+		if (len2 < len){
+			memcpy(buf, tmp, len2);
+			len = len2;
+		}
+		free(tmp);
+	}
+	return len;
+}
+
+/// dec_doubles() decodes a chunk written by enc_doubles() into n doubles.
+/// Returns 0 on success and 1 if the chunk is corrupt.
+int dec_doubles(const unsigned char *buf, size_t len, double *x, int n){
+	if (len < 1){
+		return 1;
+	}
+	switch (buf[0]){
+	case CHUNK_RAW:
+		if (len != 1 + n*sizeof(double)){
+			return 1;
+		}
+		memcpy(x, buf + 1, n*sizeof(double));
+		return 0;
+	case CHUNK_XOR:
+	case CHUNK_XORLIN:
+		return dec_xor(buf, len, x, n, buf[0]);
+	case CHUNK_QUANT:
+		return dec_quant(buf, len, x, n);
+	default:
+		return 1;
+	}
+}
+
+/// enc_ints() run length encodes n ints into buf (ENC_BOUND(n) bytes) as
+/// (value, run length) varint pairs.  Returns the number of bytes written.
+size_t enc_ints(const int *x, int n, unsigned char *buf){
+	size_t len = 0;
+	int i, run;
+
+	buf[len++] = CHUNK_RLE;
+	for (i = 0; i < n; i += run){
+		for (run = 1; i + run < n && x[i + run] == x[i]; run++);
+		len += put_varint(buf + len, zigzag(x[i]));
+		len += put_varint(buf + len, (uint64_t)run);
+	}
+	return len;
+}
+
+/// dec_ints() decodes a chunk written by enc_ints() into n ints.  Returns 0
+/// on success and 1 if the chunk is corrupt.
+int dec_ints(const unsigned char *buf, size_t len, int *x, int n){
+	size_t pos = 1, k;
+	uint64_t v, run;
+	int i = 0;
+
+	if (len < 1 || buf[0] != CHUNK_RLE){
+		return 1;
+	}
+	while (i < n){
+		k = get_varint(buf + pos, len - pos, &v);
+		if (k == 0){
+			return 1;
+		}
+		pos += k;
+		k = get_varint(buf + pos, len - pos, &run);
+		if (k == 0 || run == 0 || run > (uint64_t)(n - i)){
+			return 1;
+		}
+		pos += k;
+		for (; run > 0; run--){
+			x[i++] = (int)unzigzag(v);
+		}
+	}
+	return (pos == len) ? 0 : 1;
+}
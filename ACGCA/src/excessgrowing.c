@@ -12,9 +12,139 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 // #include <R.h>
 #include "head_files/misc_growth_funcs.h"
 #include "head_files/excessgrowing.h"
+#include "head_files/gprofile.h"
+#include "head_files/gtrace.h"
+#include "head_files/gmath.h"
+
+/// \brief Intermediate results of one demand evaluation in excessgrowingon().
+typedef struct{
+	greal r_new; // new radius
+	greal nuo, rhow, deltaw, la_new, ra_new;
+	greal efl, efr, eft, efo; // used to find demand
+	greal dr, demand; // dr evaluated and efl + efr + eft + efo
+	radius rin;
+	volume v;
+} egdemand;
+
+/// Computes the new radii, volumes and areas of a tree that grows its basal
+/// radius by dr and the demand for labile carbon of each tissue (the body of
+/// the root finding loop of excessgrowingon()).  Returns 1 if the new radius
+/// is negative (the tree dies), 0 otherwise.
+static int egdemandcalc(sparms *p, gparms *gp, tstates *st, greal dr,
+	egdemand *e, int *errorind2, int *growth_st){
+	height hin;
+
+	e->dr=dr;
+	e->r_new=st->r+dr;  // new radius calc. from new dr
+
+	if (e->r_new < 0){
+		GTRACE(GT_fault, 26, e->r_new, st->h, st->ex);
+		e->r_new=st->r;
+		st->h=p->hmax*(1.0-gexp(-p->phih*e->r_new/p->hmax));
+		st->status=0;
+		*growth_st = 26;
+		//getchar();
+		return 1;
+	}
+	if (p->hmax > 0){
+		st->h=p->hmax*(1.0-gexp(-p->phih*e->r_new/p->hmax));
+	}
+	else{
+		GTRACE(GT_fault, 101, e->r_new, st->h, st->ex);
+		*errorind2 = *errorind2 | 32;
+	}
+	st->hh=p->eta*st->h;
+
+	if (e->r_new < p->swmax){
+		st->sw=e->r_new;
+	}
+	else {
+		st->sw=p->swmax;
+	}
+
+	// maybe should eliminate the need for these temp variables (i.e. the radius
+	// and height structures)
+	hin.hB=p->etaB*st->h;
+	hin.hC=st->hh;
+	hin.H=st->h;
+	hin.hBH=gp->BH;
+
+
+	trunkradii(e->r_new, &hin, &e->rin, st);
+
+	trunkvolume(&e->rin, &hin, st->sw, &e->v, st);
+
+	// end new radii and volume calculations.
+
+
+	if((st->vts*gp->deltat != 0) && ((1.0+st->deltas)*st->bos != 0)){
+		st->nut=(e->v.vth-st->vth)/(st->vts*gp->deltat);
+		e->nuo=(p->so*st->boh+(1.0+st->deltas)*p->lamdah*st->nut*st->bts)/((1.0+st->deltas)*st->bos);
+	}
+	else{
+		GTRACE(GT_fault, 27, e->r_new, st->h, st->ex);
+		*errorind2 = *errorind2 | 64;
+		st->status=0;
+		*growth_st = 27;
+	}
+
+	if (dr<(p->drcrit*gp->deltat)){
+		e->rhow=p->rhomax-((p->rhomax-p->rhomin)/p->drcrit)*dr/gp->deltat;
+	}
+	else {
+		e->rhow=p->rhomin;
+	}
+	if (e->rhow > ((1-p->gammax)/p->gammaw)*exp(10)/(1+exp(10))){
+		// if wood density is very close to upper limit (given by deltaw=0), set
+		// carbon storage capacity to zero to avoid rounding and computational errors.
+		e->deltaw=0;
+	}
+	else if (e->rhow != 0) {
+		e->deltaw=p->gammac*(1.0-p->gammax-p->gammaw*e->rhow)/e->rhow;
+	}
+	else{
+		GTRACE(GT_fault, 28, e->r_new, st->h, st->ex);
+		st->status=0;
+		*growth_st = 28;
+		*errorind2 = *errorind2 | 128;
+	}
+
+	st->sa=M_PI*st->sw*(2.0*e->r_new-st->sw);
+	// need la_new and ra_new since we find the difference between new and old
+	// below
+	e->la_new=p->f2*st->sa;
+	e->ra_new=p->f1*e->la_new;
+
+	if (p->sla != 0){
+		e->efl=(p->cgl+p->deltal)*(e->la_new-st->la+p->sl*p->sla*st->bl*gp->deltat)/(p->sla*gp->deltat);
+		e->efr=(p->cgr+p->deltar)*(p->rr*p->rhor*(e->ra_new-st->ra)+2*p->sr*st->br*gp->deltat)/(2.0*gp->deltat);
+		e->eft=(p->cgw+e->deltaw)*((e->v.vt-st->vt)*e->rhow-st->deltas*st->nut*st->bts*gp->deltat)/gp->deltat;
+	}
+	else{
+		GTRACE(GT_fault, 29, e->r_new, st->h, st->ex);
+		st->status=0;
+		*growth_st = 29;
+		*errorind2 = *errorind2 | 256;
+	}
+	if ((1+st->deltas) != 0){
+		e->efo=(p->cgw+e->deltaw)*(p->so*gp->deltat*st->boh+(1+st->deltas)*
+			((e->v.vt-st->vt)*p->lamdas*e->rhow+p->so*st->bos*gp->deltat+
+			(p->lamdah-(1+st->deltas)*p->lamdas)*st->nut*st->bts*
+			gp->deltat))/((1+st->deltas)*gp->deltat);
+	}
+	else{
+		GTRACE(GT_fault, 30, e->r_new, st->h, st->ex);
+		st->status=0;
+		*growth_st = 30;
+		*errorind2 = *errorind2 | 512;
+	}
+	e->demand=e->efl+e->efr+e->eft+e->efo;
+	return 0;
+}
 
 /// excessgrowingon is used to grow a tree (that is currently on the target allometry)
 /// along the target allometry.
@@ -24,10 +154,15 @@
 /// \param st           tree state variables (tstates)
 /// \param i            iteration value from growth model loop
 /// \param growthflag   0 if tree is currently off allometry, = 1 if tree is on allometry
-/// \param r            array of tree radii
+/// \param rhist        basal radius one (rhist[0]) and two (rhist[1]) steps back
+/// \param warm         NULL or a warm start: warm[0] > 0 is the first guess of
+///                     the radius increment (e.g., from an earlier run with
+///                     similar parameters) and warm[1] > 0 the slope of demand
+///                     against dr used for the second guess.  Returns the last
+///                     secant slope in warm[1].
 ///
 ///
-/// Returns updated st (state variables), r and h.  Calls on functions trunkradii() and
+/// Returns the number of demand evaluations and updated st (state variables), r and h.  Calls on functions trunkradii() and
 /// trunkvolume().  This has been mostly tested with Matlab code.  Should be checked
 /// again.
 ///
@@ -38,40 +173,38 @@
 /// \date 11-23-2010
 ///
  
-void excessgrowingon(sparms *p, gparms *gp, tstates *st, 
-	int i, int growthflag, double r[], int *errorind2, int *growth_st){
+int excessgrowingon(sparms *p, gparms *gp, tstates *st, 
+	int i, int growthflag, greal rhist[], double warm[], int *errorind2,
+	int *growth_st){
 	//, double *tolout, double *errorout, double *drout, double *demandout,
 	//double *odemandout, double *odrout){
-  //Rprintf("The growthloop iteration is: %i \n", i);
-	height hin; radius rin; volume v;
+	egdemand e; // new radii, volumes and demands
 
 	//local temp variables.	
-	double dr=0; // incremental increase in radius
-	double odr=0; // old incremental increase
-	double efl=0,efr=0,efo=0,eft=0; // used to find demand
-	double demand=0,odemand=0; // demand and old demand
-	double denom=0,slope=0,intercept=0; // temp variables for root finding routine
-	double nuo=0, rhow=0,la_new=0,ra_new=0;
+	greal dr=0; // incremental increase in radius
+	greal odr=0; // old incremental increase
+	greal demand=0,odemand=0; // demand and old demand
+	greal denom=0,slope=0,intercept=0; // temp variables for root finding routine
 
-	double r_new=0;  // new radius
-	double oslope=0; // old slope (at t - 1) MKF 2/13/19 slope problem
-	double obts=0; // starting bts (not negative)
+	greal oslope=0; // old slope (at t - 1) MKF 2/13/19 slope problem
+	greal obts=0; // starting bts (not negative)
 
 	int j=1;
 	int numerrors=0;
-
-	double deltaw=0; // Is this a local (temp) variable? need to check on this.
+	int bad;                      // demand calculation failed
 
 	int eflag=0;                  // initialize while loop index
 
 	// Matlab used 2*abs(excess*tolerance)+1;
-	double error = fabs(st->ex*gp->tolerance)+10;         // initialize error w/ high value
+	greal error = fabs(st->ex*gp->tolerance)+10;         // initialize error w/ high value
+
+	memset(&e, 0, sizeof(egdemand));
 
 	// Determine new value of r such that "demand" and excess are approx. equal.
 	obts = st->bts;
 	while ((error > fmaxmacro(fabs(st->ex*gp->tolerance),1e-5)) && (j<1000) && (st->status!=0)){
-	  //Rprintf("slope=%g, error=%g, j=%i \n", slope, error, j);
 		if (j>999){ // Was 998 not sure why
+			GTRACE(GT_egfail, 20, dr, slope, error);
 			st->status=0;
 			*growth_st = 20;
 		}
@@ -79,19 +212,23 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 
 		if (j==1){  // j=1 is the first iteration in while loop
 
-			if ((i<2) || (growthflag==0) || (r[i-1]==r[i-2])){// error check, if the tree is currenlty off allometry:
+			if ((warm != NULL) && (warm[0] > 0)){ // warm start
+				odr=warm[0];
+				dr=odr;
+			}
+			else if ((i<2) || (growthflag==0) || (rhist[0]==rhist[1])){// error check, if the tree is currenlty off allometry:
 				odr=p->drinit;  // initial default radius increment
 				dr=odr;         // new dr updated as old dr (odr)
 			}
 			else{
 				odemand=st->egrow;        // egrow is excess labile carbon available for growth
-				odr = r[i-1]-r[i-2];      // old dr.  should not =0 based on first if statement
+				odr = rhist[0]-rhist[1];      // old dr.  should not =0 based on first if statement
 				if ((odr > 0) && (odemand != 0)){
 					slope=odemand/odr;
 					dr=st->ex/slope;
 				}
 				else{
-					//printf("problem in excessgrowingon, line 87 \n");
+					GTRACE(GT_egfail, 21, odr, slope, error);
 					*errorind2 = *errorind2 | 4;
 					st->status=0;
 					*growth_st = 21;
@@ -100,7 +237,19 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 			} // end outer else
 		} //end if j==1
 
-		else if ((j==2) && ((i<3) || (growthflag==0) || (r[i-1]==r[i-2]))){
+		else if ((j==2) && (warm != NULL) && (warm[0] > 0) && (warm[1] > 0)){
+			// Newton step with the slope of the last solve
+			odemand=demand;
+			odr=dr;
+			slope=warm[1];
+			dr=odr+(st->ex-demand)/slope;
+			if (dr<0.0){
+				dr=0.0;
+				eflag=1;
+			}
+		}
+
+		else if ((j==2) && (((warm != NULL) && (warm[0] > 0)) || (i<3) || (growthflag==0) || (rhist[0]==rhist[1]))){
 			odemand=demand;   // demand saved to old demand
 			odr = dr;         // dr saved to old dr
 			if ((odr > 0) && (odemand != 0)){
@@ -108,7 +257,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 				dr=st->ex/slope;
 			}
 			else{
-				//printf("problem in excessgrowingon, line 102 \n");
+				GTRACE(GT_egfail, 22, odr, slope, error);
 				*errorind2 = *errorind2 | 8;
 				st->status=0;
 				*growth_st = 22;
@@ -121,8 +270,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 			slope=(demand-odemand)/(dr-odr);
 			}
 			else{
-				//printf("problem in excessgrowingon, line 111 \n");
-				//getchar();
+				GTRACE(GT_egfail, 23, dr, slope, error);
 				st->status=0;
 				*growth_st = 23;
 				break;
@@ -132,27 +280,25 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 			odr=dr;
 			if (slope == 0){ 
 			  if(numerrors <=10){
-			    //Rprintf("Restarting ROOT FINDING algorithm.");
+			    GTRACE(GT_egrestart, numerrors, dr, slope, error);
 			    slope = oslope;
 			    error = fabs(st->ex*gp->tolerance)+(10*numerrors);
 			    odr=p->drinit;  // initial default radius increment
 			    dr=odr;         // new dr updated as old dr (odr)
 
 		      odemand=st->egrow;        // egrow is excess labile carbon available for growth
-		      odr = r[i-1]-r[i-2];      // old dr.  should not =0 based on first if statement
+		      odr = rhist[0]-rhist[1];      // old dr.  should not =0 based on first if statement
 		      if ((odr > 0) && (odemand != 0)){
 		        slope=odemand/odr;
 		        dr=st->ex/slope;
 		      }
 		      else{
-		        //printf("problem in excessgrowingon, line 87 \n");
+		        GTRACE(GT_egfail, 200, odr, slope, error);
 		        *errorind2 = *errorind2 | 4;
 		        st->status=0;
 		        *growth_st = 200;
 		        break;
 		      }  // end else
-
-			    //Rprintf("SLOPE = 0 error RESTART NOW! \n");
 			  }
 			  numerrors++;
 			}
@@ -160,8 +306,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 				dr=st->ex/slope;
 			}
 			else{
-        //Rprintf("Slope 0 slope=%g, error=%g, j=%i \n", slope, error, j);
-				//printf("problem in excessgrowingon, line 120 \n");
+				GTRACE(GT_egfail, 24, dr, slope, error);
 				*errorind2 = *errorind2 | 16;
 				//getchar();  // keep
 				st->status=0;
@@ -179,6 +324,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 					}
 				}
 				else{
+					GTRACE(GT_egfail, 25, dr, slope, error);
 					st->status=0;
 					*growth_st = 25;
 					dr=0;
@@ -187,7 +333,6 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 			else {
 				demand=st->ex;
 				error=0.0;
-				//printf("set demand = excess in excessgrowingon \n");
 			}
 		} //end else
 
@@ -197,151 +342,55 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 		// Begin if error ...
 		if (error >= fabs(st->ex*gp->tolerance)){
 
-			r_new=st->r+dr;  // new radius calc. from new dr
-
-			if (r_new < 0){
-				//printf("error in excessgrowingon, line 162 \n");
-				//printf("dr=%g, slope=%g, odemand=%g, demand=%g, intercept=%g, j=%d \n",
-				//       dr, slope, odemand,demand,intercept,j);
-				//printf("sla=%g, hmax=%g, phih=%g, st->r=%g, st->ex=%g, rhomax=%g \n",p->sla,
-				//       p->hmax, p->phih, st->r, st->ex, p->rhomax);
-				r_new=st->r;
-				st->h=p->hmax*(1.0-exp(-p->phih*r_new/p->hmax));
-				st->status=0;
-				*growth_st = 26;
-				//getchar();
+			GPROF_CALL(GP_egdemand,
+				bad=egdemandcalc(p, gp, st, dr, &e, errorind2, growth_st));
+			if (bad){
 				break;
 			}
-			//printf("r_new=%g \n",r_new);
-			if (p->hmax > 0){
-				st->h=p->hmax*(1.0-exp(-p->phih*r_new/p->hmax));
-			}
-			else{
-				//printf("problem in excessgrowingon, line 161 \n");
-				*errorind2 = *errorind2 | 32;
-			}
-			st->hh=p->eta*st->h;
-
-			if (r_new < p->swmax){
-				st->sw=r_new;
-			}
-			else {
-				st->sw=p->swmax;
-			}
-
-			// maybe should eliminate the need for these temp variables (i.e. the radius
-			// and height structures)
-			hin.hB=p->etaB*st->h;
-			hin.hC=st->hh;
-			hin.H=st->h;
-			hin.hBH=gp->BH;
-
-
-			trunkradii(r_new, &hin, &rin, st);
-
-			trunkvolume(&rin, &hin, st->sw, &v, st);
-
-			// end new radii and volume calculations.
-
-
-			if((st->vts*gp->deltat != 0) && ((1.0+st->deltas)*st->bos != 0)){
-				st->nut=(v.vth-st->vth)/(st->vts*gp->deltat);
-			  //Rprintf("v.vth=%g, st->vth=%g, st->vts=%g \n", v.vth, st->vth, st->vts);
-				nuo=(p->so*st->boh+(1.0+st->deltas)*p->lamdah*st->nut*st->bts)/((1.0+st->deltas)*st->bos);
-			}
-			else{
-				//printf("problem in excessgrowingon, line 195 \n");
-				*errorind2 = *errorind2 | 64;
-				st->status=0;
-				*growth_st = 27;
-			}
-
-			if (dr<(p->drcrit*gp->deltat)){
-				rhow=p->rhomax-((p->rhomax-p->rhomin)/p->drcrit)*dr/gp->deltat;
-			}
-			else {
-				rhow=p->rhomin;
-			}
-			if (rhow > ((1-p->gammax)/p->gammaw)*exp(10)/(1+exp(10))){
-				// if wood density is very close to upper limit (given by deltaw=0), set
-				// carbon storage capacity to zero to avoid rounding and computational errors.
-				deltaw=0;
-			}
-			else if (rhow != 0) {
-				deltaw=p->gammac*(1.0-p->gammax-p->gammaw*rhow)/rhow;
-			}
-			else{
-				//printf("problem in excessgrowingon, line 214 \n");
-				st->status=0;
-				*growth_st = 28;
-				*errorind2 = *errorind2 | 128;
-			}
-
-			st->sa=M_PI*st->sw*(2.0*r_new-st->sw);
-			// need la_new and ra_new since we find the difference between new and old
-			// below
-			la_new=p->f2*st->sa;
-			ra_new=p->f1*la_new;
-
-			if (p->sla != 0){
-				efl=(p->cgl+p->deltal)*(la_new-st->la+p->sl*p->sla*st->bl*gp->deltat)/(p->sla*gp->deltat);
-				efr=(p->cgr+p->deltar)*(p->rr*p->rhor*(ra_new-st->ra)+2*p->sr*st->br*gp->deltat)/(2.0*gp->deltat);
-				eft=(p->cgw+deltaw)*((v.vt-st->vt)*rhow-st->deltas*st->nut*st->bts*gp->deltat)/gp->deltat;
-			}
-			else{
-				//printf("problem in excessgrowingon, line 232 \n");
-				st->status=0;
-				*growth_st = 29;
-				*errorind2 = *errorind2 | 256;
-			}
-			if ((1+st->deltas) != 0){
-				efo=(p->cgw+deltaw)*(p->so*gp->deltat*st->boh+(1+st->deltas)*
-					((v.vt-st->vt)*p->lamdas*rhow+p->so*st->bos*gp->deltat+
-					(p->lamdah-(1+st->deltas)*p->lamdas)*st->nut*st->bts*
-					gp->deltat))/((1+st->deltas)*gp->deltat);
-			}
-			else{
-				//printf("problem in excessgrowingon, line244 \n");
-				st->status=0;
-				*growth_st = 30;
-				*errorind2 = *errorind2 | 512;
-			}
 			// update demand
 			if (eflag==0) {
-				demand=efl+efr+eft+efo;
+				demand=e.demand;
 			}
 			else {
 				demand=st->ex;
 			}
 
 			error=fabs(demand-st->ex);  // update the error
-      
-      //tolout[(i-1)*1000+j] = fmaxmacro(fabs(st->ex*gp->tolerance),1e-5);
-      //errorout[(i-1)*1000+j] = error;
-      //odrout[(i-1)*1000+j]=odr;
-      //drout[(i-1)*1000+j]=dr;
-      //odemandout[(i-1)*1000+j]=odemand;
-      //demandout[(i-1)*1000+j]=demand;
-      //printf("tolout, iter=%d, tolout=%f \n",i,tolout[(i-1)*1000+j]);
-      //printf("errorout, iter=%d, errorout=%f \n",i,errorout[(i-1)*1000+j]);
-      //printf("error, iter=%d, error=%f \n",i,error);
-      
-      
+			GTRACE(GT_egiter, j, dr, demand, error);
+
 			j=j+1;   // change this to ++j
 			oslope = slope;
 
 		} //end "if (error..."
-		//Rprintf("While loop calc, st->bts=%g, rhow=%g, v.vt=%g, st->vt=%g, st->nut=%g, gp->deltat=%g, i=%i \n", st->bts, rhow, v.vt, st->vt, st->nut, gp->deltat, i);
 	} //end while loop
 
+#ifdef ACGCA_AD
+	// dr solves demand(dr) = ex, so its derivatives follow from the implicit
+	// function theorem, dr' = -(demand - ex)'/(d demand/d dr), whatever the
+	// secant iterations left in them.  The slope is a difference quotient of
+	// the values.  The last evaluation is then repeated at the same dr to
+	// carry the derivatives into the new state.
+	if ((st->status!=0) && (eflag==0) && (j>1)){
+		egdemand eh=e;
+		tstates sth=*st;
+		int errh=0, gsh=0;
+		greal dre=e.dr;
+		double h=1e-6*fmaxmacro(GVAL(dre), GVAL(p->drinit));
+
+		egdemandcalc(p, gp, &sth, dre+h, &eh, &errh, &gsh);
+		gimplicit(&dre, e.demand-st->ex, GVAL(eh.demand-e.demand)/h);
+		egdemandcalc(p, gp, st, dre, &e, errorind2, growth_st);
+	}
+#endif
+
 
 
 	// allocation fractions
-	denom=efl+efr+eft+efo;
-	st->fl=fmaxmacro(0,efl/denom);
-	st->fr=fmaxmacro(0,efr/denom);
-	st->ft=fmaxmacro(0,eft/denom);
-	st->fo=fmaxmacro(0,efo/denom);
+	denom=e.efl+e.efr+e.eft+e.efo;
+	st->fl=fmaxmacro(0,e.efl/denom);
+	st->fr=fmaxmacro(0,e.efr/denom);
+	st->ft=fmaxmacro(0,e.eft/denom);
+	st->fo=fmaxmacro(0,e.efo/denom);
 
 	denom=st->fl+st->fr+st->ft+st->fo;
 
@@ -352,7 +401,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 		st->fo=st->fo/denom;
 	}
 	else{
-		//printf("problem with allocation fractions in excessgrowingon or putonallometry \n");
+		GTRACE(GT_fault, 31, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 31;
 		*errorind2 = *errorind2 | 1024;
@@ -360,12 +409,12 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 
 
 	// Now that we have the new trunk radius, calculate new state variables:
-	if ((p->cgw+deltaw) != 0){
-		st->cs=st->cs+gp->deltat*(st->ft+st->fo)*st->ex*deltaw/(p->cgw+deltaw)
-			-gp->deltat*st->deltas*(st->nut*st->bts+(nuo+p->so)*st->bos);
+	if ((p->cgw+e.deltaw) != 0){
+		st->cs=st->cs+gp->deltat*(st->ft+st->fo)*st->ex*e.deltaw/(p->cgw+e.deltaw)
+			-gp->deltat*st->deltas*(st->nut*st->bts+(e.nuo+p->so)*st->bos);
 	}
 	else{
-		//printf("problem in excessgrowingon, line 302 \n");
+		GTRACE(GT_fault, 32, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 32;
 		*errorind2 = *errorind2 | 2048;
@@ -382,7 +431,7 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 		st->rfs=st->rfs/st->rtrans;
 	}
 	else {
-		//printf("problem in excessgrowingoff or on, translocation \n");
+		GTRACE(GT_fault, 33, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 33;
 		*errorind2 = *errorind2 | 4096;
@@ -392,53 +441,47 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 
 	st->bth=st->bth+(1.0+st->deltas)*st->nut*st->bts*gp->deltat;
 	
-	//Rprintf("prior to calc, st->bts=%g, rhow=%g, v.vt=%g, st->vt=%g, st->nut=%g, gp->deltat=%g, i=%i \n", st->bts, rhow, v.vt, st->vt, st->nut, gp->deltat, i);
-	st->bts=st->bts+rhow*(v.vt-st->vt)-st->nut*st->bts*gp->deltat;
+	st->bts=st->bts+e.rhow*(e.v.vt-st->vt)-st->nut*st->bts*gp->deltat;
 	if(st->bts < 0){ // Added 3/6/19
-	  //Rprintf("BTS BTS BTS Restarting ROOT FINDING algorithm dut to ST->BTS.");
 	  st->bts = obts;
 	  slope = 0; // Force algorithem reset. 
 	  error = fmaxmacro(fabs(st->ex*gp->tolerance),1e-5) + 1; // Make sure while continues 3/6/2019
 	}
-	//Rprintf("st->bts=%g, i=%i \n", st->bts, i);
 
 	if ((isnan(st->cs) !=0) || (isnan(st->deltas) !=0) ||
 		(isnan(st->bos) !=0) || (isnan(st->bl) !=0)  || (isnan(st->ex) !=0)){
-		//printf("inside excess growing on \n");
-		//printf("st.r=%g, st.bos=%g, st.bts=%g \n", st->r,st->bos,st->bts);
-		//printf("f2=%g, st.sa=%g, st.bl=%g, p->sla=%g \n",log(p->f2), st->sa, st->bl, p->sla);
-		//printf("st->br=%g, st->bl=%g, p->sl=%g, p->sr=%g \n", st->br, st->bl, p->sl, p->sr);
-		//printf("st->bts=%g,st->boh=%g,p->lamdah=%g,st->bth=%g, st->bos=%g \n",
-		  //st->bts,st->boh,p->lamdah,st->bth,st->bos);
-
-		//printf("dr=%g, slope=%g, odr=%g \n",dr,slope,odr);
-		//printf("st->cs=%g, gp->deltat=%g, excess=%g, st->deltas=%g, p->so=%g, st->bos=%g \n",
-		  //st->cs, gp->deltat, st->ex, st->deltas, p->so, st->bos);
-
+		GTRACE(GT_fault, 102, st->r, st->h, st->ex);
 		*errorind2 = *errorind2 | 8192;
-
 	}
 
-	st->bl=la_new/p->sla;
-	st->br=p->rhor*p->rr*ra_new/2;
+	st->bl=e.la_new/p->sla;
+	st->br=p->rhor*p->rr*e.ra_new/2;
 	st->bt=st->bts+st->bth;
 	st->bos=p->lamdas*st->bts;
 	st->boh=p->lamdah*st->bth;
 	st->bo=st->bos+st->boh;
 	st->bs=st->bos+st->bts;
 	st->clr=p->deltal*st->bl+p->deltar*st->br;
-	st->dr=r_new-st->r;
-	st->r  = r_new;
+	st->dr=e.r_new-st->r;
+	st->r  = e.r_new;
 	// st->dr=dr;
-	st->rB = rin.rB;
-	st->rC = rin.rC;
-	st->rBH= rin.rBH;
-	st->vts= v.vts;
-	st->vt = v.vt;
-	st->vth= v.vth;
-	st->la = la_new;
-	st->ra = ra_new;
+	st->rB = e.rin.rB;
+	st->rC = e.rin.rC;
+	st->rBH= e.rin.rBH;
+	st->vts= e.v.vts;
+	st->vt = e.v.vt;
+	st->vth= e.v.vth;
+	st->la = e.la_new;
+	st->ra = e.ra_new;
 	st->egrow=st->ex;
+	// Secant slope through the last two guesses for the next warm start
+	if ((warm != NULL) && (j>2) && (dr != odr) && (eflag==0)){
+		slope=(demand-odemand)/(dr-odr);
+		if (slope > 0){
+			warm[1]=GVAL(slope);
+		}
+	}
+	return j-1;
 } //end excessgrowingon
 
 
@@ -459,28 +502,28 @@ void excessgrowingon(sparms *p, gparms *gp, tstates *st,
 /// \date 12-07-2010
 ///
 
-void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw, 
+void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, greal deltaw, 
 	int *errorind2, int *growth_st){
 
 	//temp local variables for intermediate calculations
-	double nuo=0,bos_new=0;
+	greal nuo=0,bos_new=0;
 
 	// Grow tree along reduced allometry
-	double prt1=2.0*st->bts*p->sla*p->lamdas;
-	double prt2=(p->cgl+p->deltal)*(1.0+st->deltas)*(1.0-p->sl*gp->deltat)*st->bl;
-	double prt3=(1.0-p->so*gp->deltat)*(p->cgw+deltaw)*st->boh;
-	double prt4=(st->ex)*gp->deltat+(1.0-p->so*gp->deltat)*(p->cgw+deltaw)*
+	greal prt1=2.0*st->bts*p->sla*p->lamdas;
+	greal prt2=(p->cgl+p->deltal)*(1.0+st->deltas)*(1.0-p->sl*gp->deltat)*st->bl;
+	greal prt3=(1.0-p->so*gp->deltat)*(p->cgw+deltaw)*st->boh;
+	greal prt4=(st->ex)*gp->deltat+(1.0-p->so*gp->deltat)*(p->cgw+deltaw)*
 		st->bos+(p->cgr+p->deltar)*(1.0-p->sr*p->deltar)*st->br;
-	double prt5=2.0*p->sla*(p->cgw+deltaw)*(st->bth*p->lamdah+st->bts*(1.0+st->deltas)*p->lamdas);
-	double prt6=2.0*p->deltal+p->f1*p->rr*p->sla*(p->cgr+p->deltar)*p->rhor;
-	double num=prt1*(prt2+prt3+(1.0+st->deltas)*prt4);
-	double den=2.0*p->cgl*p->f2*st->sa*(1.0+st->deltas)+prt5+p->f2*st->sa*(1.0+st->deltas)*prt6;
+	greal prt5=2.0*p->sla*(p->cgw+deltaw)*(st->bth*p->lamdah+st->bts*(1.0+st->deltas)*p->lamdas);
+	greal prt6=2.0*p->deltal+p->f1*p->rr*p->sla*(p->cgr+p->deltar)*p->rhor;
+	greal num=prt1*(prt2+prt3+(1.0+st->deltas)*prt4);
+	greal den=2.0*p->cgl*p->f2*st->sa*(1.0+st->deltas)+prt5+p->f2*st->sa*(1.0+st->deltas)*prt6;
 	// only bos is updated here
 	if (den != 0){
 		bos_new=num/den;
 	}
 	else {
-		//printf("problem in excessgrowingoff, line 419 \n");
+		GTRACE(GT_fault, 34, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 34;
 		*errorind2 = *errorind2 | 16384;
@@ -492,7 +535,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 			den;
 	}
 	else {
-		//printf("problem in excessgrowingoff, line 429 \n");
+		GTRACE(GT_fault, 35, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 35;
 		*errorind2 = *errorind2 | 32768;
@@ -511,7 +554,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 			bos_new=num/den;
 		}
 		else {
-			//printf("problem in excessgrowingoff, line 448 \n");
+			GTRACE(GT_fault, 36, st->r, st->h, st->ex);
 			st->status=0;
 			*growth_st = 36;
 		}
@@ -530,7 +573,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 							   p->lamdas*st->br)/num;
 	}
 	else {
-		//printf("problem in excessgrowingoff, line 467 \n");
+		GTRACE(GT_fault, 37, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 37;
 		*errorind2 = *errorind2 | 65536;
@@ -549,7 +592,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 		st->rfs=st->rfs/st->rtrans;
 	}
 	else {
-		//printf("problem in excessgrowingoff or on, translocation \n");
+		GTRACE(GT_fault, 38, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 38;
 		*errorind2 = *errorind2 | 131072;
@@ -560,7 +603,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 		st->la=p->f2*st->sa*bos_new/(p->lamdas*st->bts);  // use bos_new
 	}
 	else {
-		//printf("error in excessgrowingoff, line 495 \n");
+		GTRACE(GT_fault, 39, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 39;
 		*errorind2 = *errorind2 | 262144;
@@ -573,7 +616,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 		// use old bos
 	}
 	else {
-		//printf("problem in excessgrowingoff, line 490 \n");
+		GTRACE(GT_fault, 40, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 40;
 	}
@@ -583,8 +626,7 @@ void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i, double deltaw,
 		st->boh=p->lamdah*st->bth*st->bos/(p->lamdas*st->bts);
 	}
 	else {
-	  //Rprintf("p->lamdas=%g, st->bts=%g, i=%i \n", p->lamdas, st->bts, i);
-		//printf("error in excessgrowingoff, line 516 \n");
+		GTRACE(GT_fault, 41, st->r, st->h, st->ex);
 		st->status=0;
 		*growth_st = 41;
 		*errorind2 = *errorind2 | 524288;
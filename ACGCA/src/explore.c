@@ -0,0 +1,366 @@
+/// \file explore.c
+/// \brief Maps where in trait space trees survive and grow (as in Fell et
+/// al. 2018) by running many species parameter vectors from a space filling
+/// design and keeping only a few summaries of each run.
+///
+/// The design is a Sobol sequence (direction numbers of Joe and Kuo 2008)
+/// with a random digital shift, or a Latin hypercube whose strata are
+/// shuffled by a keyed permutation (Kensler 2013), so any point of either
+/// design is computed from its index alone and a design can be split over
+/// processes.  Each range is sampled uniformly on a linear, log or logit
+/// scale.  The points are run in blocks in parallel and the summaries of a
+/// block are appended to the table in point order, so memory does not grow
+/// with the number of points and results do not depend on the number of
+/// threads.
+///
+/// Table layout (native byte order):
+///   char magic[8]        "ACGCAEX"
+///   int  hdr[8]          version, byte order marker, npar, EX_NSUM, design,
+///                        0, 0, 0
+///   long long info[4]    n, from (index of the first point), seed, 0
+///   int  park[npar], int scale[npar]
+///   double lo[npar], double hi[npar]
+///   char names[npar][EXPLORE_NAMELEN] (sparms_names of the parameters)
+///   records: float x[npar] (the parameters), float summary[EX_NSUM]
+///
+/// Record r holds point from + r.  A partly written last record is ignored.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/rng.h"
+#include "head_files/explore.h"
+
+/// Points simulated per block.
+#define EX_BLOCK 256
+
+const char *exsummary_names[EX_NSUM] = {
+  "alive", "death", "h", "dbh", "healthy", "reduced", "recovery", "static",
+  "shrinking", "dead", "other"
+};
+
+static const char exmagic[8] = "ACGCAEX";
+static const int exendian = 0x01020304;
+
+// Degree s, coefficients a and initial direction numbers m of the primitive
+// polynomials of dimensions 2 to 36 (new-joe-kuo-6.21201).  Dimension 1 is
+// the van der Corput sequence.
+static const struct{
+  int s, a, m[7];
+} exsobol[NSPARMS - 1] = {
+  {1, 0, {1}},
+  {2, 1, {1, 3}},
+  {3, 1, {1, 3, 1}},
+  {3, 2, {1, 1, 1}},
+  {4, 1, {1, 1, 3, 3}},
+  {4, 4, {1, 3, 5, 13}},
+  {5, 2, {1, 1, 5, 5, 17}},
+  {5, 4, {1, 1, 5, 5, 5}},
+  {5, 7, {1, 1, 7, 11, 19}},
+  {5, 11, {1, 1, 5, 1, 1}},
+  {5, 13, {1, 1, 1, 3, 11}},
+  {5, 14, {1, 3, 5, 5, 31}},
+  {6, 1, {1, 3, 3, 9, 7, 49}},
+  {6, 13, {1, 1, 1, 15, 21, 21}},
+  {6, 16, {1, 3, 1, 13, 27, 49}},
+  {6, 19, {1, 1, 1, 15, 7, 5}},
+  {6, 22, {1, 3, 1, 15, 13, 25}},
+  {6, 25, {1, 1, 5, 5, 19, 61}},
+  {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+  {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+  {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+  {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+  {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+  {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+  {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+  {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+  {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+  {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+  {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+  {7, 41, {1, 3, 5, 13, 23, 1, 55}},
+  {7, 42, {1, 3, 7, 3, 13, 59, 17}},
+  {7, 50, {1, 3, 1, 3, 5, 53, 69}},
+  {7, 55, {1, 1, 5, 5, 23, 33, 13}},
+  {7, 56, {1, 1, 7, 7, 1, 61, 123}},
+  {7, 59, {1, 1, 7, 9, 13, 61, 49}}
+};
+
+/// ex_design() sets up a design of n points in npar dimensions.  Returns 3
+/// if n or npar are out of range (n is at most 2^32 - 1).
+int ex_design(exdesign *d, int design, long long n, uint64_t seed,
+  int npar){
+
+  rngstate rng;
+  int j, k, l, s;
+
+  if(npar < 1 || npar > NSPARMS || n < 1 || n > 0xffffffffLL ||
+    (design != EX_SOBOL && design != EX_LHS)){
+    return 3;
+  }
+  d->design = design;
+  d->npar = npar;
+  d->n = n;
+  d->seed = seed;
+
+  // Direction numbers v[j][l] = m_{l+1}/2^(l+1) as 32 bit fractions
+  for(l = 0; l < 32; l++){
+    d->v[0][l] = 1U << (31 - l);
+  }
+  for(j = 1; j < npar; j++){
+    s = exsobol[j - 1].s;
+    for(l = 0; l < 32; l++){
+      if(l < s){
+        d->v[j][l] = (uint32_t)exsobol[j - 1].m[l] << (31 - l);
+      }else{
+        d->v[j][l] = d->v[j][l - s] ^ (d->v[j][l - s] >> s);
+        for(k = 1; k < s; k++){
+          if((exsobol[j - 1].a >> (s - 1 - k)) & 1){
+            d->v[j][l] ^= d->v[j][l - k];
+          }
+        }
+      }
+    }
+  }
+
+  rng_seed(&rng, seed, 0);
+  for(j = 0; j < npar; j++){
+    d->key[j] = (uint32_t)(rng_next(&rng) >> 32);
+  }
+  return 0;
+}
+
+// Keyed permutation of 0, ..., l - 1 (Kensler 2013, cycle walking over the
+// next power of 2).
+static uint32_t ex_permute(uint32_t i, uint32_t l, uint32_t p){
+  uint32_t w = l - 1;
+
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+  do{
+    i ^= p;
+    i *= 0xe170893d;
+    i ^= p >> 16;
+    i ^= (i & w) >> 4;
+    i ^= p >> 8;
+    i *= 0x0929eb3f;
+    i ^= p >> 23;
+    i ^= (i & w) >> 1;
+    i *= 1 | p >> 27;
+    i *= 0x6935fa69;
+    i ^= (i & w) >> 11;
+    i *= 0x74dcb303;
+    i ^= (i & w) >> 2;
+    i *= 0x9e501cc3;
+    i ^= (i & w) >> 2;
+    i *= 0xc860a3df;
+    i &= w;
+    i ^= i >> 5;
+  }while(i >= l);
+  return (uint32_t)(((uint64_t)i + p) % l);
+}
+
+/// ex_point() returns point i (0 <= i < n) of the design in u, each
+/// coordinate in (0, 1).
+void ex_point(const exdesign *d, long long i, double *u){
+  int j, l;
+
+  if(d->design == EX_SOBOL){
+    // Gray code order, so the first 2^m points are a (t, m, s)-net
+    uint32_t g = (uint32_t)i ^ ((uint32_t)i >> 1), x;
+    for(j = 0; j < d->npar; j++){
+      x = d->key[j];
+      for(l = 0; l < 32; l++){
+        if((g >> l) & 1){
+          x ^= d->v[j][l];
+        }
+      }
+      u[j] = (x + 0.5)*0x1.0p-32;
+    }
+  }else{
+    // Stratum of point i in each dimension, jittered within the stratum by
+    // a stream of its own so any point can be computed alone
+    rngstate rng;
+    rng_seed(&rng, d->seed, (uint64_t)i + 1);
+    for(j = 0; j < d->npar; j++){
+      u[j] = (ex_permute((uint32_t)i, (uint32_t)d->n, d->key[j]) +
+        rng_unif(&rng))/d->n;
+    }
+  }
+}
+
+/// ex_scale() returns the parameter value at u in [0, 1] of the range lo to
+/// hi on the given scale.
+double ex_scale(int scale, double lo, double hi, double u){
+  double a, b;
+
+  switch(scale){
+  case EX_LOG:
+    return exp(log(lo) + u*(log(hi) - log(lo)));
+  case EX_LOGIT:
+    a = log(lo/(1 - lo));
+    b = log(hi/(1 - hi));
+    return 1/(1 + exp(-(a + u*(b - a))));
+  default:
+    return lo + u*(hi - lo);
+  }
+}
+
+/// ex_eval() simulates the tree with the varied parameters at u and writes
+/// the parameters and the summaries (exsummary) to rec.  gst holds the
+/// growth_st of each step (nsteps + 1 values).
+void ex_eval(const extarget *t, const double *u, int *gst, float *rec){
+  sparms p = t->p;
+  gparms gp = t->gp;
+  gforcing f = t->f;
+  gcheckpoint ck;
+  goutput out;
+  double r0 = t->r0, v[GF_NDOUBLE], s[EX_NSUM];
+  int j, k, n, dead;
+  long cnt[7] = {0};
+
+  for(k = 0; k < t->npar; k++){
+    sparms_set(&p, t->park[k], ex_scale(t->scale[k], t->lo[k], t->hi[k],
+      u[k]), 0);
+    rec[k] = (float)*SPARMS_REF(&p, t->park[k]);
+  }
+
+  memset(&out, 0, sizeof(goutput));
+  out.iv[GI_growth_st] = gst;
+  growthloop_init(&p, &gp, &r0, &ck);
+  n = growthloop_run(&gp, &ck, t->ps, &f, &out, t->nsteps);
+  dead = (ck.st.status == 0);
+  out.iv[GI_growth_st] = NULL;
+  for(k = 0; k < GF_NDOUBLE; k++){
+    out.v[k] = &v[k];
+  }
+  growthloop_store(&ck, &gp, &out, 0);
+
+  // Steps after the death of the tree count as dead
+  for(j = 1; j <= t->nsteps; j++){
+    k = (j <= n) ? gst[j] : 6;
+    cnt[(k >= 1 && k <= 6) ? k - 1 : 6]++;
+  }
+
+  s[EX_alive] = !dead;
+  s[EX_death] = dead ? ck.step*gp.deltat : t->nsteps*gp.deltat;
+  s[EX_h] = v[GF_h];
+  s[EX_dbh] = 2*v[GF_rBH];
+  for(k = 0; k < 7; k++){
+    s[EX_healthy + k] = (t->nsteps > 0) ? (double)cnt[k]/t->nsteps : NAN;
+  }
+  for(k = 0; k < EX_NSUM; k++){
+    rec[t->npar + k] = (float)s[k];
+  }
+}
+
+static int ex_threads(int nthreads){
+#ifdef _OPENMP
+  return (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+  (void)nthreads;
+  return 1;
+#endif
+}
+
+// Writes the header of the table.  Returns 0 on success.
+static int ex_writeheader(FILE *fp, const extarget *t, const exdesign *d,
+  long long from){
+  int hdr[8] = {EXPLORE_VERSION, exendian, t->npar, EX_NSUM, d->design, 0, 0,
+    0};
+  long long info[4] = {d->n, from, (long long)d->seed, 0};
+  char names[NSPARMS][EXPLORE_NAMELEN];
+  size_t np = (size_t)t->npar;
+  int k;
+
+  memset(names, 0, sizeof(names));
+  for(k = 0; k < t->npar; k++){
+    strncpy(names[k], sparms_names[t->park[k]], EXPLORE_NAMELEN - 1);
+  }
+  return (fwrite(exmagic, 1, 8, fp) != 8 || fwrite(hdr, sizeof(int), 8, fp) != 8 ||
+    fwrite(info, sizeof(long long), 4, fp) != 4 ||
+    fwrite(t->park, sizeof(int), np, fp) != np ||
+    fwrite(t->scale, sizeof(int), np, fp) != np ||
+    fwrite(t->lo, sizeof(double), np, fp) != np ||
+    fwrite(t->hi, sizeof(double), np, fp) != np ||
+    fwrite(names, EXPLORE_NAMELEN, np, fp) != np);
+}
+
+/// ex_run() runs the points from, ..., to - 1 of a design of n points and
+/// writes their parameters and summaries to a new table in file.  Returns 1
+/// if memory could not be allocated, 2 if the file could not be written and
+/// 3 for an invalid design or range.
+int ex_run(const extarget *t, const char *file, int design, long long n,
+  long long from, long long to, uint64_t seed, int nthreads){
+
+  exdesign d;
+  FILE *fp;
+  int i, nb, nrec = t->npar + EX_NSUM, err = 0;
+  long long row;
+  double *u;
+  int *gst;
+  float *rec;
+
+  if(from < 0 || to > n || from > to || ex_design(&d, design, n, seed, t->npar)){
+    return 3;
+  }
+  for(i = 0; i < t->npar; i++){
+    if(!(t->lo[i] < t->hi[i]) || (t->scale[i] != EX_LINEAR && t->lo[i] <= 0) ||
+      (t->scale[i] == EX_LOGIT && t->hi[i] >= 1)){
+      return 3;
+    }
+  }
+
+  nthreads = ex_threads(nthreads);
+  u = malloc((size_t)EX_BLOCK*t->npar*sizeof(double));
+  gst = malloc((size_t)EX_BLOCK*(t->nsteps + 1)*sizeof(int));
+  rec = malloc((size_t)EX_BLOCK*nrec*sizeof(float));
+  if(u == NULL || gst == NULL || rec == NULL){
+    free(u);
+    free(gst);
+    free(rec);
+    return 1;
+  }
+  fp = fopen(file, "wb");
+  if(fp == NULL || ex_writeheader(fp, t, &d, from)){
+    err = 2;
+  }
+
+  for(row = from; row < to && !err; row += nb){
+    nb = (to - row < EX_BLOCK) ? (int)(to - row) : EX_BLOCK;
+    for(i = 0; i < nb; i++){
+      ex_point(&d, row + i, u + (size_t)i*t->npar);
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for(i = 0; i < nb; i++){
+      ex_eval(t, u + (size_t)i*t->npar, gst + (size_t)i*(t->nsteps + 1),
+        rec + (size_t)i*nrec);
+    }
+
+    if(fwrite(rec, sizeof(float)*nrec, nb, fp) != (size_t)nb){
+      err = 2;
+    }
+  }
+
+  if(fp != NULL && fclose(fp) != 0){
+    err = 2;
+  }
+  free(u);
+  free(gst);
+  free(rec);
+  return err;
+}
@@ -0,0 +1,267 @@
+/// \file flightrec.c
+/// \brief Saves the frames of a flight recorder (gflightrec) to a replay
+/// file and runs the recorded steps again, one at a time.
+///
+/// A run with a flight recorder keeps the inputs of its last steps and
+/// stops recording at the first failing step, so only runs that failed
+/// need to be written out.  Each frame holds everything growthloop_step()
+/// reads, so flightrec_replay() can repeat that step in isolation, e.g.,
+/// with the trace probes of gtrace.h switched on.
+///
+/// The file is binary: an 8 byte magic string "ACGCAFR", the layout
+/// version, a byte order marker, the number of species parameters and tree
+/// states, the number of frames, the failing step with its errorind and
+/// growth_st, the gparms and Forestparms of the run and the frames, oldest
+/// first.  The growthloop state of a frame is written with
+/// checkpoint_fwrite().
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/checkpoint.h"
+#include "head_files/flightrec.h"
+
+static const char frmagic[8] = "ACGCAFR";
+static const int frendian = 0x01020304;
+
+/// flightrec_count() returns the number of frames kept by rec.
+int flightrec_count(gflightrec *rec){
+	return (rec->n < rec->size) ? rec->n : rec->size;
+}
+
+/// flightrec_frame() returns frame k of rec, 0 being the oldest and
+/// flightrec_count() - 1 the newest (the failing step), or NULL if there is
+/// no frame k.
+gframe *flightrec_frame(gflightrec *rec, int k){
+	int nf = flightrec_count(rec);
+
+	if (k < 0 || k >= nf){
+		return NULL;
+	}
+	return &rec->frame[(rec->n - nf + k) % rec->size];
+}
+
+/// flightrec_write() writes the frames of rec to file.
+///
+/// \param file     name of the file to (over)write
+/// \param gp       gparms of the run
+/// \param fp       forest parameters of the run (NULL for none)
+/// \param rec      flight recorder
+///
+/// Returns 0 on success, 1 if the file could not be opened and 2 if the
+/// write failed.
+///
+int flightrec_write(const char *file, gparms *gp, Forestparms *fp,
+	gflightrec *rec){
+
+	FILE *f;
+	int k, ok=1;
+	int hdr[8], fi[4];
+	double par[7], fd[6];
+	gframe *fr;
+
+	f = fopen(file, "wb");
+	if (f == NULL){
+		return 1;
+	}
+
+	hdr[0] = FLIGHTREC_VERSION;
+	hdr[1] = frendian;
+	hdr[2] = NSPARMS;
+	hdr[3] = NTSTATES;
+	hdr[4] = flightrec_count(rec);
+	hdr[5] = rec->fail;
+	hdr[6] = rec->errorind;
+	hdr[7] = rec->growth_st;
+
+	par[0] = gp->BH; par[1] = gp->deltat; par[2] = gp->T;
+	par[3] = gp->tolerance;
+	par[4] = (fp != NULL) ? fp->kF : 0;
+	par[5] = (fp != NULL) ? fp->intF : 0;
+	par[6] = (fp != NULL) ? fp->slopeF : 0;
+
+	ok = ok && fwrite(frmagic, 1, 8, f) == 8;
+	ok = ok && fwrite(hdr, sizeof(int), 8, f) == 8;
+	ok = ok && fwrite(par, sizeof(double), 7, f) == 7;
+	for (k = 0; k < hdr[4]; k++){
+		fr = flightrec_frame(rec, k);
+		fi[0] = fr->j; fi[1] = fr->ck.growthflag; fi[2] = fr->ck.step;
+		fi[3] = fr->ck.growth_st;
+		fd[0] = fr->ck.dslope; fd[1] = (double) fr->ck.solveiter;
+		fd[2] = fr->Io; fd[3] = fr->Hc; fd[4] = fr->LAIF; fd[5] = fr->drref;
+		ok = ok && fwrite(fi, sizeof(int), 4, f) == 4;
+		ok = ok && fwrite(fd, sizeof(double), 6, f) == 6;
+		ok = ok && checkpoint_fwrite(f, &fr->ck);
+	}
+
+	if (fclose(f) != 0){
+		ok = 0;
+	}
+
+	return (ok ? 0 : 2);
+}
+
+/// flightrec_read() reads a replay file written by flightrec_write().
+///
+/// \param file     name of the replay file
+/// \param gp       returns the gparms of the run
+/// \param fp       returns the forest parameters of the run
+/// \param rec      returns the frames, rec->frame is allocated with malloc()
+///                 and has to be freed by the caller
+///
+/// Returns 0 on success, 1 if the file could not be opened, 2 if it is not a
+/// replay file or is truncated, 3 if it was written by a different version
+/// or on a machine with different byte order and 4 if out of memory.
+///
+int flightrec_read(const char *file, gparms *gp, Forestparms *fp,
+	gflightrec *rec){
+
+	FILE *f;
+	int k, ok=1;
+	int hdr[8], fi[4];
+	double par[7], fd[6];
+	char magic[8];
+	gframe *fr;
+
+	f = fopen(file, "rb");
+	if (f == NULL){
+		return 1;
+	}
+
+	if (fread(magic, 1, 8, f) != 8 || memcmp(magic, frmagic, 8) != 0 ||
+		fread(hdr, sizeof(int), 8, f) != 8 ||
+		fread(par, sizeof(double), 7, f) != 7){
+		fclose(f);
+		return 2;
+	}
+	if (hdr[0] != FLIGHTREC_VERSION || hdr[1] != frendian ||
+		hdr[2] != NSPARMS || hdr[3] != NTSTATES){
+		fclose(f);
+		return 3;
+	}
+	if (hdr[4] < 0){
+		fclose(f);
+		return 2;
+	}
+
+	gp->BH = par[0]; gp->deltat = par[1]; gp->T = par[2];
+	gp->tolerance = par[3];
+	fp->kF = par[4]; fp->intF = par[5]; fp->slopeF = par[6];
+
+	fr = malloc(((hdr[4] > 0) ? hdr[4] : 1)*sizeof(gframe));
+	if (fr == NULL){
+		fclose(f);
+		return 4;
+	}
+	growthloop_recinit(rec, fr, (hdr[4] > 0) ? hdr[4] : 1);
+	rec->n = hdr[4];
+	rec->fail = hdr[5];
+	rec->errorind = hdr[6];
+	rec->growth_st = hdr[7];
+
+	for (k = 0; k < hdr[4] && ok; k++){
+		memset(&fr[k], 0, sizeof(gframe));
+		ok = ok && fread(fi, sizeof(int), 4, f) == 4;
+		ok = ok && fread(fd, sizeof(double), 6, f) == 6;
+		ok = ok && checkpoint_fread(f, &fr[k].ck);
+		fr[k].j = fi[0]; fr[k].ck.growthflag = fi[1]; fr[k].ck.step = fi[2];
+		fr[k].ck.growth_st = fi[3];
+		fr[k].ck.dslope = fd[0]; fr[k].ck.solveiter = (long) fd[1];
+		fr[k].Io = fd[2]; fr[k].Hc = fd[3]; fr[k].LAIF = fd[4];
+		fr[k].drref = fd[5];
+	}
+	fclose(f);
+
+	if (!ok){
+		free(fr);
+		rec->frame = NULL;
+		return 2;
+	}
+
+	return 0;
+}
+
+// 1 if the tree states of a and b are identical.
+static int flightrec_same(gcheckpoint *a, gcheckpoint *b){
+	int k;
+
+	if (a->st.status != b->st.status || a->growthflag != b->growthflag){
+		return 0;
+	}
+	for (k = 0; k < NTSTATES; k++){
+		if (memcmp(TSTATES_REF(&a->st, k), TSTATES_REF(&b->st, k), sizeof(double)) != 0){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/// flightrec_replay() runs the step of frame k of rec again on its own.
+///
+/// \param gp       gparms of the run
+/// \param fp       forest parameters of the run
+/// \param rec      flight recorder
+/// \param k        frame, 0 is the oldest
+/// \param ck       returns the growthloop state after the step
+/// \param out      returns the outputs of the step at index 0 (any array may
+///                 be NULL)
+///
+/// Returns 1 if the step gave the same tree state as recorded in frame k +
+/// 1, or for the failing step the same errorind and growth_st; 0 if not
+/// and -1 if there is no frame k.
+///
+int flightrec_replay(gparms *gp, Forestparms *fp, gflightrec *rec, int k,
+	gcheckpoint *ck, goutput *out){
+
+	gframe *fr = flightrec_frame(rec, k), *next;
+	int plen[NSPARMS], iv[GI_NINT], m;
+	pschedule ps;
+	gforcing forc;
+	goutput o;
+
+	if (fr == NULL){
+		return -1;
+	}
+
+	// The species parameters of the step are already in the frame.
+	memset(&ps, 0, sizeof(pschedule));
+	for (m = 0; m < NSPARMS; m++){
+		plen[m] = 1;
+	}
+	ps.parameterLength = plen;
+
+	forc.Io = &fr->Io;
+	forc.Hc = &fr->Hc;
+	forc.LAIF = &fr->LAIF;
+	forc.ForParms = fp;
+	forc.drref = &fr->drref;
+
+	o = *out;
+	o.ev = NULL;
+	o.fr = NULL;
+	for (m = 0; m < GI_NINT; m++){
+		iv[m] = 0;
+		if (o.iv[m] == NULL){
+			o.iv[m] = &iv[m];
+		}
+	}
+
+	*ck = fr->ck;
+	growthloop_step(gp, ck, &ps, &forc, &o, 0);
+
+	next = flightrec_frame(rec, k + 1);
+	if (next != NULL){
+		return flightrec_same(ck, &next->ck);
+	}
+	if (rec->fail >= 0){
+		return (o.iv[GI_errorind][0] == rec->errorind &&
+			o.iv[GI_growth_st][0] == rec->growth_st);
+	}
+	return 1;
+}
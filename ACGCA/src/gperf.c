@@ -0,0 +1,128 @@
+/// \file gperf.c
+/// \brief Counts instructions, cycles, branch misses and L1 data and last
+/// level cache misses of the calling thread with Linux perf_event_open().
+///
+/// All counters of a thread form one group so they are scheduled together
+/// and one read() returns all of them.  If the kernel has to multiplex the
+/// group with other users of the counters, the counts are scaled up to the
+/// whole time the group was enabled.  Only user space is counted, which
+/// works with the default perf_event_paranoid of 2.  On other systems, or
+/// when no counter can be opened, gperf_open() returns 0 and everything
+/// reads as 0.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "head_files/gperf.h"
+
+#if defined(__linux__) && !defined(ACGCA_NO_PERF)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define GPERF_LINUX
+#endif
+
+const char *gperf_names[GPERF_N] = {
+  "instructions", "cycles", "branchmisses", "L1Dmisses", "LLCmisses"
+};
+
+#ifdef GPERF_LINUX
+// Type and config of each counter
+static const unsigned int gperf_type[GPERF_N] = {
+  PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+  PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+};
+static const unsigned long long gperf_config[GPERF_N] = {
+  PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+  PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+  PERF_COUNT_HW_CACHE_MISSES
+};
+#endif
+
+/// gperf_open() starts the counters of the calling thread.
+///
+/// Returns the counters that could be opened, bit k for counter k (0 if
+/// none).
+int gperf_open(gperf *pc){
+	int k;
+
+	pc->leader = -1;
+	pc->avail = 0;
+	for (k = 0; k < GPERF_N; k++){
+		pc->fd[k] = -1;
+	}
+#ifdef GPERF_LINUX
+	for (k = 0; k < GPERF_N; k++){
+		struct perf_event_attr a;
+		memset(&a, 0, sizeof(a));
+		a.size = sizeof(a);
+		a.type = gperf_type[k];
+		a.config = gperf_config[k];
+		a.exclude_kernel = 1;
+		a.exclude_hv = 1;
+		a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+			PERF_FORMAT_TOTAL_TIME_RUNNING;
+		pc->fd[k] = (int) syscall(SYS_perf_event_open, &a, 0, -1, pc->leader, 0);
+		if (pc->fd[k] < 0){
+			pc->fd[k] = -1;
+			continue;
+		}
+		if (pc->leader < 0){
+			pc->leader = pc->fd[k];
+		}
+		pc->avail |= 1 << k;
+	}
+#endif
+	return pc->avail;
+}
+
+/// gperf_read() returns the counts since gperf_open() in v [GPERF_N], 0 for
+/// counters that are not available.
+void gperf_read(gperf *pc, unsigned long long *v){
+	int k;
+#ifdef GPERF_LINUX
+	unsigned long long buf[3 + GPERF_N];
+	double scale = 1;
+	int m = 0;
+#endif
+
+	for (k = 0; k < GPERF_N; k++){
+		v[k] = 0;
+	}
+#ifdef GPERF_LINUX
+	if (pc->leader < 0 || read(pc->leader, buf, sizeof(buf)) < (ssize_t) (3*sizeof(buf[0]))){
+		return;
+	}
+	// buf: number of counters, time enabled, time running, counts in the
+	// order the counters were opened
+	if (buf[2] > 0 && buf[2] < buf[1]){
+		scale = (double) buf[1] / (double) buf[2];
+	}
+	for (k = 0; k < GPERF_N && m < (int) buf[0]; k++){
+		if (pc->avail & (1 << k)){
+			v[k] = (unsigned long long) (buf[3 + m++] * scale);
+		}
+	}
+#endif
+}
+
+/// gperf_close() stops the counters of pc.
+void gperf_close(gperf *pc){
+	int k;
+
+	for (k = 0; k < GPERF_N; k++){
+#ifdef GPERF_LINUX
+		if (pc->fd[k] >= 0){
+			close(pc->fd[k]);
+		}
+#endif
+		pc->fd[k] = -1;
+	}
+	pc->leader = -1;
+	pc->avail = 0;
+}
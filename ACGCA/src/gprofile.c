@@ -0,0 +1,208 @@
+/// \file gprofile.c
+/// \brief Counts the calls and time of each branch of growthloop_step() and
+/// of the radius solvers, and the transitions between growth states.
+///
+/// The call sites are instrumented with the macros of gprofile.h, which only
+/// call these functions when the package is built with -DACGCA_PROFILE.
+/// The counters are global and updated atomically so runs in parallel
+/// threads (mcmcacgca(), sensacgca(), exploreacgca(), ...) are all counted;
+/// the times of threads running at the same time add up.  Threads that
+/// called gprof_hwstart() also add their hardware counters (gperf.c) to
+/// each branch.
+///
+/// \author Michael Fell
+
+// clock_gettime()
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "head_files/gperf.h"
+#include "head_files/gprofile.h"
+
+#if defined(ACGCA_PROFILE_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define GP_USE_TSC
+#endif
+
+const char *gprof_names[GP_NBRANCH] = {
+  "step", "LAIcalc", "APARcalc", "photosynthesis", "excessgrowingon",
+  "excessgrowingoff", "putonallometry", "rebuildstaticstate",
+  "shrinkingsize", "shrinkingsizeA", "shrinkingsizeB", "egdemand",
+  "podemand"
+};
+
+static unsigned long long gp_calls[GP_NBRANCH];
+static gprof_tick gp_ticks[GP_NBRANCH];
+static unsigned long long gp_trans[GP_NSTATE*GP_NSTATE];
+static unsigned long long gp_hw[GP_NBRANCH*GPERF_N];
+
+#if defined(_MSC_VER)
+#define GP_TLS __declspec(thread)
+#else
+#define GP_TLS __thread
+#endif
+
+// Hardware counters of this thread, counted while gp_hwon is 1
+static GP_TLS gperf gp_pc;
+static GP_TLS int gp_hwon = 0;
+
+/// gprof_now() returns the current time in nanoseconds or TSC cycles.
+gprof_tick gprof_now(void){
+#ifdef GP_USE_TSC
+	return (gprof_tick) __rdtsc();
+#else
+	struct timespec ts;
+#ifdef _WIN32
+	timespec_get(&ts, TIME_UTC);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return (gprof_tick) ts.tv_sec * 1000000000ULL + (gprof_tick) ts.tv_nsec;
+#endif
+}
+
+/// gprof_add() counts a call of branch id that took dt.
+void gprof_add(int id, gprof_tick dt){
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+	gp_calls[id]++;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+	gp_ticks[id] += dt;
+}
+
+/// gprof_begin() marks the start of a profiled branch.
+void gprof_begin(gprof_mark *m){
+	if (gp_hwon){
+		gperf_read(&gp_pc, m->hw);
+	}
+	m->t = gprof_now();
+}
+
+/// gprof_end() counts a call of branch id that started at m.
+void gprof_end(int id, gprof_mark *m){
+	gprof_tick dt = gprof_now() - m->t;
+	unsigned long long hw[GPERF_N];
+	int k;
+
+	gprof_add(id, dt);
+	if (gp_hwon){
+		gperf_read(&gp_pc, hw);
+		for (k = 0; k < GPERF_N; k++){
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+			gp_hw[id*GPERF_N + k] += hw[k] - m->hw[k];
+		}
+	}
+}
+
+// Row or column of a growth_st code in the transition matrix.
+static int gp_state(int growth_st){
+	return (growth_st >= 0 && growth_st <= 6) ? growth_st : GP_NSTATE - 1;
+}
+
+/// gprof_transition() counts a step from growth state from (0 before the
+/// first step) to growth state to.
+void gprof_transition(int from, int to){
+	int k = gp_state(from)*GP_NSTATE + gp_state(to);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+	gp_trans[k]++;
+}
+
+/// gprof_reset() zeroes the counters.  Not to be called while trees are
+/// simulated in other threads.
+void gprof_reset(void){
+	memset(gp_calls, 0, sizeof(gp_calls));
+	memset(gp_ticks, 0, sizeof(gp_ticks));
+	memset(gp_trans, 0, sizeof(gp_trans));
+	memset(gp_hw, 0, sizeof(gp_hw));
+}
+
+/// gprof_read() copies the counters.
+///
+/// \param calls    calls of each branch [GP_NBRANCH]
+/// \param ticks    total time of each branch [GP_NBRANCH]
+/// \param trans    transitions, trans[from*GP_NSTATE + to] [GP_NSTATE^2]
+///
+/// Returns the unit of ticks (GP_NSEC or GP_CYCLES), or -1 if the profiler
+/// is not compiled in.
+int gprof_read(double *calls, double *ticks, double *trans){
+	int k;
+
+	for (k = 0; k < GP_NBRANCH; k++){
+		calls[k] = (double) gp_calls[k];
+		ticks[k] = (double) gp_ticks[k];
+	}
+	for (k = 0; k < GP_NSTATE*GP_NSTATE; k++){
+		trans[k] = (double) gp_trans[k];
+	}
+#if !defined(ACGCA_PROFILE)
+	return -1;
+#elif defined(GP_USE_TSC)
+	return GP_CYCLES;
+#else
+	return GP_NSEC;
+#endif
+}
+
+/// gprof_hwstart() starts the hardware counters of the calling thread (if
+/// they are not running yet), which are then also added to the branches.
+///
+/// Returns the counters available, bit k for counter k of gperf.h.
+int gprof_hwstart(void){
+	if (!gp_hwon){
+		gperf_open(&gp_pc);
+		gp_hwon = 1;
+	}
+	return gp_pc.avail;
+}
+
+/// gprof_hwnow() returns the counts of the calling thread since
+/// gprof_hwstart() in v [GPERF_N].
+void gprof_hwnow(unsigned long long *v){
+	int k;
+
+	if (gp_hwon){
+		gperf_read(&gp_pc, v);
+		return;
+	}
+	for (k = 0; k < GPERF_N; k++){
+		v[k] = 0;
+	}
+}
+
+/// gprof_hwstop() stops the hardware counters of the calling thread.
+void gprof_hwstop(void){
+	if (gp_hwon){
+		gperf_close(&gp_pc);
+		gp_hwon = 0;
+	}
+}
+
+/// gprof_readhw() copies the hardware counts of each branch to hw
+/// [id*GPERF_N + k].
+///
+/// Returns 1 if the branches are profiled (ACGCA_PROFILE), 0 if hw is all 0.
+int gprof_readhw(double *hw){
+	int k;
+
+	for (k = 0; k < GP_NBRANCH*GPERF_N; k++){
+		hw[k] = (double) gp_hw[k];
+	}
+#ifdef ACGCA_PROFILE
+	return 1;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,139 @@
+/// \file growthad.cpp
+/// \brief Forward mode automatic differentiation of the growthloop.
+///
+/// The model sources are compiled a second time here, in namespace acgca_ad
+/// and with greal (misc_growth_funcs.h) a dual number type (dual.h) that
+/// carries the derivatives with respect to up to ACGCA_ADN species
+/// parameters.  The values are the same as those of the double build.  The
+/// radius solvers (excessgrowingon() and putonallometry()) set the
+/// derivatives of their root by the implicit function theorem instead of
+/// differentiating the secant iterations.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "head_files/rprint.h"
+#include "head_files/dual.h"
+#include "head_files/growthad.h"
+
+/// Number of parameters differentiated in one run, more are done in
+/// batches of ACGCA_ADN runs.
+#ifndef ACGCA_ADN
+#define ACGCA_ADN 8
+#endif
+
+namespace acgca_ad {
+
+typedef dualn<ACGCA_ADN> greal;
+#define ACGCA_AD
+#define GVAL(x) gval(x)
+
+#include "misc_growth_funcs.c"
+#include "photosynthesis.c"
+#include "excessgrowing.c"
+#include "putonallometry.c"
+#include "rebuildstaticstate.c"
+#include "shrinkingsize.c"
+#include "growthloop.c"
+
+} // namespace acgca_ad
+
+/// growthad_run() simulates nsteps steps of a tree and returns the outputs
+/// fields (gfield indices) and their derivatives with respect to the npar
+/// constant species parameters park (sparms indices, as in sparms_names).
+///
+/// \param gp2         deltat, T, tolerance and BH
+/// \param forparms    kF, intF and slopeF
+/// \param sparms2     species parameters as packed by runacgca()
+/// \param value       out: value[f*(nsteps+1) + j] is field f at step j
+/// \param grad        out: grad[(f*npar + k)*(nsteps+1) + j] is the
+///                    derivative of field f at step j with respect to
+///                    parameter k
+///
+/// Steps after the death of the tree are 0 as in Rgrowthloop().  Returns the
+/// last step simulated, or -1 if a parameter is not a constant species
+/// parameter, a field does not exist or memory could not be allocated.
+extern "C" int growthad_run(double *gp2, double *r0, int nsteps, double *Io,
+  double *Hc, double *LAIF, double *forparms, double *sparms2,
+  int *startIndex, int *parameterLength, int npar, int *park, int nfield,
+  int *fields, double *value, double *grad){
+
+  using namespace acgca_ad;
+
+  gparms gp;
+  Forestparms ForParms;
+  gforcing f;
+  sparms p;
+  pschedule ps;
+  gcheckpoint ck;
+  goutput out;
+  greal *buf;
+  size_t n = (size_t)nsteps + 1;
+  int b, i, k, t = 0;
+
+  for(k = 0; k < npar; k++){
+    if(park[k] < 0 || park[k] >= NSPARMS || parameterLength[park[k]] != 1){
+      return -1;
+    }
+  }
+  for(i = 0; i < nfield; i++){
+    if(fields[i] < 0 || fields[i] >= GF_NDOUBLE){
+      return -1;
+    }
+  }
+  buf = (greal *)malloc(n*nfield*sizeof(greal));
+  if(buf == NULL){
+    return -1;
+  }
+
+  gp.deltat = gp2[0];
+  gp.T = gp2[1];
+  gp.tolerance = gp2[2];
+  gp.BH = gp2[3];
+  ForParms.kF = forparms[0];
+  ForParms.intF = forparms[1];
+  ForParms.slopeF = forparms[2];
+  f.Io = Io;
+  f.Hc = Hc;
+  f.LAIF = LAIF;
+  f.ForParms = &ForParms;
+  f.drref = NULL;
+  growthloop_unpack(sparms2, startIndex, parameterLength, &p, &ps);
+
+  // One run per batch of ACGCA_ADN parameters (one run if npar is 0)
+  for(b = 0; b == 0 || b < npar; b += ACGCA_ADN){
+    sparms pb = p;
+
+    for(k = b; k < npar && k < b + ACGCA_ADN; k++){
+      greal v = *SPARMS_REF(&pb, park[k]);
+
+      v.d[k - b] = 1;
+      sparms_set(&pb, park[k], v, 0);
+    }
+
+    memset(buf, 0, n*nfield*sizeof(greal));
+    memset(&out, 0, sizeof(goutput));
+    for(i = 0; i < nfield; i++){
+      out.v[fields[i]] = buf + i*n;
+    }
+    growthloop_init(&pb, &gp, r0, &ck);
+    t = growthloop_resume(NULL, &gp, &ck, &ps, &f, &out, nsteps);
+
+    for(i = 0; i < nfield; i++){
+      for(size_t j = 0; j < n; j++){
+        value[i*n + j] = buf[i*n + j].v;
+        for(k = b; k < npar && k < b + ACGCA_ADN; k++){
+          grad[((size_t)i*npar + k)*n + j] = buf[i*n + j].d[k - b];
+        }
+      }
+    }
+  }
+
+  free(buf);
+  return t;
+}
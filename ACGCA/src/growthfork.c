@@ -0,0 +1,73 @@
+/// \file growthfork.c
+/// \brief Scenario branching.  Runs several futures (different light,
+/// gap regimes, or time varying parameters) from one shared tree state so a
+/// common spin-up only has to be simulated once.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/resultstore.h"
+#include "head_files/growthfork.h"
+
+/// growthloop_fork() continues the simulation in ck along nbranch
+/// different futures.  Each branch starts from its own copy of ck so the
+/// branches are independent and run in parallel when OpenMP is available.
+/// Forcing, parameter schedules and outputs are indexed relative to the
+/// checkpoint as in growthloop_resume().
+///
+/// \param gp       Misc. growthmodel parameters (shared by all branches)
+/// \param ck       shared starting state, not modified
+/// \param nbranch  number of branches
+/// \param p        species parameters for each branch
+/// \param ps       time varying parameters for each branch
+/// \param f        light forcing for each branch
+/// \param out      output arrays for each branch
+/// \param nsteps   number of steps to run each branch
+/// \param t        returns the number of steps taken by each branch
+/// \param nthreads number of threads, <= 0 uses the OpenMP default
+/// \param rs       if not NULL each branch is appended to this result store
+///                 as soon as it finishes
+/// \param runid0   run id of branch 0 in the store, branch b gets runid0 + b
+///
+/// Returns -1 if ck was simulated with a different timestep, 1 if a branch
+/// could not be written to the store and 0 otherwise.
+///
+int growthloop_fork(gparms *gp, gcheckpoint *ck, int nbranch,
+	sparms p[], pschedule ps[], gforcing f[], goutput out[], int nsteps,
+	int t[], int nthreads, rstore *rs, long long runid0){
+
+	int b, err = 0;
+
+	if (fabs(ck->deltat - gp->deltat) > 1e-12){
+		return -1;
+	}
+
+#ifdef _OPENMP
+	if (nthreads <= 0){
+		nthreads = omp_get_max_threads();
+	}
+	#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#else
+	(void)nthreads;
+#endif
+	for (b = 0; b < nbranch; b++){
+		gcheckpoint ckb = *ck;
+		t[b] = growthloop_resume(&p[b], gp, &ckb, &ps[b], &f[b], &out[b], nsteps);
+		if (rs != NULL && rstore_append(rs, runid0 + b, t[b] + 1, &out[b]) != 0){
+#ifdef _OPENMP
+			#pragma omp atomic write
+#endif
+			err = 1;
+		}
+	}
+
+	return err;
+}
@@ -22,7 +22,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <R.h>
+#include <string.h>
+#include "head_files/rprint.h"
 
 #include "head_files/misc_growth_funcs.h"
 #include "head_files/excessgrowing.h"
@@ -31,7 +32,692 @@
 #include "head_files/shrinkingsize.h"
 #include "head_files/growthloop.h"
 #include "head_files/photosynthesis.h"
+#include "head_files/gprofile.h"
+#include "head_files/gtrace.h"
+#include "head_files/gmath.h"
+
+const char *gfield_names[GF_NDOUBLE] = {
+  "APARout", "h", "hh", "hC", "hB", "hBH", "r", "rB", "rC", "rBH", "sw",
+  "vts", "vt", "vth", "sa", "la", "ra", "dr", "xa", "bl", "br", "bt", "bts",
+  "bth", "boh", "bos", "bo", "bs", "cs", "clr", "fl", "fr", "ft", "fo", "rfl",
+  "rfr", "rfs", "egrow", "ex", "rtrans", "light", "nut", "deltas", "LAI"
+};
+
+/// Outputs that may be stored in single precision: areas, allocation and
+/// retranslocation fractions and LAI.  Their values are only read, not
+/// differenced over steps like the radii, heights and cumulative biomass,
+/// so the 7 digits of a float are enough.  The model itself always runs in
+/// double.
+const int gfield_single[GF_NDOUBLE] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // APARout to sw
+  0, 0, 0, 1, 1, 1, 0, 1, 0, 0, 0, 0,  // vts to bts
+  0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1,  // bth to rfl
+  1, 1, 0, 0, 0, 0, 1, 1, 1            // rfr to LAI
+};
+
+const char *gifield_names[GI_NINT] = {
+  "status", "errorind", "growth_st"
+};
+
+/// growthloop_init() initializes the tree states and the rest of the
+/// growthloop state for a new tree.
+///
+/// \param p        species specific parameters (sparms)
+/// \param gp       Misc. growthmodel parameters
+/// \param r0       initial radius
+/// \param ck       returns the state at step 0
+///
+void growthloop_init(sparms *p, gparms *gp, double *r0, gcheckpoint *ck){
+
+	// Zero everything first so states initialize() does not set (light,
+	// egrow, ...) and any struct padding are defined in the checkpoint.
+	memset(ck, 0, sizeof(gcheckpoint));
+	ck->p = *p;
+
+	//Initialze the state variables.  Returns the state structure st.
+	initialize(&ck->p,gp,&ck->st,r0);
+
+	// growthflag is used to select which function call is used. growthflag=1 when
+	// tree is currently on target allometry (so excessgrowingon() is called below)
+	// growthflag =0 when tree is off target allometry (other functions are called).
+	ck->growthflag=1;  // tree starts on target
+	ck->step=0;
+	ck->deltat=gp->deltat;
+
+	// The radius history starts at the initial radius (same as initial radius
+	// in r[0] and r[1] in the original arrays).
+	ck->rhist[0]=ck->rhist[1]=ck->st.r;
+
+	//Compute the LAI of the tree canopy (initially)
+	LAIcalc(&ck->LAI, &ck->LA, ck->st.la,  ck->st.r, ck->st.h, ck->st.rBH, &ck->p, gp, -99, &ck->st);  //0 is Hc=0
+}
+
+// Stores x at index j of output k, as float if only out->f[k] is set.
+#define GSTORE(k, x) \
+	if (v[k]) v[k][j] = (x); \
+	else if (f[k]) f[k][j] = (float) GVAL(x)
+
+/// growthloop_store() copies the current state into index j of the output
+/// arrays.  NULL arrays are skipped.
+///
+/// \param ck       growthloop state
+/// \param gp       Misc. growthmodel parameters
+/// \param out      output arrays
+/// \param j        index to store at
+///
+void growthloop_store(gcheckpoint *ck, gparms *gp, goutput *out, int j){
+	tstates *st = &ck->st;
+	greal **v = out->v;
+	float **f = out->f;
+
+	GSTORE(GF_h, st->h);
+	GSTORE(GF_hh, st->hh);
+	GSTORE(GF_hC, st->hh);
+	//hB2[i]=st.hB; //double
+	GSTORE(GF_hB, st->h * ck->p.etaB);
+	//hBH2[i]=st.hBH; //double
+	GSTORE(GF_hBH, gp->BH);
+	GSTORE(GF_r, st->r);
+	GSTORE(GF_rB, st->rB);
+	GSTORE(GF_rC, st->rC);
+	GSTORE(GF_rBH, st->rBH);
+	GSTORE(GF_sw, st->sw);
+	GSTORE(GF_vts, st->vts);
+	GSTORE(GF_vt, st->vt);
+	GSTORE(GF_vth, st->vth);
+	GSTORE(GF_sa, st->sa);
+	GSTORE(GF_la, st->la);
+	GSTORE(GF_ra, st->ra);
+	GSTORE(GF_dr, st->dr);
+	GSTORE(GF_xa, st->xa);
+	GSTORE(GF_bl, st->bl);
+	GSTORE(GF_br, st->br);
+	GSTORE(GF_bt, st->bt);
+	GSTORE(GF_bts, st->bts);
+	GSTORE(GF_bth, st->bth);
+	GSTORE(GF_boh, st->boh);
+	GSTORE(GF_bos, st->bos);
+	GSTORE(GF_bo, st->bo);
+	GSTORE(GF_bs, st->bs);
+
+	GSTORE(GF_cs, st->cs);
+	GSTORE(GF_clr, st->clr);
+	GSTORE(GF_fl, st->fl);
+	GSTORE(GF_fr, st->fr);
+	GSTORE(GF_ft, st->ft);
+	GSTORE(GF_fo, st->fo);
+	GSTORE(GF_rfl, st->rfl);
+	GSTORE(GF_rfr, st->rfr);
+	GSTORE(GF_rfs, st->rfs);
+
+	GSTORE(GF_egrow, st->egrow);
+	GSTORE(GF_ex, st->ex);
+	GSTORE(GF_rtrans, st->rtrans);
+	GSTORE(GF_light, st->light);
+	GSTORE(GF_nut, st->nut);
+	GSTORE(GF_deltas, st->deltas);
+	//LAI2[i]=st.LAI; //double
+	GSTORE(GF_LAI, ck->LAI.tot);
+	//APARout[i]=APAR[0];
+	GSTORE(GF_APAR, st->light);
+	if(out->iv[GI_status]) out->iv[GI_status][j]=st->status;
+}
+
+/// growthloop_eventinit() empties an event log.
+void growthloop_eventinit(geventlog *ev){
+	memset(ev, 0, sizeof(geventlog));
+	ev->first=-1;
+}
+
+// Adds an occurrence in step j of the event kind, code to the log.
+static void growthloop_eventadd(geventlog *ev, int kind, int code, int j){
+	int k;
+
+	for (k = 0; k < ev->nevent; k++){
+		if (ev->event[k].kind == kind && ev->event[k].code == code){
+			ev->event[k].count++;
+			ev->event[k].last=j;
+			return;
+		}
+	}
+	if (ev->nevent == EV_NEVENT){
+		ev->lost++;
+		return;
+	}
+	ev->event[k].kind=kind;
+	ev->event[k].code=code;
+	ev->event[k].count=1;
+	ev->event[k].first=ev->event[k].last=j;
+	ev->nevent++;
+}
+
+/// growthloop_event() adds step j with the given errorind and growth_st to
+/// an event log.  Each bit of errorind and each growth_st other than 0 to 6
+/// is an event.
+///
+/// Returns 1 if j is the first step with an event (the caller sets
+/// ev->snap), 0 otherwise.
+///
+int growthloop_event(geventlog *ev, int j, int errorind, int growth_st){
+	int b, isst = (growth_st >= 0 && growth_st <= 6);
+
+	ev->nstate[isst ? growth_st : EV_NSTATE-1]++;
+	if (errorind == 0 && isst){
+		return 0;
+	}
+
+	ev->mask |= errorind;
+	for (b = 0; b < 31; b++){
+		if (errorind & (1 << b)){
+			growthloop_eventadd(ev, EV_ERRORIND, 1 << b, j);
+		}
+	}
+	if (!isst){
+		growthloop_eventadd(ev, EV_GROWTHST, growth_st, j);
+	}
+	if (ev->first >= 0){
+		return 0;
+	}
+	ev->first=j;
+	ev->firsterr=errorind;
+	ev->firstst=growth_st;
+	return 1;
+}
+
+/// growthloop_eventscan() builds the event log of steps 1 to t of a run
+/// from its output arrays, e.g., for a run taken from the result cache.
+/// errorind and growth_st have to be set, outputs that are NULL are 0 in
+/// ev->snap.
+void growthloop_eventscan(goutput *out, int t, geventlog *ev){
+	int j, k;
+
+	growthloop_eventinit(ev);
+	for (j = 1; j <= t; j++){
+		if (growthloop_event(ev, j, out->iv[GI_errorind][j], out->iv[GI_growth_st][j])){
+			for (k = 0; k < GF_NDOUBLE; k++){
+				ev->snap[k] = GOUT_VAL(out, k, j);
+			}
+		}
+	}
+}
+
+/// growthloop_recinit() empties a flight recorder keeping the last size
+/// steps in frame.
+void growthloop_recinit(gflightrec *rec, gframe *frame, int size){
+	rec->frame=frame;
+	rec->size=size;
+	rec->n=0;
+	rec->fail=-1;
+	rec->errorind=0;
+	rec->growth_st=0;
+}
+
+// Keeps the inputs of step j in the flight recorder of out (if any) until
+// a step failed.
+static void growthloop_record(gcheckpoint *ck, gforcing *f, goutput *out,
+	int j){
+
+	gflightrec *rec = out->fr;
+	gframe *fr;
+
+	if (rec == NULL || rec->fail >= 0){
+		return;
+	}
+	fr = &rec->frame[rec->n % rec->size];
+	fr->ck=*ck;
+	fr->j=j;
+	fr->Io=f->Io[j];
+	fr->Hc=f->Hc[j];
+	fr->LAIF=f->LAIF[j];
+	fr->drref=(f->drref != NULL) ? f->drref[j] : 0;
+	rec->n++;
+}
+
+// Adds step j to the event log of out (if any), with the state after the
+// step as the snapshot of the first event, and stops the flight recorder
+// (if any) at the first failing step.
+static void growthloop_log(gcheckpoint *ck, gparms *gp, goutput *out, int j,
+	int errorind, int growth_st){
+
+	goutput snap;
+	int k;
+
+	if (out->fr != NULL && out->fr->fail < 0 &&
+		(errorind != 0 || growth_st < 0 || growth_st > 6)){
+		out->fr->fail=j;
+		out->fr->errorind=errorind;
+		out->fr->growth_st=growth_st;
+	}
+	if (out->ev == NULL || !growthloop_event(out->ev, j, errorind, growth_st)){
+		return;
+	}
+	memset(&snap, 0, sizeof(goutput));
+	for (k = 0; k < GF_NDOUBLE; k++){
+		snap.v[k] = &out->ev->snap[k];
+	}
+	growthloop_store(ck, gp, &snap, 0);
+}
+
+/// growthloop_step() advances the tree by one timestep.  This is the body of
+/// the main loop of the growthloop.  Calls: excessgrowingon/off() in
+/// excessgrowing.c, putonallometry() in putonallometry.c,
+/// rebuildingstaticstate() in rebuildingstaticstate.c, and shrinkingsize() in
+/// shrinkingsize.c and LAIcalc() in misc_growth_funcs.c.
+///
+/// \param gp       Misc. growthmodel parameters
+/// \param ck       growthloop state, updated in place
+/// \param ps       time varying species parameters
+/// \param f        light forcing
+/// \param out      output arrays
+/// \param j        index of this step into ps, f and out
+///
+/// Returns 1 if the tree is dead and the loop should stop, 0 otherwise.
+///
+int growthloop_step(gparms *gp, gcheckpoint *ck, pschedule *ps,
+	gforcing *f, goutput *out, int j){
+
+	tstates *st = &ck->st;
+	sparms *p = &ck->p;
+	LAindex *LAI = &ck->LAI;
+	Larea *LA = &ck->LA;
+
+	// structure for rebuildstaticstate()
+	rebuild rebld;
+
+	// structure for putonallometry()
+	puton pton;
+
+	// Below are local variables for growthloop().
+	greal rm,bsstar,pg,rhow,deltaw, f_abs; // Removed 3/16/18 add 4/4/18
+
+	// Per step error indicator and growth state.  These are kept locally so
+	// the output arrays can be left out.
+	int errorind=0, growth_st=0;
+
+	// Warm start of the radius solvers
+	double warm[2] = {(f->drref != NULL) ? f->drref[j] : 0, ck->dslope};
+
+	// i is the step count since initialization, used by the solvers
+	int i = ck->step + 1;
+
+	GPROF_BEGIN(gp_step);
+	GTRACE_STEP(i);
+
+	// this updates the vector p if the length of a parameter is > 1
+	updateSparms(
+		j,
+		p,
+		ps->parameterLength,
+		ps->hmax,
+		ps->phih,
+		ps->eta,
+		ps->swmax,
+		ps->lamdas,
+		ps->lamdah,
+		ps->rhomax,
+		ps->rhomin,
+		ps->f2,
+		ps->f1,
+		ps->gammac,
+		ps->gammaw,
+		ps->gammax,
+		ps->cgl,
+		ps->cgr,
+		ps->cgw,
+		ps->deltal,
+		ps->deltar,
+		ps->sl,
+		ps->sla,
+		ps->sr,
+		ps->so,
+		ps->rr,
+		ps->rhor,
+		ps->rml,
+		ps->rms,
+		ps->rmr,
+		ps->etaB,
+		ps->k,
+		ps->epsg,
+		ps->M,
+		ps->alpha,
+		ps->R0,
+		ps->R40
+	);
+	growthloop_record(ck, f, out, j);
+
+	greal APAR[2];
+	APAR[0] = -1;
+	APAR[1] = -1;
+
+	// MKF moved this to the top of the loop to prevent LAI->bot == 0
+	GPROF_CALL(GP_LAIcalc,
+		LAIcalc(LAI,LA, st->la, st->r, st->h, st->rBH, p, gp, f->Hc[j], st));
+	  // If tree died last iteration, then exit program.
+	  //if (st.status==0){
+		//    growth_st[i]=6;
+		//    break;
+		//}
+
+	   // If r = 0 then exit program the tree is dead
+	   // Check for possible division by zero, negative areas, etc.
+	   if ((st->vts <= 0) || (st->bts == 0) || (p->gammax == 1) || (p->gammaw == 0) ||
+			(LAI->tot == 0) || ((1.0+st->deltas)*st->bos*gp->deltat == 0) || ((p->f2*st->sa) <= 0) ||
+			(p->sla <= 0) || (st->bs == 0)){
+			st->status=0;
+			if(out->iv[GI_growth_st]) out->iv[GI_growth_st][j]=6;
+			if(out->iv[GI_status]) out->iv[GI_status][j]=st->status;
+			GTRACE(GT_branch, 6, st->ex, 0, 0);
+			GPROF_TRANSITION(ck->growth_st, 6);
+			ck->growth_st=6;
+			growthloop_log(ck, gp, out, j, 0, 6);
+			GPROF_END(GP_step, gp_step);
+			return 1;
+		}
+	   // If miniscule amount of labile C and tissues (i.e., less than 0.01 cm2 of
+	   // leaf area and equivalent bos), tree dies. Use this for "established" trees
+	   // with r > 0.1 m.
+	   if ((st->r>=0.1) && (st->bos<(p->lamdas*st->bts/(1000000*p->f2*st->sa))) &&
+			(st->bl<(1/(p->sla*1000000))) && (st->cs<=0)){
+			st->status=0;
+			if(out->iv[GI_growth_st]) out->iv[GI_growth_st][j]=6;
+			if(out->iv[GI_status]) out->iv[GI_status][j]=st->status;
+			GTRACE(GT_branch, 6, st->ex, 0, 0);
+			GPROF_TRANSITION(ck->growth_st, 6);
+			ck->growth_st=6;
+			growthloop_log(ck, gp, out, j, 0, 6);
+			GPROF_END(GP_step, gp_step);
+			return 1;
+		}
+
+	// Define light as the total annual amount of absorbed radiation (i.e.,
+	// APAR). Compute total PAR absorbed by canopy as incident PAR above
+	// canopy (Io) * fraction of PAR absorbed (f_abs) * Canopy area
+
+	// mkf 3/16/2018 f_abs = fmin(1,fmax(0,(1-exp(-p->K*LAI.tot))));
+	f_abs = fminmacro(1,fmaxmacro(0,(1-gexp(-p->K*LAI->tot))));
+
+	// update light value
+	if(f->Hc[j] != -99){
+		// APAR should be a vector of length 2
+		GPROF_CALL(GP_APARcalc,
+			APARcalc(&APAR[0], LAI, LA, p->eta, p->K, st->h, f->Hc[j], f->LAIF[j], f->Io[j], f->ForParms));
+		st->light = APAR[0];
+		//APARout[i] = APAR[1]; Moved to bottom
+	}else{
+		st->light = f->Io[j]*f_abs*(st->la/LAI->tot);
+	}
+	// mkf 3/16/2018 st.light = Io[i]*f_abs*(st.la/LAI.tot); // 138b in appendix for Scn. A
+
+	// Determine labile carbon needed to bring all tissues in-line with target allometry (ea),
+	// and labile carbon needed to rebuild all senescesed tissues (erb):
+	st->deltas=fmaxmacro(0,st->cs/st->bs);
+
+	// BELOW: revised version, accounts for relative amounts or woody vs. "living" tissue.
+	// First, respiring sapwood due to base-line "structural" biomass of living cells:
+
+	bsstar = (1-p->gammaw*st->bts/((1-p->gammax)*st->vts))*st->bs;
+	if ((p->gammac > 0) && (st->cs > 0)){
+		// respiring sapwood also due to cells with labile carbon:
+		bsstar = bsstar + (1-p->gammaw*st->bts/((1-p->gammax)*st->vts))*((st->cs/p->gammac)*(st->bts/st->vts));
+	}
+
+	rm=p->rml*st->bl+p->rmr*st->br+p->rms*bsstar;
+
+	// Revised photosynthesis model based on radiation-use efficiency model:
+	//pg=p->epsg*st.light;   //pg is intermediate variable
+	GPROF_CALL(GP_photosynthesis, pg=photosynthesis(p, st));
+	// update excess carbon (st.ex).
+	st->ex=pg-rm+p->deltal*p->sl*st->bl+p->deltar*p->sr*st->br+st->deltas*p->so*st->bos;
+	GTRACE(GT_carbon, 0, pg, rm, st->ex);
+
+	rhow=st->bts/st->vts;   //intermediate variable
+		  if (rhow > ((1-p->gammax)/p->gammaw)*exp(10)/(1+exp(10))){
+			// if wood density is very close to upper limit (given by deltaw=0), set
+			// carbon storage capacity to zero to avoid rounding and computational errors.
+			deltaw=0;
+		  }
+		  else{
+			deltaw=p->gammac*(1.0-p->gammax-p->gammaw*rhow)/rhow;
+		  }
+
+	//used in putonallometry()
+	pton.nuoa=((p->so*gp->deltat-1.0)*st->boh+p->lamdah*st->bth)/((1.0+st->deltas)*st->bos*gp->deltat);
+	if (pton.nuoa<0.0){
+	  pton.nuoa=0.0;
+	}
+
+	//These are used in putonallometry()
+	pton.eo=((p->cgw+deltaw)*(((p->so+pton.nuoa)*gp->deltat-1.0)*st->bos+p->lamdas*st->bts))/gp->deltat;
+	pton.el=((p->cgl+p->deltal)*(p->sla*(p->sl*gp->deltat-1.0)*st->bl+p->f2*st->sa))/(p->sla*gp->deltat);
+	pton.er=((p->cgr+p->deltar)*(2.0*(p->sr*gp->deltat-1.0)*st->br+p->f1*p->f2*p->rr*p->rhor*st->sa))/(2.0*gp->deltat);
+	pton.ea=pton.eo+pton.el+pton.er;
+
+	//These are used in rebuildstaticstate()
+	rebld.nuoerb=p->so*st->boh/((1.0+st->deltas)*st->bos);
+	rebld.elerb=(p->cgl+p->deltal)*p->sl*st->bl;
+	rebld.ererb=(p->cgr+p->deltar)*p->sr*st->br;//gp->T;//Modified 2/20/18
+	rebld.eoerb=(p->cgw+deltaw)*(p->so+rebld.nuoerb)*st->bos;
+	rebld.erb=rebld.elerb+rebld.ererb+rebld.eoerb;
+
+	if ((pton.ea<st->ex) && (pton.ea>0.0)){      // enough labile C to grow tree along target allometry.
+	  if (ck->growthflag==0){       // tree currently off target allometry.
+			GPROF_CALL(GP_putonallometry,
+				ck->solveiter+=putonallometry(st,p,gp,&pton,i,deltaw,warm));  //make deltaw *deltaw
+			ck->growthflag=1;
+			if(st->status==1){
+			  growth_st=3;
+			}else if(st->status==0){
+			  growth_st=6;
+			}else{
+			  growth_st=-999;
+			}
+	  }
+	  else{ // not enough labile C to grow tree on target allometry.
+		//MKF 04/20/2013 I added errorind to excessgrowing on to catch errors
+		//excessgrowingon(p,gp,&st,i,growthflag,r, &errorind[i], &growth_st[i],
+  //                tolout, errorout, drout, demandout, odemandout, odrout);
+	  GPROF_CALL(GP_excessgrowingon,
+		ck->solveiter+=excessgrowingon(p,gp,st,i,ck->growthflag,ck->rhist,warm,
+		  &errorind, &growth_st));
+		ck->growthflag=1;
+		//if(growth_st[i]==0){growth_st[i]=1;}
+		growth_st=1;
+		if (st->nut > 1){ // This is legacy code but I left it MKF
+		  //st.status=0;
+		  //getchar();
+		}
+	  } //end else
+	} // end if ((pton.ea<st.ex) && ...
+	else{       // not enough labile C to grow tree on target allometry.
+	  // TODO: put rebld updates here since they are only used here.
+	  // This is a legacy comment from Darren I don't think anything needs
+	  // to be done. MKF
+	  ck->growthflag=0;
+	  if (rebld.erb<st->ex){     // enough labile C to growth tree along reduced allometry.
+			GPROF_CALL(GP_excessgrowingoff,
+				excessgrowingoff(p,gp,st,i,deltaw,&errorind, &growth_st));
+			if(growth_st==0){growth_st=2;}
+	  }
+	  else{
+		if ((rebld.erb-st->ex) < (st->cs/gp->deltat - st->deltas*(rebld.nuoerb+p->so)*st->bos)){    // enough labile C to rebuild non-trunk tissues.
+		  GPROF_CALL(GP_rebuildstaticstate,
+			rebuildstaticstate(p,st,gp,&rebld,i,deltaw));
+		  if(st->status==1){
+			growth_st=4;
+		  }else if(st->status==0){
+			growth_st=6;
+		  }else{
+			growth_st=-999;
+		  }
+		}
+		else{           // Not enough labile C to rebuild tissues, non-trunk compartments shrinking in size.
+		  greal pnet=pg-rm;  //used in shrinking size
+		  GPROF_CALL(GP_shrinkingsize,
+			shrinkingsize(p,gp,st,i,&deltaw,&pnet));
+		  if(st->status==1){
+			growth_st=5;
+		  }else if(st->status==0){
+			growth_st=6;
+		  }else{
+			growth_st=-999;
+		  }
+		}
+	  }
+	} // end outer else
+
+	ck->dslope=warm[1];
+
+	/* update the radius history used by excessgrowingon() */
+	ck->rhist[1]=ck->rhist[0];
+	ck->rhist[0]=st->r;
+	ck->step=i;
+
+	/* Recalculate st.light */
+
+	// Added if statement on 4/2/18 MKF
+	//LAIcalc(&LAI,&LA, st.la, st.r, st.h, st.rBH, p, gp, Hc[i], &st);
+	//if(st.status!=1){
+	//  st.light = 0;
+	//}
+
+
+	if (isnan(st->ex) !=0){
+	  errorind = errorind | 1;
+	  //getchar(); // keep
+	}
+	if ((st->r<=0) || ( st->h<=0) || (st->rBH<=0) || (isnan(st->r) !=0) || (isnan(st->h) !=0)){
+	  //getchar(); // keep
+	  errorind = errorind | 2;
+	}
+
+	if (errorind) GTRACE(GT_error, errorind, st->r, st->h, st->ex);
+	GTRACE(GT_branch, growth_st, st->ex, pton.ea, rebld.erb);
+
+	growthloop_store(ck, gp, out, j);
+	if(out->iv[GI_errorind]) out->iv[GI_errorind][j]=errorind;
+	if(out->iv[GI_growth_st]) out->iv[GI_growth_st][j]=growth_st;
 
+	growthloop_log(ck, gp, out, j, errorind, growth_st);
+	GPROF_TRANSITION(ck->growth_st, growth_st);
+	ck->growth_st=growth_st;
+	GPROF_END(GP_step, gp_step);
+
+	//Break the loop right away if status is 0
+	return (st->status == 0);
+}
+
+/// growthloop_run() runs nsteps steps of the growthloop starting from the
+/// state in ck.  Output index 0 is not written; step j is stored at index j.
+///
+/// Returns the number of steps taken (less than nsteps if the tree died).
+///
+int growthloop_run(gparms *gp, gcheckpoint *ck, pschedule *ps,
+	gforcing *f, goutput *out, int nsteps){
+
+	int j;
+
+	for (j = 1; j <= nsteps; j++){
+		if(growthloop_step(gp, ck, ps, f, out, j)){
+			break;
+		}
+	}
+
+	return ((j > nsteps) ? nsteps : j);
+}
+
+/// growthloop_resume() continues a simulation from a checkpoint.  The state
+/// at the checkpoint is stored at index 0 and the following nsteps steps at
+/// indices 1 to nsteps.  The forcing and time varying parameters are indexed
+/// the same way, i.e., relative to the checkpoint.
+///
+/// \param p        species parameters to use from here on.  NULL keeps the
+///                 parameters saved in the checkpoint.
+/// \param ck       checkpoint, updated in place to the final state
+///
+/// Returns -1 if the checkpoint was simulated with a different timestep,
+/// otherwise the number of steps taken.
+///
+int growthloop_resume(sparms *p, gparms *gp, gcheckpoint *ck,
+	pschedule *ps, gforcing *f, goutput *out, int nsteps){
+
+	if (fabs(ck->deltat - gp->deltat) > 1e-12){
+		return -1;
+	}
+	if (p != NULL){
+		ck->p = *p;
+	}
+
+	growthloop_store(ck, gp, out, 0);
+	if(out->iv[GI_growth_st]) out->iv[GI_growth_st][0]=0;
+
+	// A tree that was already dead at the checkpoint does not grow.
+	if (ck->st.status == 0){
+		return 0;
+	}
+
+	return growthloop_run(gp, ck, ps, f, out, nsteps);
+}
+
+/// growthloop_unpack() sets the species parameters and the parameter
+/// schedule from the packed parameter vector built by runacgca() (see
+/// Rgrowthloop()).  The schedule points into sparms2 so nothing is copied
+/// and sparms2 has to outlive ps.
+///
+/// \param sparms2          packed parameters in the order of sparms_names
+/// \param startIndex       start of parameter k in sparms2
+/// \param parameterLength  length of parameter k (1 or steps*years+1)
+/// \param p                returns the parameters at step 0
+/// \param ps               returns the time varying parameters
+///
+void growthloop_unpack(double *sparms2, int *startIndex,
+	int *parameterLength, sparms *p, pschedule *ps){
+
+	int k;
+
+	for (k = 0; k < NSPARMS; k++){
+		*SPARMS_REF(p, k) = sparms2[startIndex[k]];
+	}
+
+	ps->hmax = sparms2 + startIndex[0];
+	ps->phih = sparms2 + startIndex[1];
+	ps->eta = sparms2 + startIndex[2];
+	ps->swmax = sparms2 + startIndex[3];
+	ps->lamdas = sparms2 + startIndex[4];
+	ps->lamdah = sparms2 + startIndex[5];
+	ps->rhomax = sparms2 + startIndex[6];
+	ps->f2 = sparms2 + startIndex[7];
+	ps->f1 = sparms2 + startIndex[8];
+	ps->gammac = sparms2 + startIndex[9];
+	ps->gammax = sparms2 + startIndex[10];
+	ps->cgl = sparms2 + startIndex[11];
+	ps->cgr = sparms2 + startIndex[12];
+	ps->cgw = sparms2 + startIndex[13];
+	ps->deltal = sparms2 + startIndex[14];
+	ps->deltar = sparms2 + startIndex[15];
+	ps->sl = sparms2 + startIndex[16];
+	ps->sla = sparms2 + startIndex[17];
+	ps->sr = sparms2 + startIndex[18];
+	ps->so = sparms2 + startIndex[19];
+	ps->rr = sparms2 + startIndex[20];
+	ps->rhor = sparms2 + startIndex[21];
+	ps->rml = sparms2 + startIndex[22];
+	ps->rms = sparms2 + startIndex[23];
+	ps->rmr = sparms2 + startIndex[24];
+	ps->etaB = sparms2 + startIndex[25];
+	ps->k = sparms2 + startIndex[26];
+	ps->epsg = sparms2 + startIndex[27];
+	ps->M = sparms2 + startIndex[28];
+	ps->alpha = sparms2 + startIndex[29];
+	ps->R0 = sparms2 + startIndex[30];
+	ps->R40 = sparms2 + startIndex[31];
+	ps->rhomin = sparms2 + startIndex[32];
+	ps->gammaw = sparms2 + startIndex[33];
+	ps->parameterLength = parameterLength;
+}
+
+// The wrapper over the arrays of Rgrowthloop() is only built with double
+// (not in growthad.cpp)
+#ifndef ACGCA_AD
 /// growthloop() calls: excessgrowingon/off() in excessgrowing.c, putonallometry()
 /// in putonallometry.c,
 /// rebuildingstaticstate() in rebuildingstaticstate.c, and shrinkingsize() in
@@ -43,6 +729,9 @@
 /// \param r        array of tree radii (at base, indexed by iteration, not by year)
 /// \param h        array of tree heights
 /// \param *t       last alive iteration
+/// \param ckin     if not NULL the run continues from this checkpoint instead
+///                 of initializing a tree of radius r0
+/// \param ckout    if not NULL returns the state at the end of the run
 ///
 /// Returns update st (state variables).  Calls on functions trunkradii() and
 /// trunkvolume().
@@ -139,469 +828,68 @@ void growthloop(sparms *p, gparms *gp, double *Io, double *r0, int *t,
 	double alpha[],
 	double R0[],
 	double R40[],
-	int parameterLength[]
+	int parameterLength[],
+	gcheckpoint *ckin,
+	gcheckpoint *ckout,
+	gflightrec *rec
   //int sparms_indicator[]
   //double *tolout,
   //double *errorout,
   //double *drout,
   //double *demandout,
   //double *odemandout,
-  //double *odrout                  
+  //double *odrout
 ){
 
-	//, double la[],double LAI[], double egrow[], double ex[], int status[]
-	// state variables
-	tstates st;
-
-	// structure for rebuildstaticstate()
-	rebuild rebld;
-
-	// structure for putonallometry()
-	puton pton;
-
-	// Below are local variables for growthloop().
-	double rm,bsstar,pg,rhow,deltaw, f_abs; // Removed 3/16/18 add 4/4/18
-
-	// growthflag is used to select which function call is used. growthflag=1 when
-	// tree is currently on target allometry (so excessgrowingon() is called below)
-	// growthflag =0 when tree is off target allometry (other functions are called).
-	// i is the index for the growthloop
-	int i,growthflag=1;  // tree starts on target
-
-	// Leaf area index and leaf area.  Only used in LAIcalc().
-	LAindex LAI;
-	Larea LA;
+	// growthloop state (tree states, growthflag, radius history, ...)
+	gcheckpoint ck;
 
-	//Initialze the state variables.  Returns the state structure st.
-	initialize(p,gp,&st,r0);
-	//printf(" Initialize complete=%d \n",i);
-
-	//Initialize the radius and height arrays to be returned (needed in the MCMC)
-	r[0]=r[1]=st.r;  //same as initial radius
-	h[0]=h[1]=st.h;
-	rBH[0]=rBH[1]=st.rBH;
-
-	//if(*iout > 0){
-	//	r[(*lenvars * *iout) + *iout]=r[(*lenvars * *iout) + *iout + 1]=st.r;  //same as initial radius
-	//	h[(*lenvars * *iout) + *iout]=h[(*lenvars * *iout) + *iout + 1]=st.h;
-	//	rBH[(*lenvars * *iout) + *iout]=rBH[(*lenvars * *iout) + *iout + 1]=st.rBH;
-	//}
+	goutput out = {
+		{APARout, h, hh2, hC2, hB2, hBH2, r, rB2, rC2, rBH, sw2, vts2, vt2,
+		vth2, sa2, la2, ra2, dr2, xa2, bl2, br2, bt2, bts2, bth2, boh2, bos2,
+		bo2, bs2, cs2, clr2, fl2, fr2, ft2, fo2, rfl2, rfr2, rfs2, egrow2,
+		ex2, rtrans2, light2, nut2, deltas2, LAI2},
+		{status2, errorind, growth_st},
+		NULL, rec
+	};
 
-	//Compute the LAI of the tree canopy (initially)
-	LAIcalc(&LAI, &LA, st.la,  st.r, st.h, st.rBH, p, gp, -99, &st);  //0 is Hc=0
-
-	// Store the initial variable states at index 0 (index 1 in R)
-	hh2[0]=st.hh; //double
-	hC2[0]=st.hh; //double
-	//hB2[0]=st.hB; //double
-	hB2[0]=st.h * p->etaB;
-	//hBH2[0]=st.hBH; //double
-	hBH2[0]=gp->BH; //double 
-	rB2[0]=st.rB; //double
-	rC2[0]=st.rC; //double
-	sw2[0]=st.sw; //double
-	vts2[0]=st.vts; //double
-	vt2[0]=st.vt; //double
-	vth2[0]=st.vth; //double
-	sa2[0]=st.sa; //double
-	la2[0]=st.la; //double
-	ra2[0]=st.ra; //double
-	dr2[0]=st.dr; //double
-	xa2[0]=st.xa; //double
-	bl2[0]=st.bl; //double
-	br2[0]=st.br; //double
-	bt2[0]=st.bt; //double
-	bts2[0]=st.bts; //double
-	bth2[0]=st.bth; //double
-	boh2[0]=st.boh; //double
-	bos2[0]=st.bos; //double
-	bo2[0]=st.bo; //double
-	bs2[0]=st.bs; //double
-
-	cs2[0]=st.cs; //double
-	clr2[0]=st.clr; //double
-	fl2[0]=st.fl; //double
-	fr2[0]=st.fr; //double
-	ft2[0]=st.ft; //double
-	fo2[0]=st.fo; //double
-	rfl2[0]=st.rfl; //double
-	rfr2[0]=st.rfr; //double
-	rfs2[0]=st.rfs;  //double
-
-	egrow2[0]=st.egrow;  //double
-	ex2[0]=st.ex;  //double
-	rtrans2[0]=st.rtrans; //double
-	light2[0]=st.light; //double
-	nut2[0]=st.nut; //double
-	deltas2[0]=st.deltas; //double
-	//LAI2[i]=st.LAI; //double
-	LAI2[0]=LAI.tot;
-	status2[0]=st.status; //int
-	growth_st[0]=0;
-	APARout[0]=0;
+	pschedule ps = {hmax, phih, eta, swmax, lamdas, lamdah, rhomax, rhomin,
+		f2, f1, gammac, gammaw, gammax, cgl, cgr, cgw, deltal, deltar, sl,
+		sla, sr, so, rr, rhor, rml, rms, rmr, etaB, k, epsg, M, alpha, R0, R40,
+		parameterLength};
 
-	/****************** Start growthloop *****************************************/
+	gforcing forc = {Io, Hc, LAIF, ForParms};
 
 	// gp->T number of years, gp->deltat is increment (=1/16)
-	for (i = 1; i < (ceil(gp->T/gp->deltat) + 1); i++){  //DG: added in plus one
-
-		// this updates the vector p if the length of a parameter is > 1
-		updateSparms(
-			i, 
-			p, 
-			parameterLength,
-			hmax,
-			phih,
-			eta,
-			swmax,
-			lamdas,
-			lamdah,
-			rhomax,
-			rhomin,
-			f2,
-			f1,
-			gammac,
-			gammaw,
-			gammax,
-			cgl,
-			cgr,
-			cgw,
-			deltal,
-			deltar,
-			sl,
-			sla,
-			sr,
-			so,
-			rr,
-			rhor,
-			rml,
-			rms,
-			rmr,
-			etaB,
-			k,
-			epsg,
-			M,
-			alpha,
-			R0,
-			R40
-		);
-
-		// Rprintf("p.sla value: %g for iteration: %i\n", p->sla, i);
-
-  		double APAR[2];
-  		APAR[0] = -1;
-  		APAR[1] = -1;
-	    
-	    // MKF moved this to the top of the loop to prevent LAI->bot == 0
-	    LAIcalc(&LAI,&LA, st.la, st.r, st.h, st.rBH, p, gp, Hc[i], &st);
-		  // If tree died last iteration, then exit program.
-		  //if (st.status==0){
-			//    growth_st[i]=6;
-			//    break;
-			//}
-
-		   // If r = 0 then exit program the tree is dead
-		   // Check for possible division by zero, negative areas, etc.
-		   if ((st.vts <= 0) || (st.bts == 0) || (p->gammax == 1) || (p->gammaw == 0) ||
-				(LAI.tot == 0) || ((1.0+st.deltas)*st.bos*gp->deltat == 0) || ((p->f2*st.sa) <= 0) ||
-				(p->sla <= 0) || (st.bs == 0)){
-				st.status=0;
-				growth_st[i]=6;
-				break;
-			}
-		   // If miniscule amount of labile C and tissues (i.e., less than 0.01 cm2 of
-		   // leaf area and equivalent bos), tree dies. Use this for "established" trees
-		   // with r > 0.1 m.
-		   if ((st.r>=0.1) && (st.bos<(p->lamdas*st.bts/(1000000*p->f2*st.sa))) &&
-				(st.bl<(1/(p->sla*1000000))) && (st.cs<=0)){
-				st.status=0;
-				growth_st[i]=6;
-				//printf("exit loop due to miniscule amount of labile, iter=%d \n",i);
-				//printf("TreeDies \n");
-				break;
-			}
-
-		//if(skip == 0){
-		// Define light as the total annual amount of absorbed radiation (i.e.,
-		// APAR). Compute total PAR absorbed by canopy as incident PAR above
-		// canopy (Io) * fraction of PAR absorbed (f_abs) * Canopy area
-
-		// mkf 3/16/2018 f_abs = fmin(1,fmax(0,(1-exp(-p->K*LAI.tot))));
-		f_abs = fminmacro(1,fmaxmacro(0,(1-exp(-p->K*LAI.tot))));
-
-		// update light value
-		if(Hc[i] != -99){
-			// APAR should be a vector of length 2
-			APARcalc(&APAR[0], &LAI, &LA, p->eta, p->K, st.h, Hc[i], LAIF[i], Io[i], ForParms);
-		  //printf("APAR[0]=%g, APAR[1]=%g \n", APAR[0], APAR[1]);
-			st.light = APAR[0];
-			//APARout[i] = APAR[1]; Moved to bottom
-			
-			//Rprintf("Iteration: %i\n", i);
-			//Rprintf("APAR[0]: %g\n", APAR[0]);
-			//Rprintf("LAI: %g\n", LAI);
-			//Rprintf("LA: %g\n", LA);
-			//Rprintf(">eta: %g\n", p->eta);
-			//Rprintf("K: %g\n", p->K);
-			//Rprintf("h: %g\n", st.h);
-			//Rprintf("Hc: %g\n", Hc[i]);
-			//Rprintf("LAIF: %g\n", LAIF[i]);
-			//Rprintf("Io: %g\n", Io[i]);
-			//Rprintf("\n");
-		}else{
-			st.light = Io[i]*f_abs*(st.la/LAI.tot);
-		  
-		  //Rprintf("Iteration: %i\n", i);
-		  //Rprintf("Io: %g\n", Io[i]);
-		  //Rprintf("f_abs: %g\n", f_abs);
-		  //Rprintf("la: %g\n", st.la);
-		  //Rprintf("LAI.tot: %g\n", LAI.tot);
-		  //Rprintf("\n");
-		}
-		// mkf 3/16/2018 st.light = Io[i]*f_abs*(st.la/LAI.tot); // 138b in appendix for Scn. A
-
-		// Determine labile carbon needed to bring all tissues in-line with target allometry (ea),
-		// and labile carbon needed to rebuild all senescesed tissues (erb):
-		st.deltas=fmaxmacro(0,st.cs/st.bs);
-
-		// BELOW: revised version, accounts for relative amounts or woody vs. "living" tissue.
-		// First, respiring sapwood due to base-line "structural" biomass of living cells:
-
-		bsstar = (1-p->gammaw*st.bts/((1-p->gammax)*st.vts))*st.bs;
-		if ((p->gammac > 0) && (st.cs > 0)){
-			// respiring sapwood also due to cells with labile carbon:
-			bsstar = bsstar + (1-p->gammaw*st.bts/((1-p->gammax)*st.vts))*((st.cs/p->gammac)*(st.bts/st.vts));
-		}
-
-		rm=p->rml*st.bl+p->rmr*st.br+p->rms*bsstar;
-
-		// Revised photosynthesis model based on radiation-use efficiency model:
-		//pg=p->epsg*st.light;   //pg is intermediate variable
-		//Rprintf("pg: %g\n", pg);
-		pg=photosynthesis(p, &st);
-		//Rprintf("pg: %g\n", pg);
-		//Rprintf("Iteration: %i\n", i);
-		//Rprintf("pg: %g\n", pg);
-		//Rprintf("epsg: %g\n", p->epsg);
-		//Rprintf("light: %g\n", st.light);
-		//Rprintf("\n");
-		// update excess carbon (st.ex).
-		st.ex=pg-rm+p->deltal*p->sl*st.bl+p->deltar*p->sr*st.br+st.deltas*p->so*st.bos;
-		//Rprintf("Iteration: %i\n", i);
-		//Rprintf("pg: %g\n", pg);
-		//Rprintf("deltal: %g\n", p->deltal);
-		//Rprintf("sl: %g\n", p->sl);
-		//Rprintf("bl: %g\n", st.bl);
-		//Rprintf("deltar: %g\n", p->deltar);
-		//Rprintf("sr: %g\n", p->sr);
-		//Rprintf("br: %g\n", st.br);
-		//Rprintf("deltas: %g\n", st.deltas);
-		//Rprintf("so: %g\n", p->so);
-		//Rprintf("bos: %g\n", st.bos);
-		//Rprintf("\n");
-		//Rprintf("\n");
-		//Rprintf("\n");
-		//Rprintf("\n");
-		//Rprintf("\n");
-		
-		//Rprintf("The growthloop iteration is: %i, st.ex: %g \n", i, st.ex);
-		
-		rhow=st.bts/st.vts;   //intermediate variable
-			  if (rhow > ((1-p->gammax)/p->gammaw)*exp(10)/(1+exp(10))){
-				// if wood density is very close to upper limit (given by deltaw=0), set
-				// carbon storage capacity to zero to avoid rounding and computational errors.
-				deltaw=0;
-			  }
-			  else{
-				deltaw=p->gammac*(1.0-p->gammax-p->gammaw*rhow)/rhow;
-			  }
-
-		//used in putonallometry()
-		pton.nuoa=((p->so*gp->deltat-1.0)*st.boh+p->lamdah*st.bth)/((1.0+st.deltas)*st.bos*gp->deltat);
-		if (pton.nuoa<0.0){
-		  pton.nuoa=0.0;
+	int nsteps = ceil(gp->T/gp->deltat);
+
+	if (ckin != NULL){
+		ck = *ckin;
+		*t = growthloop_resume(p, gp, &ck, &ps, &forc, &out, nsteps);
+	}
+	else{
+		//Initialze the state variables.
+		growthloop_init(p, gp, r0, &ck);
+
+		// Store the initial variable states at index 0 (index 1 in R)
+		growthloop_store(&ck, gp, &out, 0);
+		growth_st[0]=0;
+		APARout[0]=0;
+
+		//Initialize the radius and height arrays to be returned (needed in the MCMC)
+		if (nsteps > 0){
+			r[1]=r[0];  //same as initial radius
+			h[1]=h[0];
+			rBH[1]=rBH[0];
 		}
 
-		//These are used in putonallometry()
-		pton.eo=((p->cgw+deltaw)*(((p->so+pton.nuoa)*gp->deltat-1.0)*st.bos+p->lamdas*st.bts))/gp->deltat;
-		pton.el=((p->cgl+p->deltal)*(p->sla*(p->sl*gp->deltat-1.0)*st.bl+p->f2*st.sa))/(p->sla*gp->deltat);
-		pton.er=((p->cgr+p->deltar)*(2.0*(p->sr*gp->deltat-1.0)*st.br+p->f1*p->f2*p->rr*p->rhor*st.sa))/(2.0*gp->deltat);
-		pton.ea=pton.eo+pton.el+pton.er;
-
-		//These are used in rebuildstaticstate()
-		rebld.nuoerb=p->so*st.boh/((1.0+st.deltas)*st.bos);
-		rebld.elerb=(p->cgl+p->deltal)*p->sl*st.bl;
-		rebld.ererb=(p->cgr+p->deltar)*p->sr*st.br;//gp->T;//Modified 2/20/18
-		rebld.eoerb=(p->cgw+deltaw)*(p->so+rebld.nuoerb)*st.bos;
-		rebld.erb=rebld.elerb+rebld.ererb+rebld.eoerb;
-
-		//Rprintf("growthloop 310 puton.ea: %g, st.ex %g, growthflag %i \n", pton.ea, st.ex, growthflag);
-		if ((pton.ea<st.ex) && (pton.ea>0.0)){      // enough labile C to grow tree along target allometry.
-		  if (growthflag==0){       // tree currently off target allometry.
-  			//printf("PutOnAllometry \n");
-  			putonallometry(&st,p,gp,&pton,i,deltaw);  //make deltaw *deltaw
-  			growthflag=1;
-  			if(st.status==1){
-  			  growth_st[i]=3;
-  			}else if(st.status==0){
-  			  growth_st[i]=6;
-  			}else{
-  			  growth_st[i]=-999;
-  			}
-		  }
-		  else{ // not enough labile C to grow tree on target allometry.
-			//printf("ExcessGrowingOn \n");
-			//MKF 04/20/2013 I added errorind to excessgrowing on to catch errors
-			//excessgrowingon(p,gp,&st,i,growthflag,r, &errorind[i], &growth_st[i],
-      //                tolout, errorout, drout, demandout, odemandout, odrout);
-		  excessgrowingon(p,gp,&st,i,growthflag,r, &errorind[i], &growth_st[i]);
-		  //Rprintf("after excessgrowing st.bts: %g \n", i, st.bts);
-			growthflag=1;
-			//if(growth_st[i]==0){growth_st[i]=1;}
-			growth_st[i]=1;
-			if (st.nut > 1){ // This is legacy code but I left it MKF 
-			  //printf("Sapwood conversion rate > 1 flag disabled. \n");
-			  //st.status=0;
-			  //getchar();
-			}
-		  } //end else
-		} // end if ((pton.ea<st.ex) && ...
-		else{       // not enough labile C to grow tree on target allometry.
-		  // TODO: put rebld updates here since they are only used here.
-		  // This is a legacy comment from Darren I don't think anything needs
-		  // to be done. MKF
-		  growthflag=0;
-		  if (rebld.erb<st.ex){     // enough labile C to growth tree along reduced allometry.
-    			//printf("ExcessGrowingOff \n");
-    			excessgrowingoff(p,gp,&st,i,deltaw,&errorind[i], &growth_st[i]);
-    			if(growth_st[i]==0){growth_st[i]=2;}
-		  }
-		  else{
-			if ((rebld.erb-st.ex) < (st.cs/gp->deltat - st.deltas*(rebld.nuoerb+p->so)*st.bos)){    // enough labile C to rebuild non-trunk tissues.
-			  //printf("RebuildStaticState \n");
-			  rebuildstaticstate(p,&st,gp,&rebld,i,deltaw);
-			  if(st.status==1){
-				growth_st[i]=4;
-			  }else if(st.status==0){
-				growth_st[i]=6;
-			  }else{
-				growth_st[i]=-999;
-			  }
-			}
-			else{           // Not enough labile C to rebuild tissues, non-trunk compartments shrinking in size.
-			  //printf("ShrinkingSize \n");
-			  double pnet=pg-rm;  //used in shrinking size
-			  shrinkingsize(p,gp,&st,i,&deltaw,&pnet);
-			  if(st.status==1){
-				growth_st[i]=5;
-			  }else if(st.status==0){
-				growth_st[i]=6;
-			  }else{
-				growth_st[i]=-999;
-			  }
-			}
-		  }
-		} // end outer else
+		/****************** Start growthloop *****************************************/
+		*t = growthloop_run(gp, &ck, &ps, &forc, &out, nsteps);
+	}
 
-		/* update radius, height, and rBH arrays  */
-		r[i]=st.r;
-		h[i]=st.h;
-
-		rBH[i]=st.rBH;
-		//deltar[i]=st.dr;
-		/* Recalculate st.light */
-
-		// Added if statement on 4/2/18 MKF
-		//LAIcalc(&LAI,&LA, st.la, st.r, st.h, st.rBH, p, gp, Hc[i], &st);
-		//if(st.status!=1){
-		//  st.light = 0;
-		//}
-
-
-		if (isnan(st.ex) !=0){
-		  //Rprintf("st.ex=%g \n", st.ex);
-		  //Rprintf("st.ex index -4 to -1: %g, %g, %g, %g \n", ex2[i-4], ex2[i-3], ex2[i-2], ex2[i-1]);
-		  //Rprintf("st.r=%g, st.h=%g, st.bos=%g, st.bts=%g \n", st.r, st.h, st.bos,st.bts);
-		  //Rprintf("f2=%g, st.sa=%g, st.bl=%g, sla=%g \n",log(p->f2), st.sa, st.bl, log(p->sla));
-		  //Rprintf("st->br=%g, st->bl=%g, p->sl=%g, p->sr=%g \n", st.br, st.bl, p->sl, p->sr);
-		  //Rprintf("st->bts=%g,st->boh=%g,p->lamdah=%g,st->bth=%g, st->bos=%g \n",
-		  //		 st.bts,st.boh,p->lamdah,st.bth,st.bos);
-		  //Rprintf("st->cs=%g, gp->deltat=%g, st.deltas=%g, p->so=%g, st->bos=%g \n",
-		  //		 st.cs, gp->deltat, st.deltas, p->so, st.bos);
-		  //Rprintf("iteration=%i \n", i);
-		  errorind[i] = errorind[i] | 1;
-		  //getchar(); // keep
-		}
-		if ((r[i]<=0) || ( h[i]<=0) || (rBH[i]<=0) || (isnan(r[i]) !=0) || (isnan(h[i]) !=0)){
-		  //printf("error in growthloop: r or h is negative or nan \n");
-		  //getchar(); // keep
-		  errorind[i] = errorind[i] | 2;
-		}
-
-		hh2[i]=st.hh; //double
-		hC2[i]=st.hh; //double
-		//hB2[i]=st.hB; //double
-		hB2[i]=st.h * p->etaB;
-		hBH2[i]=gp->BH; //double 
-		//hBH2[i]=st.hBH; //double
-		rB2[i]=st.rB; //double
-		rC2[i]=st.rC; //double
-		sw2[i]=st.sw; //double
-		vts2[i]=st.vts; //double
-		vt2[i]=st.vt; //double
-		vth2[i]=st.vth; //double
-		sa2[i]=st.sa; //double
-		la2[i]=st.la; //double
-		ra2[i]=st.ra; //double
-		dr2[i]=st.dr; //double
-		xa2[i]=st.xa; //double
-		bl2[i]=st.bl; //double
-		br2[i]=st.br; //double
-		bt2[i]=st.bt; //double
-		bts2[i]=st.bts; //double
-		bth2[i]=st.bth; //double
-		boh2[i]=st.boh; //double
-		bos2[i]=st.bos; //double
-		bo2[i]=st.bo; //double
-		bs2[i]=st.bs; //double
-
-		cs2[i]=st.cs; //double
-		clr2[i]=st.clr; //double
-		fl2[i]=st.fl; //double
-		fr2[i]=st.fr; //double
-		ft2[i]=st.ft; //double
-		fo2[i]=st.fo; //double
-		rfl2[i]=st.rfl; //double
-		rfr2[i]=st.rfr; //double
-		rfs2[i]=st.rfs;  //double
-
-		egrow2[i]=st.egrow;  //double
-		ex2[i]=st.ex;  //double
-		rtrans2[i]=st.rtrans; //double
-		light2[i]=st.light; //double
-		nut2[i]=st.nut; //double
-		deltas2[i]=st.deltas; //double
-		//LAI2[i]=st.LAI; //double
-		LAI2[i]=LAI.tot;
-		status2[i]=st.status; //int
-    //APARout[i]=APAR[0];
-    APARout[i]=st.light;
-
-		//Break the loop right away if status is 0
-		if(st.status == 0){
-			break;
-		}
-
-		//printf("index number in loop: %d \n", (i+(*lenvars * *iout)+ *iout));
-		//} // end of skip if
-  } //end the for loop
-
-	//printf("This is lenvars * iout %d \nlenvars %d \niout %d\n\n", *lenvars * *iout, *lenvars, *iout);
-
-  //*t=(i-1);  // return iteration
-
-  // Make sure the final status is recorded
-  status2[i]=st.status; // Added my MKF on 4/3/18
+	if (ckout != NULL){
+		*ckout = ck;
+	}
 
 } //end growthloop function
-
+#endif
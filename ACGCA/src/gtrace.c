@@ -0,0 +1,189 @@
+/// \file gtrace.c
+/// \brief Buffers of the trace probes of gtrace.h.
+///
+/// Every thread that writes a record gets its own ring buffer of the last
+/// capacity records, so probes in runs in parallel threads never wait on
+/// each other or on output (unlike printing).  A thread claims a buffer
+/// with one atomic increment on its first record and afterwards only writes
+/// to it.  The buffers are read and reset (gtrace_count(), gtrace_read(),
+/// gtrace_config()) from the main thread while no trees are simulated.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "head_files/gtrace.h"
+
+/// Largest number of threads with a buffer, records of further threads
+/// are dropped.
+#ifndef GTRACE_MAXTHREADS
+#define GTRACE_MAXTHREADS 256
+#endif
+
+/// Default number of records kept per thread.
+#ifndef GTRACE_CAPACITY
+#define GTRACE_CAPACITY 16384
+#endif
+
+/// Probes switched on at the start.
+#ifndef ACGCA_TRACE_MASK
+#define ACGCA_TRACE_MASK 0
+#endif
+
+#if defined(_MSC_VER)
+#define GT_TLS __declspec(thread)
+#else
+#define GT_TLS __thread
+#endif
+
+const char *gtrace_names[GT_NPROBE] = {
+  "run", "LAI", "APAR", "carbon", "branch", "error", "egiter", "egrestart",
+  "egfail", "poiter", "pofail", "fault"
+};
+
+// A ring buffer, rec[k % cap] holds record k of the thread.
+typedef struct{
+	long long n; // records written, the last cap are kept
+	int cap;
+	gtrecord rec[1];
+} gtbuf;
+
+/// Probes switched on, bit k for probe k.
+unsigned int gtrace_mask = ACGCA_TRACE_MASK;
+
+static gtbuf *gt_buf[GTRACE_MAXTHREADS];
+static int gt_nbuf = 0;        // buffers claimed
+static int gt_cap = GTRACE_CAPACITY;
+static int gt_gen = 1;         // changed by gtrace_config()
+static long long gt_lost = 0;  // records of threads without a buffer
+
+// The buffer of this thread is gt_buf[gt_myslot] while gt_mygen == gt_gen.
+static GT_TLS int gt_mygen = 0;
+static GT_TLS int gt_myslot = -1;
+static GT_TLS int gt_mystep = 0;
+
+// Returns the buffer of this thread, claiming one on the first record.
+static gtbuf *gt_mine(void){
+	gtbuf *b;
+	int slot;
+
+	if (gt_mygen == gt_gen){
+		return (gt_myslot >= 0) ? gt_buf[gt_myslot] : NULL;
+	}
+	gt_mygen = gt_gen;
+	gt_myslot = -1;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+	slot = gt_nbuf++;
+	if (slot >= GTRACE_MAXTHREADS){
+		return NULL;
+	}
+	b = malloc(sizeof(gtbuf) + (size_t)(gt_cap - 1)*sizeof(gtrecord));
+	if (b == NULL){
+		return NULL;
+	}
+	b->n = 0;
+	b->cap = gt_cap;
+	gt_buf[slot] = b;
+	gt_myslot = slot;
+	return b;
+}
+
+/// gtrace_step() sets the step of the records this thread writes next.
+void gtrace_step(int step){
+	gt_mystep = step;
+}
+
+/// gtrace_emit() writes a record of probe to the buffer of this thread.
+void gtrace_emit(int probe, int code, double a, double b, double c){
+	gtbuf *buf = gt_mine();
+	gtrecord *r;
+
+	if (buf == NULL){
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+		gt_lost++;
+		return;
+	}
+	r = &buf->rec[buf->n % buf->cap];
+	r->probe = probe;
+	r->thread = gt_myslot;
+	r->step = gt_mystep;
+	r->code = code;
+	r->v[0] = a;
+	r->v[1] = b;
+	r->v[2] = c;
+	buf->n++;
+}
+
+/// gtrace_config() drops all records, switches on the probes in mask (bit
+/// k for probe k) and sets the number of records kept per thread
+/// (capacity <= 0 keeps it).
+///
+/// Returns 0, or 1 if the probes are not compiled in.
+int gtrace_config(unsigned int mask, int capacity){
+	int k;
+
+	for (k = 0; k < GTRACE_MAXTHREADS; k++){
+		free(gt_buf[k]);
+		gt_buf[k] = NULL;
+	}
+	gt_nbuf = 0;
+	gt_lost = 0;
+	gt_gen++;
+	if (capacity > 0){
+		gt_cap = capacity;
+	}
+	gtrace_mask = mask;
+	return !gtrace_compiled();
+}
+
+/// gtrace_count() returns the number of records kept and the number of
+/// records dropped because buffers were full (the oldest are dropped) or
+/// not available.
+long long gtrace_count(long long *dropped){
+	long long n = 0;
+	int k;
+
+	*dropped = gt_lost;
+	for (k = 0; k < GTRACE_MAXTHREADS; k++){
+		if (gt_buf[k] != NULL){
+			long long m = (gt_buf[k]->n < gt_buf[k]->cap) ? gt_buf[k]->n : gt_buf[k]->cap;
+			n += m;
+			*dropped += gt_buf[k]->n - m;
+		}
+	}
+	return n;
+}
+
+/// gtrace_read() copies up to max records to rec, by thread and oldest
+/// first within a thread, and returns the number copied.
+long long gtrace_read(gtrecord *rec, long long max){
+	long long n = 0, i, from;
+	int k;
+
+	for (k = 0; k < GTRACE_MAXTHREADS; k++){
+		gtbuf *b = gt_buf[k];
+		if (b == NULL){
+			continue;
+		}
+		from = (b->n > b->cap) ? b->n - b->cap : 0;
+		for (i = from; i < b->n && n < max; i++){
+			rec[n++] = b->rec[i % b->cap];
+		}
+	}
+	return n;
+}
+
+/// gtrace_compiled() returns 1 if the probes are compiled in (ACGCA_TRACE).
+int gtrace_compiled(void){
+#ifdef ACGCA_TRACE
+	return 1;
+#else
+	return 0;
+#endif
+}
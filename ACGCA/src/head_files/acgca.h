@@ -0,0 +1,153 @@
+/// \file acgca.h
+/// \brief C library interface to the ACGCA model (libacgca).
+///
+/// The library simulates single trees through opaque handles so it can be
+/// embedded in other programs (e.g., a forest simulator) without R.  A
+/// simulation is built from
+///   - species parameters (acgca_params), copied when the simulation is
+///     created, and
+///   - a driver (acgca_driver) holding the time step, the initial radius and
+///     the light forcing.  Drivers are only read by the simulations so one
+///     driver can be shared by any number of trees, but it has to outlive
+///     them.
+///
+/// All memory is taken from the allocator given when a handle is created
+/// (NULL uses malloc() and free()).  Different handles can be used from
+/// different threads at the same time; a single handle must not.
+///
+/// Only functions and constants in this file are part of the interface.  The
+/// handles are opaque and the field numbers below never change, new fields
+/// are added at the end, so programs built against an older version of this
+/// header keep working.  ACGCA_API_VERSION is increased when functions are
+/// added.
+///
+/// For coupling with other models the caller drives the clock: advance the
+/// trees (acgca_sim_step() or acgca_sims_step()), read their state, feed
+/// back light (acgca_sim_force()) or parameters (acgca_sim_set()) and repeat.
+///
+/// \author Michael Fell
+
+#ifndef ACGCA_H
+#define ACGCA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACGCA_API_VERSION 2
+
+/// Return codes.
+#define ACGCA_OK 0
+#define ACGCA_ENOMEM 1   ///< the allocator returned NULL
+#define ACGCA_EINVAL 2   ///< unknown name, field or invalid value
+
+/// \brief Caller supplied memory management.  ctx is passed through.
+typedef struct{
+  void *(*alloc)(size_t size, void *ctx);
+  void (*release)(void *ptr, void *ctx);
+  void *ctx;
+} acgca_allocator;
+
+typedef struct acgca_params acgca_params;
+typedef struct acgca_driver acgca_driver;
+typedef struct acgca_sim acgca_sim;
+
+/// Output fields read with acgca_sim_get().  The names (acgca_field_name())
+/// are the output names of runacgca() in R.
+enum{
+  ACGCA_APAR, ACGCA_h, ACGCA_hh, ACGCA_hC, ACGCA_hB, ACGCA_hBH, ACGCA_r,
+  ACGCA_rB, ACGCA_rC, ACGCA_rBH, ACGCA_sw, ACGCA_vts, ACGCA_vt, ACGCA_vth,
+  ACGCA_sa, ACGCA_la, ACGCA_ra, ACGCA_dr, ACGCA_xa, ACGCA_bl, ACGCA_br,
+  ACGCA_bt, ACGCA_bts, ACGCA_bth, ACGCA_boh, ACGCA_bos, ACGCA_bo, ACGCA_bs,
+  ACGCA_cs, ACGCA_clr, ACGCA_fl, ACGCA_fr, ACGCA_ft, ACGCA_fo, ACGCA_rfl,
+  ACGCA_rfr, ACGCA_rfs, ACGCA_egrow, ACGCA_ex, ACGCA_rtrans, ACGCA_light,
+  ACGCA_nut, ACGCA_deltas, ACGCA_LAI,
+  ACGCA_status, ACGCA_errorind, ACGCA_growth_st,
+  ACGCA_NFIELDS
+};
+
+/// Version of the interface the library was built with.
+int acgca_version(void);
+
+/// Name of field k or NULL, and the field with a given name or -1.
+const char *acgca_field_name(int field);
+int acgca_field_index(const char *name);
+
+/// Species parameters.  A new set is all zero apart from gammaw, drinit and
+/// drcrit, which get the values runacgca() uses.  species may be "acru",
+/// "pita" or NULL.  rhomin follows rho unless it is set.
+acgca_params *acgca_params_create(const char *species,
+  const acgca_allocator *alloc);
+int acgca_params_set(acgca_params *params, const char *name, double value);
+int acgca_params_get(const acgca_params *params, const char *name,
+  double *value);
+void acgca_params_destroy(acgca_params *params);
+
+/// Driver with steps time steps per year.  Defaults are those of runacgca():
+/// r0 0.05, parmax 2060, no forest canopy (open grown tree),
+/// breast.height 1.37, tolerance 0.00001, kF 0.6, intF 3.4, slopeF -5.5.
+acgca_driver *acgca_driver_create(int steps, const acgca_allocator *alloc);
+
+/// Sets a scalar: "r0", "breast.height", "tolerance", "kF", "intF",
+/// "slopeF", or a constant "parmax", "Hc" or "LAIF" (Hc = -99 means no
+/// forest canopy).
+int acgca_driver_set(acgca_driver *driver, const char *name, double value);
+
+/// Copies a time series of "parmax", "Hc" or "LAIF".  Value i is used for
+/// step i (index 0 is the initial state as in runacgca()); the last value is
+/// used for all later steps.
+int acgca_driver_series(acgca_driver *driver, const char *name,
+  const double *values, int n);
+void acgca_driver_destroy(acgca_driver *driver);
+
+/// New tree at step 0.  Returns NULL if memory could not be allocated.  The
+/// simulation uses the allocator of params.
+acgca_sim *acgca_sim_create(const acgca_params *params,
+  const acgca_driver *driver);
+
+/// Advances the tree by n steps.  Returns the number of steps taken, less
+/// than n if the tree died.
+int acgca_sim_step(acgca_sim *sim, int n);
+
+/// Called before each step of acgca_sim_run() with the step about to be
+/// taken and the forcing for it (parmax, Hc, LAIF), which may be changed.
+/// The function may also call acgca_sim_set().  Returning non zero stops
+/// the run before the step.
+typedef int (*acgca_input_fn)(acgca_sim *sim, int step, double forcing[3],
+  void *ctx);
+
+/// acgca_sim_step() with a function that supplies the inputs of each step.
+int acgca_sim_run(acgca_sim *sim, int n, acgca_input_fn input, void *ctx);
+
+/// Advances nsims trees by n steps each, in parallel when the library is
+/// built with OpenMP (nthreads 0 uses the OpenMP default).  Returns the total
+/// number of steps taken.
+int acgca_sims_step(acgca_sim **sims, int nsims, int n, int nthreads);
+
+/// Replaces the driver value of "parmax", "Hc" or "LAIF" for all following
+/// steps of this tree.  NAN goes back to the driver.
+int acgca_sim_force(acgca_sim *sim, const char *name, double value);
+
+/// Sets or reads a species parameter of the tree, used from the next step
+/// on.  Setting rho also sets rhomin unless rhomin was set.
+int acgca_sim_set(acgca_sim *sim, const char *name, double value);
+int acgca_sim_param(const acgca_sim *sim, const char *name, double *value);
+
+/// Steps taken since the tree was created.
+int acgca_sim_time(const acgca_sim *sim);
+
+/// Copies the current value of field into buf.
+int acgca_sim_get(const acgca_sim *sim, int field, double *buf);
+
+/// Copies the current values of nfields fields into buf.
+int acgca_sim_getv(const acgca_sim *sim, int nfields, const int *fields,
+  double *buf);
+void acgca_sim_destroy(acgca_sim *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+/// \file checkpoint.h
+/// \brief Reading and writing growthloop checkpoints (see checkpoint.c)
+/// \author Michael Fell
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+
+/// Version of the checkpoint file layout.  Bump when the layout changes.
+#define CHECKPOINT_VERSION 1
+
+extern int checkpoint_write(const char *file, gcheckpoint *ck);
+extern int checkpoint_read(const char *file, gcheckpoint *ck);
+
+extern int checkpoint_fwrite(FILE *fp, gcheckpoint *ck);
+extern int checkpoint_fread(FILE *fp, gcheckpoint *ck);
+
+#endif
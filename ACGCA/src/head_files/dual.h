@@ -0,0 +1,179 @@
+/// \file dual.h
+/// \brief Dual numbers for forward mode automatic differentiation of the
+/// model (see growthad.cpp).  C++ only.
+///
+/// A dualn<N> holds a value v and its derivatives d[0..N-1] with respect to
+/// N seeded inputs.  The arithmetic operators and the functions of math.h
+/// used by the model propagate the derivatives by the chain rule.
+/// Comparisons only look at the values, so the model takes the same
+/// branches as with double.
+///
+/// \author Michael Fell
+
+#ifndef DUAL_H
+#define DUAL_H
+#include <math.h>
+
+template<int N> struct dualn{
+  double v;     ///< value
+  double d[N];  ///< derivatives with respect to the seeded inputs
+
+  dualn() = default;
+  dualn(double x) : v(x){
+    for(int k = 0; k < N; k++) d[k] = 0;
+  }
+
+  dualn &operator+=(const dualn &b){
+    v += b.v;
+    for(int k = 0; k < N; k++) d[k] += b.d[k];
+    return *this;
+  }
+  dualn &operator-=(const dualn &b){
+    v -= b.v;
+    for(int k = 0; k < N; k++) d[k] -= b.d[k];
+    return *this;
+  }
+  dualn &operator*=(const dualn &b){
+    for(int k = 0; k < N; k++) d[k] = d[k]*b.v + v*b.d[k];
+    v *= b.v;
+    return *this;
+  }
+  dualn &operator/=(const dualn &b){
+    v /= b.v;
+    for(int k = 0; k < N; k++) d[k] = (d[k] - v*b.d[k])/b.v;
+    return *this;
+  }
+};
+
+/// Value of x without derivatives (GVAL() in the model sources)
+template<int N> inline double gval(const dualn<N> &x){ return x.v; }
+inline double gval(double x){ return x; }
+
+/// Returns x with derivatives f'(x.v)*x.d and value fx
+template<int N> inline dualn<N> dchain(const dualn<N> &x, double fx,
+  double dfx){
+  dualn<N> r;
+  r.v = fx;
+  for(int k = 0; k < N; k++) r.d[k] = dfx*x.d[k];
+  return r;
+}
+
+template<int N> inline dualn<N> operator-(const dualn<N> &a){
+  return dchain(a, -a.v, -1.0);
+}
+
+template<int N> inline dualn<N> operator+(dualn<N> a, const dualn<N> &b){
+  return a += b;
+}
+template<int N> inline dualn<N> operator+(dualn<N> a, double b){
+  a.v += b;
+  return a;
+}
+template<int N> inline dualn<N> operator+(double a, dualn<N> b){
+  b.v += a;
+  return b;
+}
+
+template<int N> inline dualn<N> operator-(dualn<N> a, const dualn<N> &b){
+  return a -= b;
+}
+template<int N> inline dualn<N> operator-(dualn<N> a, double b){
+  a.v -= b;
+  return a;
+}
+template<int N> inline dualn<N> operator-(double a, const dualn<N> &b){
+  return dchain(b, a - b.v, -1.0);
+}
+
+template<int N> inline dualn<N> operator*(dualn<N> a, const dualn<N> &b){
+  return a *= b;
+}
+template<int N> inline dualn<N> operator*(const dualn<N> &a, double b){
+  return dchain(a, a.v*b, b);
+}
+template<int N> inline dualn<N> operator*(double a, const dualn<N> &b){
+  return dchain(b, a*b.v, a);
+}
+
+template<int N> inline dualn<N> operator/(dualn<N> a, const dualn<N> &b){
+  return a /= b;
+}
+template<int N> inline dualn<N> operator/(const dualn<N> &a, double b){
+  return dchain(a, a.v/b, 1.0/b);
+}
+template<int N> inline dualn<N> operator/(double a, const dualn<N> &b){
+  double r = a/b.v;
+  return dchain(b, r, -r/b.v);
+}
+
+#define DUAL_COMPARE(op) \
+  template<int N> inline bool operator op(const dualn<N> &a, \
+    const dualn<N> &b){ return a.v op b.v; } \
+  template<int N> inline bool operator op(const dualn<N> &a, double b){ \
+    return a.v op b; } \
+  template<int N> inline bool operator op(double a, const dualn<N> &b){ \
+    return a op b.v; }
+DUAL_COMPARE(<)
+DUAL_COMPARE(>)
+DUAL_COMPARE(<=)
+DUAL_COMPARE(>=)
+DUAL_COMPARE(==)
+DUAL_COMPARE(!=)
+#undef DUAL_COMPARE
+
+template<int N> inline dualn<N> exp(const dualn<N> &x){
+  double e = ::exp(x.v);
+  return dchain(x, e, e);
+}
+template<int N> inline dualn<N> log(const dualn<N> &x){
+  return dchain(x, ::log(x.v), 1.0/x.v);
+}
+template<int N> inline dualn<N> sqrt(const dualn<N> &x){
+  double s = ::sqrt(x.v);
+  return dchain(x, s, 0.5/s);
+}
+template<int N> inline dualn<N> fabs(const dualn<N> &x){
+  return dchain(x, ::fabs(x.v), (x.v < 0) ? -1.0 : 1.0);
+}
+template<int N> inline dualn<N> pow(const dualn<N> &x, double y){
+  double p = ::pow(x.v, y);
+  return dchain(x, p, (y == 0) ? 0.0 : y*::pow(x.v, y - 1));
+}
+template<int N> inline dualn<N> pow(const dualn<N> &x, const dualn<N> &y){
+  dualn<N> r = pow(x, y.v);
+  if(x.v > 0){
+    double dy = r.v*::log(x.v);
+    for(int k = 0; k < N; k++) r.d[k] += dy*y.d[k];
+  }
+  return r;
+}
+template<int N> inline dualn<N> pow(double x, const dualn<N> &y){
+  double p = ::pow(x, y.v);
+  return dchain(y, p, (x > 0) ? p*::log(x) : 0.0);
+}
+
+template<int N> inline bool isnan(const dualn<N> &x){ return isnan(x.v); }
+template<int N> inline bool isinf(const dualn<N> &x){ return isinf(x.v); }
+template<int N> inline bool isfinite(const dualn<N> &x){
+  return isfinite(x.v);
+}
+
+/// abs() of C takes an int, the model relies on it truncating its argument
+/// (putonallometry()).  The derivatives of an int are 0.
+template<int N> inline int abs(const dualn<N> &x){
+  int i = (int)x.v;
+  return (i < 0) ? -i : i;
+}
+
+/// Sets the derivatives of a root x of a residual res(x, theta) = 0 by the
+/// implicit function theorem, x' = x' - res'/slope, where res' are the total
+/// derivatives of the residual at x and slope = d res/d x.  Exact whatever
+/// derivatives x had, as res' includes slope*x'.
+template<int N> inline void gimplicit(dualn<N> *x, const dualn<N> &res,
+  double slope){
+  if(slope != 0 && isfinite(slope)){
+    for(int k = 0; k < N; k++) x->d[k] -= res.d[k]/slope;
+  }
+}
+
+#endif
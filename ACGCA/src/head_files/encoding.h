@@ -0,0 +1,35 @@
+/// \file encoding.h
+/// \brief Compression of output columns (see encoding.c)
+/// \author Michael Fell
+
+#ifndef ENCODING_H
+#define ENCODING_H
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Encodings of a result store.
+#define ENC_RAW 0       ///< plain doubles and ints, fixed size records
+#define ENC_EXACT 1     ///< lossless XOR encoding of doubles, RLE of ints
+#define ENC_QUANT 2     ///< quantized doubles within an error bound, RLE of ints
+
+/// Chunk modes, the first byte of every encoded chunk.
+#define CHUNK_RAW 0     ///< doubles as is
+#define CHUNK_XOR 1     ///< XOR with the previous value
+#define CHUNK_XORLIN 2  ///< XOR with the linear extrapolation of the last two values
+#define CHUNK_QUANT 3   ///< quantized, second differences as varints
+#define CHUNK_RLE 4     ///< run length encoded ints
+
+/// Smallest relative error bound used for ENC_QUANT, smaller bounds fall
+/// back to the lossless encoding.
+#define ENC_MINBOUND 1e-15
+
+/// Upper bound on the bytes needed to encode n values.
+#define ENC_BOUND(n) (1 + 8 + 10*(size_t)(n))
+
+extern size_t enc_doubles(const double *x, int n, int encoding, double errbound,
+  unsigned char *buf);
+extern int dec_doubles(const unsigned char *buf, size_t len, double *x, int n);
+extern size_t enc_ints(const int *x, int n, unsigned char *buf);
+extern int dec_ints(const unsigned char *buf, size_t len, int *x, int n);
+
+#endif
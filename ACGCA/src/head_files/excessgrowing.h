@@ -12,12 +12,12 @@
 //extern void trunkvolume(radius *r, height *h, double sw, volume *v);
 
 
-extern void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i,double deltaw,
+extern void excessgrowingoff(sparms *p, gparms *gp, tstates *st, int i,greal deltaw,
                              int *errorind2, int *growth_st);
 
-extern void excessgrowingon(sparms *p, gparms *gp, tstates *st, int i,
-                            int growthflag, double r[], int *errorind2,
-                            int *growth_st);
+extern int excessgrowingon(sparms *p, gparms *gp, tstates *st, int i,
+                           int growthflag, greal rhist[], double warm[],
+                           int *errorind2, int *growth_st);
                             //, double *tolout, double *errorout,
                             //double *drout, double *demandout,
                             //double *odemandout, double *odrout);
@@ -0,0 +1,80 @@
+/// \file explore.h
+/// \brief Quasi-Monte Carlo exploration of trait space with per point
+/// summaries streamed to a table on disk (see explore.c)
+/// \author Michael Fell
+
+#ifndef EXPLORE_H
+#define EXPLORE_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+#include "rng.h"
+
+/// Version of the explore table layout.  Bump when the layout changes.
+#define EXPLORE_VERSION 1
+
+/// Length of a parameter name in the header (including the terminating 0).
+#define EXPLORE_NAMELEN 16
+
+/// Designs: scrambled Sobol sequence or Latin hypercube.
+#define EX_SOBOL 0
+#define EX_LHS 1
+
+/// Scales a range is sampled uniformly on.
+#define EX_LINEAR 0
+#define EX_LOG 1
+#define EX_LOGIT 2
+
+/// Summaries of a point, stored after its parameters: alive at the end (1
+/// or 0), the time of death in years (the simulated years if the tree
+/// lives), height and DBH (2*rBH) at the end, and the fraction of the steps
+/// in each growth_st state (1 to 6, then any other value).
+typedef enum{
+  EX_alive, EX_death, EX_h, EX_dbh, EX_healthy, EX_reduced, EX_recovery,
+  EX_static, EX_shrinking, EX_dead, EX_other,
+  EX_NSUM
+} exsummary;
+
+extern const char *exsummary_names[EX_NSUM];
+
+/// \brief The model set up and the varied parameters with their ranges.
+/// Read only while the runs are done so it is shared by threads.
+typedef struct{
+  gparms gp;
+  sparms p;              ///< species parameters, varied ones are replaced
+  pschedule *ps;         ///< time varying parameters (none of them varied)
+  gforcing f;            ///< light forcing, indexed by step
+  double r0;             ///< initial radius
+  int nsteps;            ///< steps simulated per run
+  int npar;
+  int park[NSPARMS];     ///< sparms index of each varied parameter
+  double lo[NSPARMS];    ///< range of each varied parameter
+  double hi[NSPARMS];
+  int scale[NSPARMS];    ///< EX_LINEAR, EX_LOG or EX_LOGIT
+} extarget;
+
+/// \brief A design of n points in the unit cube of npar dimensions.
+typedef struct{
+  int design;            ///< EX_SOBOL or EX_LHS
+  int npar;
+  long long n;
+  uint64_t seed;
+  uint32_t v[NSPARMS][32]; ///< Sobol direction numbers
+  uint32_t key[NSPARMS];   ///< Sobol digital shift or LHS permutation key
+} exdesign;
+
+extern int ex_design(exdesign *d, int design, long long n, uint64_t seed,
+  int npar);
+
+extern void ex_point(const exdesign *d, long long i, double *u);
+
+extern double ex_scale(int scale, double lo, double hi, double u);
+
+extern void ex_eval(const extarget *t, const double *u, int *gst, float *rec);
+
+extern int ex_run(const extarget *t, const char *file, int design, long long n,
+  long long from, long long to, uint64_t seed, int nthreads);
+
+#endif
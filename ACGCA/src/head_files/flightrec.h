@@ -0,0 +1,30 @@
+/// \file flightrec.h
+/// \brief Replay files of the flight recorder of the growthloop (see
+/// flightrec.c, gflightrec in growthloop.h)
+/// \author Michael Fell
+
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+
+/// Version of the replay file layout.  Bump when the layout changes.
+#define FLIGHTREC_VERSION 1
+
+extern int flightrec_count(gflightrec *rec);
+
+extern gframe *flightrec_frame(gflightrec *rec, int k);
+
+extern int flightrec_write(const char *file, gparms *gp, Forestparms *fp,
+  gflightrec *rec);
+
+extern int flightrec_read(const char *file, gparms *gp, Forestparms *fp,
+  gflightrec *rec);
+
+extern int flightrec_replay(gparms *gp, Forestparms *fp, gflightrec *rec,
+  int k, gcheckpoint *ck, goutput *out);
+
+#endif
@@ -0,0 +1,200 @@
+/// \file gmath.h
+/// \brief exp, log and powers of the model kernels without calls into libm.
+///
+/// A time step evaluates about 14 exponentials and 11 powers (height
+/// allometry, trunk radii and volumes, light absorption, crown area), most
+/// of them pow() with the integer exponents 3 and 4, which the compiler
+/// leaves to libm unless it may reassociate.  The functions here are inline
+/// so they are compiled into the kernels, and apart from the range checks
+/// they do not branch, so loops over them can be vectorized for the
+/// instruction set the package is built for.
+///
+/// - gsq(), gcube() and gpow4() are products (at most 0.5, 1.3 and 1.9 ulp
+///   from the exact power).
+/// - gexp() reduces x to r = x - k ln2, |r| <= ln2/2, and evaluates exp(r)
+///   with the rational approximation of fdlibm (less than 1 ulp).
+/// - glog() reduces x to m 2^k, sqrt(2)/2 <= m < sqrt(2), and evaluates
+///   log(m) with the polynomial of fdlibm (less than 1 ulp).
+/// - gpow() is gexp(y glog(x)).  The rounding of y glog(x) adds up to
+///   |y log(x)| ulp, the model only calls it with |y log(x)| < 2, where it
+///   is within 4 ulp.
+///
+/// The special values follow C99 for the arguments the model can produce
+/// (inf for overflow, 0 for underflow, NaN for NaN).  In the AD build
+/// (growthad.cpp) the functions also take dual numbers and give the same
+/// values as the double build.
+///
+/// \author Michael Fell
+
+#ifndef GMATH_H
+#define GMATH_H
+#include <math.h>
+#include <string.h>
+
+// 2^k as a double for -1022 <= k <= 1023
+static inline double gmath_pow2i(int k){
+  unsigned long long b = (unsigned long long)(k + 1023) << 52;
+  double d;
+  memcpy(&d, &b, sizeof(d));
+  return d;
+}
+
+/// exp(x)
+static inline double gexp(double x){
+  const double ln2hi = 6.93147180369123816490e-01;
+  const double ln2lo = 1.90821492927058770002e-10;
+  const double invln2 = 1.44269504088896338700e+00;
+  // 1.5*2^52: adding and subtracting it rounds to an integer
+  const double shift = 6755399441055744.0;
+  const double P1 = 1.66666666666666019037e-01;
+  const double P2 = -2.77777777770155933842e-03;
+  const double P3 = 6.61375632143793436117e-05;
+  const double P4 = -1.65339022054652515390e-06;
+  const double P5 = 4.13813679705723846039e-08;
+  double kd, hi, lo, r, r2, c, y;
+  int k;
+
+  if (!(x < 709.782712893383973096)){
+    return (x != x) ? x : HUGE_VAL;
+  }
+  if (x < -745.13321910194110842){
+    return 0;
+  }
+  kd = (x*invln2 + shift) - shift;
+  k = (int)kd;
+  hi = x - kd*ln2hi;
+  lo = kd*ln2lo;
+  r = hi - lo;
+  r2 = r*r;
+  c = r - r2*(P1 + r2*(P2 + r2*(P3 + r2*(P4 + r2*P5))));
+  y = 1 - ((lo - (r*c)/(2 - c)) - hi);
+  // results below 2^-1022 are scaled in two steps
+  if (k < -1021){
+    return y*gmath_pow2i(k + 1000)*gmath_pow2i(-1000);
+  }
+  if (k > 1023){
+    return y*2*gmath_pow2i(k - 1);
+  }
+  return y*gmath_pow2i(k);
+}
+
+/// log(x)
+static inline double glog(double x){
+  const double ln2hi = 6.93147180369123816490e-01;
+  const double ln2lo = 1.90821492927058770002e-10;
+  const double Lg1 = 6.666666666666735130e-01;
+  const double Lg2 = 3.999999999940941908e-01;
+  const double Lg3 = 2.857142874366239149e-01;
+  const double Lg4 = 2.222219843214978396e-01;
+  const double Lg5 = 1.818357216161805012e-01;
+  const double Lg6 = 1.531383769920937332e-01;
+  const double Lg7 = 1.479819860511658591e-01;
+  unsigned long long b;
+  double m, f, s, z, w, R, hfsq, kd;
+  int k = 0;
+
+  if (!(x > 0) || x == HUGE_VAL){
+    return (x == 0) ? -HUGE_VAL : ((x == HUGE_VAL) ? x : NAN);
+  }
+  if (x < 2.2250738585072014e-308){
+    // subnormal, scale by 2^54
+    x *= 18014398509481984.0;
+    k = -54;
+  }
+  memcpy(&b, &x, sizeof(b));
+  k += (int)(b >> 52) - 1023;
+  // mantissa in [1, 2), moved to [sqrt(2)/2, sqrt(2))
+  b = (b & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+  memcpy(&m, &b, sizeof(m));
+  if (m > 1.41421356237309504880){
+    m *= 0.5;
+    k++;
+  }
+  kd = k;
+  f = m - 1;
+  hfsq = 0.5*f*f;
+  s = f/(2 + f);
+  z = s*s;
+  w = z*z;
+  R = z*(Lg1 + w*(Lg3 + w*(Lg5 + w*Lg7))) + w*(Lg2 + w*(Lg4 + w*Lg6));
+  return kd*ln2hi - ((hfsq - (s*(hfsq + R) + kd*ln2lo)) - f);
+}
+
+/// pow(x, y) for x >= 0, and for x < 0 with an integer y
+static inline double gpow(double x, double y){
+  double t;
+
+  if (y == 0){
+    return 1;
+  }
+  if (x > 0){
+    return gexp(y*glog(x));
+  }
+  if (x == 0){
+    return (y > 0) ? 0 : HUGE_VAL;
+  }
+  t = gexp(y*glog(-x));
+  if (fabs(y) >= 9007199254740992.0){
+    // 2^53 and above are even integers
+    return t;
+  }
+  if (y != (double)(long long)y){
+    return NAN;
+  }
+  return ((long long)y % 2 != 0) ? -t : t;
+}
+
+#ifndef ACGCA_AD
+
+/// x^2, x^3 and x^4
+static inline double gsq(double x){
+  return x*x;
+}
+static inline double gcube(double x){
+  return x*x*x;
+}
+static inline double gpow4(double x){
+  double x2 = x*x;
+  return x2*x2;
+}
+
+#else
+
+// Dual numbers (dual.h), the derivatives as for exp, log and pow there.
+template<class T> inline T gsq(const T &x){
+  return x*x;
+}
+template<class T> inline T gcube(const T &x){
+  return x*x*x;
+}
+template<class T> inline T gpow4(const T &x){
+  T x2 = x*x;
+  return x2*x2;
+}
+template<int N> inline dualn<N> gexp(const dualn<N> &x){
+  double e = gexp(x.v);
+  return dchain(x, e, e);
+}
+template<int N> inline dualn<N> glog(const dualn<N> &x){
+  return dchain(x, glog(x.v), 1.0/x.v);
+}
+template<int N> inline dualn<N> gpow(const dualn<N> &x, double y){
+  double p = gpow(x.v, y);
+  return dchain(x, p, (y == 0) ? 0.0 : y*gpow(x.v, y - 1));
+}
+template<int N> inline dualn<N> gpow(const dualn<N> &x, const dualn<N> &y){
+  dualn<N> r = gpow(x, y.v);
+  if(x.v > 0){
+    double dy = r.v*glog(x.v);
+    for(int k = 0; k < N; k++) r.d[k] += dy*y.d[k];
+  }
+  return r;
+}
+template<int N> inline dualn<N> gpow(double x, const dualn<N> &y){
+  double p = gpow(x, y.v);
+  return dchain(y, p, (x > 0) ? p*glog(x) : 0.0);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+/// \file gperf.h
+/// \brief Hardware performance counters of the calling thread (see gperf.c)
+///
+/// The counters use perf_event_open() and are only available on Linux and
+/// when the kernel allows it (perf_event_paranoid, no counters in many
+/// virtual machines).  Counters that cannot be opened read as 0 and are
+/// missing from the mask returned by gperf_open().
+/// \author Michael Fell
+
+#ifndef GPERF_H
+#define GPERF_H
+
+/// \brief Counted hardware events.
+typedef enum{
+  GPERF_instructions, GPERF_cycles, GPERF_branchmisses, GPERF_L1Dmisses,
+  GPERF_LLCmisses,
+  GPERF_N
+} gperfcounter;
+
+/// \brief Counters of one thread, read together as one perf event group.
+typedef struct{
+  int fd[GPERF_N]; ///< file descriptor of each counter, -1 if not counted
+  int leader;      ///< fd of the group leader, -1 if nothing is counted
+  int avail;       ///< bit k set if counter k is counted
+} gperf;
+
+extern const char *gperf_names[GPERF_N];
+
+extern int gperf_open(gperf *pc);
+
+extern void gperf_read(gperf *pc, unsigned long long *v);
+
+extern void gperf_close(gperf *pc);
+
+#endif
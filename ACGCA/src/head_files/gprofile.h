@@ -0,0 +1,86 @@
+/// \file gprofile.h
+/// \brief Profiler of the branches of growthloop_step() and the growth_st
+/// transitions (see gprofile.c)
+///
+/// The profiler is compiled in with -DACGCA_PROFILE, otherwise the macros
+/// below expand to the bare statements and cost nothing.  Times are
+/// clock_gettime() nanoseconds, or TSC cycles with -DACGCA_PROFILE_TSC on
+/// x86.  After gprof_hwstart() the hardware counters of gperf.h of the
+/// calling thread are added up per branch as well.  The dual number build of
+/// growthad.cpp is never profiled.
+/// \author Michael Fell
+
+#ifndef GPROFILE_H
+#define GPROFILE_H
+
+#include "gperf.h"
+
+/// \brief Profiled branches and solvers.  Times are inclusive, e.g.,
+/// GP_egdemand is part of GP_excessgrowingon and every branch is part of
+/// GP_step.
+typedef enum{
+  GP_step, GP_LAIcalc, GP_APARcalc, GP_photosynthesis, GP_excessgrowingon,
+  GP_excessgrowingoff, GP_putonallometry, GP_rebuildstaticstate,
+  GP_shrinkingsize, GP_shrinkingsizeA, GP_shrinkingsizeB, GP_egdemand,
+  GP_podemand,
+  GP_NBRANCH
+} gpbranch;
+
+/// Rows and columns of the transition matrix: 0 before the first step,
+/// growth_st 1 to 6 and 7 for any error code.
+#define GP_NSTATE 8
+
+/// Time units returned by gprof_read().
+#define GP_NSEC 0
+#define GP_CYCLES 1
+
+typedef unsigned long long gprof_tick;
+
+/// \brief Start of a profiled branch: time and hardware counters.
+typedef struct{
+  gprof_tick t;
+  unsigned long long hw[GPERF_N]; ///< only set while the counters run
+} gprof_mark;
+
+extern const char *gprof_names[GP_NBRANCH];
+
+extern gprof_tick gprof_now(void);
+
+extern void gprof_add(int id, gprof_tick dt);
+
+extern void gprof_begin(gprof_mark *m);
+
+extern void gprof_end(int id, gprof_mark *m);
+
+extern void gprof_transition(int from, int to);
+
+extern void gprof_reset(void);
+
+extern int gprof_read(double *calls, double *ticks, double *trans);
+
+extern int gprof_hwstart(void);
+
+extern void gprof_hwnow(unsigned long long *v);
+
+extern void gprof_hwstop(void);
+
+extern int gprof_readhw(double *hw);
+
+#if defined(ACGCA_PROFILE) && !defined(ACGCA_AD)
+/// Starts a timer t
+#define GPROF_BEGIN(t) gprof_mark t; gprof_begin(&t)
+/// Adds the time (and counts) since GPROF_BEGIN(t) to branch id
+#define GPROF_END(id, t) gprof_end((id), &(t))
+/// Runs the statement and adds its time (and counts) to branch id
+#define GPROF_CALL(id, ...) do{ gprof_mark gp_m0_; gprof_begin(&gp_m0_); \
+  __VA_ARGS__; gprof_end((id), &gp_m0_); }while(0)
+/// Counts a step going from growth_st from to growth_st to
+#define GPROF_TRANSITION(from, to) gprof_transition((from), (to))
+#else
+#define GPROF_BEGIN(t)
+#define GPROF_END(id, t)
+#define GPROF_CALL(id, ...) do{ __VA_ARGS__; }while(0)
+#define GPROF_TRANSITION(from, to)
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+/// \file growthad.h
+/// \brief Derivatives of the growthloop outputs with respect to species
+/// parameters by forward mode automatic differentiation (see growthad.cpp).
+/// Callable from C.
+/// \author Michael Fell
+
+#ifndef GROWTHAD_H
+#define GROWTHAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int growthad_run(double *gp2, double *r0, int nsteps, double *Io,
+  double *Hc, double *LAIF, double *forparms, double *sparms2,
+  int *startIndex, int *parameterLength, int npar, int *park, int nfield,
+  int *fields, double *value, double *grad);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
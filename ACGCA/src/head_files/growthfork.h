@@ -0,0 +1,18 @@
+/// \file growthfork.h
+/// \brief Running several futures from one saved tree (see growthfork.c)
+/// \author Michael Fell
+
+#ifndef GROWTHFORK_H
+#define GROWTHFORK_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+#include "resultstore.h"
+
+extern int growthloop_fork(gparms *gp, gcheckpoint *ck, int nbranch,
+  sparms p[], pschedule ps[], gforcing f[], goutput out[], int nsteps,
+  int t[], int nthreads, rstore *rs, long long runid0);
+
+#endif
@@ -6,7 +6,180 @@
 
 #include "misc_growth_funcs.h"
 
+/// \brief Indices of the double valued output arrays written by the growthloop.
+///
+/// The order follows the output arguments of Rgrowthloop() (APARout first).
+///
+typedef enum{
+  GF_APAR, GF_h, GF_hh, GF_hC, GF_hB, GF_hBH, GF_r, GF_rB, GF_rC, GF_rBH,
+  GF_sw, GF_vts, GF_vt, GF_vth, GF_sa, GF_la, GF_ra, GF_dr, GF_xa, GF_bl,
+  GF_br, GF_bt, GF_bts, GF_bth, GF_boh, GF_bos, GF_bo, GF_bs, GF_cs, GF_clr,
+  GF_fl, GF_fr, GF_ft, GF_fo, GF_rfl, GF_rfr, GF_rfs, GF_egrow, GF_ex,
+  GF_rtrans, GF_light, GF_nut, GF_deltas, GF_LAI,
+  GF_NDOUBLE
+} gfield;
 
+/// \brief Indices of the integer valued output arrays.
+typedef enum{
+  GI_status, GI_errorind, GI_growth_st,
+  GI_NINT
+} gifield;
+
+extern const char *gfield_names[GF_NDOUBLE];
+extern const char *gifield_names[GI_NINT];
+extern const int gfield_single[GF_NDOUBLE];
+
+/// Number of distinct events kept by a geventlog.
+#define EV_NEVENT 16
+
+/// Rows of geventlog.nstate: growth_st 0 to 6 and any error code.
+#define EV_NSTATE 8
+
+/// \brief Kinds of events in a geventlog.
+typedef enum{
+  EV_ERRORIND, ///< a bit of errorind, code is the value of the bit
+  EV_GROWTHST  ///< an error growth_st (not 0 to 6), code is growth_st
+} gevkind;
+
+/// \brief An event and the steps it occurred in.
+typedef struct{
+  int kind;  ///< gevkind
+  int code;
+  int count; ///< steps it occurred in
+  int first; ///< first step it occurred in
+  int last;  ///< last step it occurred in
+} gevent;
+
+/// \brief Summary of the errors of a run, a compact alternative to the per
+/// step errorind and growth_st arrays.  Initialize with
+/// growthloop_eventinit().
+typedef struct{
+  int nstate[EV_NSTATE]; ///< steps in growth_st 0 to 6 and error codes
+  int mask;              ///< OR of errorind over all steps
+  int nevent;            ///< events in event
+  int lost;              ///< occurrences of events that did not fit in event
+  gevent event[EV_NEVENT]; ///< events in the order they first occurred
+  int first;             ///< first step with an event, -1 if none
+  int firsterr;          ///< errorind of that step
+  int firstst;           ///< growth_st of that step
+  greal snap[GF_NDOUBLE]; ///< outputs (gfield) after that step
+} geventlog;
+
+/// \brief Time varying species parameters used by updateSparms().
+///
+/// parameterLength[k] > 1 marks parameter k as a vector indexed by step.
+///
+typedef struct{
+  double *hmax, *phih, *eta, *swmax, *lamdas, *lamdah, *rhomax, *rhomin,
+    *f2, *f1, *gammac, *gammaw, *gammax, *cgl, *cgr, *cgw, *deltal, *deltar,
+    *sl, *sla, *sr, *so, *rr, *rhor, *rml, *rms, *rmr, *etaB, *k, *epsg, *M,
+    *alpha, *R0, *R40;
+  int *parameterLength;
+} pschedule;
+
+/// \brief Light forcing for a run, indexed by step.  Hc[i] = -99 means no
+/// forest canopy (open grown tree).
+///
+/// drref is NULL or a reference radius increment per step (the dr output of
+/// an earlier run with similar parameters, e.g., the last accepted MCMC
+/// state).  drref[i] > 0 is the first guess of the radius solvers in step i
+/// and the second is a Newton step with the slope of the previous solve, so
+/// they usually need one or two demand evaluations instead of three.
+typedef struct{
+  double *Io;
+  double *Hc;
+  double *LAIF;
+  Forestparms *ForParms;
+  double *drref;
+} gforcing;
+
+/// \brief Everything the growthloop carries from one step to the next.
+///
+/// A checkpoint taken after any step can be used to continue the simulation
+/// later (see growthloop_resume()), so a long spin-up only has to be
+/// simulated once.
+///
+typedef struct{
+  sparms p; ///< species parameters in effect at the checkpoint
+  tstates st; ///< tree state variables
+  LAindex LAI; ///< leaf area index from the last call to LAIcalc()
+  Larea LA; ///< leaf area from the last call to LAIcalc()
+  int growthflag; ///< 1 if the tree is on the target allometry, 0 if not
+  int step; ///< steps completed since initialization (parameter schedule cursor)
+  greal rhist[2]; ///< basal radius one and two steps back, used by excessgrowingon()
+  double deltat; ///< timestep the state was simulated with
+  long solveiter; ///< demand evaluations of the radius solvers since initialization
+  double dslope; ///< last secant slope of the radius solvers (warm starts)
+  int growth_st; ///< growth state of the last step, 0 before the first (profiler)
+} gcheckpoint;
+
+/// \brief The inputs of one step kept by a flight recorder: the growthloop
+/// state with the species parameters of the step already set, and the
+/// forcing of the step.  flightrec_replay() runs the step again from it.
+typedef struct{
+  gcheckpoint ck;
+  int j;          ///< index of the step into the forcing and outputs
+  double Io, Hc, LAIF;
+  double drref;   ///< 0 if the run had no reference radius increments
+} gframe;
+
+/// \brief Flight recorder: the inputs of the last size steps of a run.  It
+/// stops at the first failing step (an errorind bit or an error growth_st,
+/// the events of a geventlog) so that step is the newest frame.  Initialize
+/// with growthloop_recinit(), see flightrec.c for the replay file.
+typedef struct{
+  gframe *frame; ///< ring buffer, frame[n % size] is written next
+  int size;      ///< frames in frame
+  int n;         ///< steps recorded
+  int fail;      ///< index j of the first failing step, -1 if none
+  int errorind;  ///< errorind of that step
+  int growth_st; ///< growth_st of that step
+} gflightrec;
+
+/// \brief Output arrays for one run, indexed by gfield and gifield.
+///
+/// Any array may be NULL in which case that output is not stored.  Index 0
+/// holds the starting state and index i the state after step i.  ev is NULL
+/// or an event log the steps are added to (see growthloop_event()), fr NULL
+/// or a flight recorder of the inputs of the steps.  f holds single
+/// precision arrays of outputs stored as float (mixed precision batches,
+/// see gfield_single), used where v is NULL.
+///
+typedef struct{
+  greal *v[GF_NDOUBLE];
+  int *iv[GI_NINT];
+  geventlog *ev;
+  gflightrec *fr;
+  float *f[GF_NDOUBLE];
+} goutput;
+
+/// Value of output k of out at index j as a double, 0 if it is not stored.
+#define GOUT_VAL(out, k, j) ((out)->v[k] != NULL ? (double) GVAL((out)->v[k][j]) : \
+  ((out)->f[k] != NULL ? (double) (out)->f[k][j] : 0))
+
+extern void growthloop_init(sparms *p, gparms *gp, double *r0, gcheckpoint *ck);
+
+extern void growthloop_store(gcheckpoint *ck, gparms *gp, goutput *out, int j);
+
+extern int growthloop_step(gparms *gp, gcheckpoint *ck, pschedule *ps,
+  gforcing *f, goutput *out, int j);
+
+extern int growthloop_run(gparms *gp, gcheckpoint *ck, pschedule *ps,
+  gforcing *f, goutput *out, int nsteps);
+
+extern int growthloop_resume(sparms *p, gparms *gp, gcheckpoint *ck,
+  pschedule *ps, gforcing *f, goutput *out, int nsteps);
+
+extern void growthloop_unpack(double *sparms2, int *startIndex,
+  int *parameterLength, sparms *p, pschedule *ps);
+
+extern void growthloop_eventinit(geventlog *ev);
+
+extern int growthloop_event(geventlog *ev, int j, int errorind, int growth_st);
+
+extern void growthloop_eventscan(goutput *out, int t, geventlog *ev);
+
+extern void growthloop_recinit(gflightrec *rec, gframe *frame, int size);
 
 extern void growthloop(sparms *p, gparms *gp, double *Io, double *r0, int *t,
   double *Hc, double *LAIF, Forestparms *ForParms, double *APARout,
@@ -93,7 +266,10 @@ extern void growthloop(sparms *p, gparms *gp, double *Io, double *r0, int *t,
 	double alpha[],
 	double R0[],
 	double R40[],
-	int parameterLength[]
+	int parameterLength[],
+	gcheckpoint *ckin,
+	gcheckpoint *ckout,
+	gflightrec *rec
   //int sparms_indicator[]
   //double *tolout,
   //double *errorout,
@@ -0,0 +1,85 @@
+/// \file gtrace.h
+/// \brief Trace probes of the growthloop and its solvers (see gtrace.c)
+///
+/// The probes are compiled in with -DACGCA_TRACE and each can then be
+/// switched on at run time (gtrace_config(), traceacgca() in R), or from the
+/// start with -DACGCA_TRACE_MASK=<bits>.  Without ACGCA_TRACE the macros
+/// below expand to nothing.  The dual number build of growthad.cpp is never
+/// traced.
+/// \author Michael Fell
+
+#ifndef GTRACE_H
+#define GTRACE_H
+
+/// \brief Trace probes.  Each record holds the step, an integer code and
+/// three values a, b and c:
+///   GT_run        Rgrowthloop(): code 1 if answered by the cache, a steps
+///   GT_LAI        LAIcalc(): a, b, c LAI tot, top and bot
+///   GT_APAR       APARcalc(): a APAR of the tree, b PAR above the tree
+///   GT_carbon     growthloop_step(): a gross photosynthesis, b maintenance
+///                 respiration, c excess labile carbon (ex)
+///   GT_branch     growthloop_step(): code growth_st of the step, a ex,
+///                 b ea (putonallometry), c erb (rebuildstaticstate); b and
+///                 c are 0 if the tree died before the branches
+///   GT_error      growthloop_step(): code errorind, a r, b h, c ex
+///   GT_egiter     excessgrowingon(): code iteration, a dr, b demand, c error
+///   GT_egrestart  excessgrowingon() restarts at slope 0: code restarts,
+///                 a dr, b slope, c error
+///   GT_egfail     excessgrowingon() gives up: code growth_st, a dr,
+///                 b slope, c error
+///   GT_poiter     putonallometry(): code iteration, a dr, b demand, c error
+///   GT_pofail     putonallometry() fails: code 1 (second iteration) and 2
+///                 (later) no secant step, a dr, b demand, c error; code 3
+///                 hmax <= 0, a dr, b hmax; code 4 negative radius, a dr,
+///                 b new radius, c radius
+///   GT_fault      an error branch of the model functions: code the
+///                 growth_st it sets (26-33 excessgrowingon, 34-41
+///                 excessgrowingoff), or 101 excessgrowingon hmax <= 0,
+///                 102 excessgrowingon NaN state, 111-115 initialize,
+///                 121-122 trunkradii, 131-135 trunkvolume, 141 LAIcalc NaN
+///                 LAI, 151 shrinkingsize retranslocation out of balance;
+///                 a r, b h, c ex of the tree (trunkradii and trunkvolume:
+///                 a and b the radius and height they are given, c 0)
+typedef enum{
+  GT_run, GT_LAI, GT_APAR, GT_carbon, GT_branch, GT_error, GT_egiter,
+  GT_egrestart, GT_egfail, GT_poiter, GT_pofail, GT_fault,
+  GT_NPROBE
+} gtprobe;
+
+/// \brief A trace record.
+typedef struct{
+  int probe;  ///< gtprobe
+  int thread; ///< buffer (thread) that wrote the record
+  int step;   ///< step of the growthloop (set by GTRACE_STEP())
+  int code;
+  double v[3];
+} gtrecord;
+
+extern const char *gtrace_names[GT_NPROBE];
+
+extern unsigned int gtrace_mask;
+
+extern void gtrace_step(int step);
+
+extern void gtrace_emit(int probe, int code, double a, double b, double c);
+
+extern int gtrace_config(unsigned int mask, int capacity);
+
+extern long long gtrace_count(long long *dropped);
+
+extern long long gtrace_read(gtrecord *rec, long long max);
+
+extern int gtrace_compiled(void);
+
+#if defined(ACGCA_TRACE) && !defined(ACGCA_AD)
+/// Writes a record of probe if it is switched on
+#define GTRACE(probe, code, a, b, c) do{ if(gtrace_mask & (1u << (probe))) \
+  gtrace_emit((probe), (code), (a), (b), (c)); }while(0)
+/// Sets the step of the records written by this thread
+#define GTRACE_STEP(step) do{ if(gtrace_mask) gtrace_step(step); }while(0)
+#else
+#define GTRACE(probe, code, a, b, c) do{ }while(0)
+#define GTRACE_STEP(step) do{ }while(0)
+#endif
+
+#endif
@@ -0,0 +1,179 @@
+/// \file mcmc.h
+/// \brief Adaptive Metropolis sampler over species parameters (see mcmc.c)
+/// \author Michael Fell
+
+#ifndef MCMC_H
+#define MCMC_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+#include "rng.h"
+
+/// Largest number of free parameters.
+#define MCMC_MAXPAR NSPARMS
+
+/// log(sqrt(2 pi)), the normal density is at most exp(-LOG_SQRT_2PI)/sd.
+#define LOG_SQRT_2PI 0.9189385332046727
+
+/// Number of batches kept for the batch means ESS (between NBATCH and
+/// 2*NBATCH batches of equal size).
+#define MCMC_NBATCH 32
+
+/// Prior distributions.  a and b of mprior are (min, max), (mean, sd) and
+/// (meanlog, sdlog).
+typedef enum{
+  MP_UNIFORM, MP_NORMAL, MP_LOGNORMAL
+} mpriortype;
+
+/// \brief Prior of one free parameter.
+typedef struct{
+  int type;
+  double a, b;
+} mprior;
+
+/// \brief One observation with normal error.  The model prediction is
+/// mult*(x[step] - x[step-lag]) for output field x, or mult*x[step] if lag
+/// is 0 (e.g., dbh is 2*rBH and a tree ring is rBH with lag steps).
+typedef struct{
+  int step;
+  int field;   ///< gfield index
+  int lag;
+  double mult;
+  double y;
+  double sd;
+} mobs;
+
+/// \brief What is sampled: the model set up, the free parameters with their
+/// priors, and the observations.  Read only while chains run so it can be
+/// shared by chains in different threads.
+///
+/// coarse is an optional cheaper version of the same target (e.g., fewer
+/// steps per year and a looser tolerance, with the same free parameters,
+/// priors and observations) that screens proposals before the full
+/// simulation (two stage delayed acceptance, Christen and Fox 2005).  The
+/// draws still follow the full posterior as long as the coarse tree does
+/// not die where the full one lives.
+typedef struct mtarget{
+  gparms gp;
+  sparms p;              ///< species parameters, free ones are replaced
+  pschedule *ps;         ///< time varying parameters (none of them free)
+  gforcing f;            ///< light forcing, indexed by step
+  double r0;             ///< initial radius
+  int nsteps;            ///< steps simulated per evaluation (last observation)
+  int npar;
+  int park[MCMC_MAXPAR]; ///< sparms index of each free parameter
+  mprior prior[MCMC_MAXPAR];
+  int nobs;
+  mobs *obs;             ///< sorted by step
+  double llmax;          ///< upper bound of the log likelihood
+  int warm;              ///< 1 to warm start the radius solvers from the dr
+                         ///< trajectory of the last accepted state
+  struct mtarget *coarse; ///< screening target or NULL
+} mtarget;
+
+/// \brief Running statistics of the kept draws of one chain for R-hat
+/// (Welford mean and variance) and the effective sample size (batch means,
+/// the batch size doubles whenever 2*MCMC_NBATCH batches are full).
+typedef struct{
+  long n;
+  double mean[MCMC_MAXPAR];
+  double m2[MCMC_MAXPAR];
+  long bsize, bcount;
+  int nb;
+  double bcur[MCMC_MAXPAR];
+  double bmean[2*MCMC_NBATCH*MCMC_MAXPAR];
+} mdiag;
+
+/// \brief One Markov chain with its simulation buffers, allocated once.
+typedef struct mchain{
+  mtarget *tg;
+  rngstate rng;
+  double theta[MCMC_MAXPAR];
+  double logpost;                        ///< loglik/temp + logprior
+  double loglik, logprior;
+  double temp;                           ///< temperature, 1 samples the posterior
+  long iter, accepted;
+  // Delayed acceptance (tg->coarse not NULL)
+  struct mchain *cs;                     ///< simulation buffers of tg->coarse
+  double *shift;                         ///< full minus coarse predictions at theta
+  long screened;                         ///< proposals that passed the screen
+  // Adaptive Metropolis (Haario et al. 2001)
+  int adaptstart;                        ///< iterations before adaptation
+  double scale0[MCMC_MAXPAR];            ///< initial proposal sd
+  double mean[MCMC_MAXPAR];              ///< running mean of the draws
+  double cov[MCMC_MAXPAR*MCMC_MAXPAR];   ///< running sums of squares
+  double L[MCMC_MAXPAR*MCMC_MAXPAR];     ///< Cholesky factor of the proposal
+  // Simulation
+  long simsteps;                         ///< steps simulated by iterations
+  long solveiter;                        ///< radius solver demand evaluations
+  double *drref;                         ///< dr of the last accepted state (warm)
+  gcheckpoint ck;
+  goutput out;
+  double *buf;
+  double *pred;                          ///< predictions of the observations at
+                                         ///< theta, at the proposal and scratch
+  // Kept draws (chains at temperature 1)
+  long kept;
+  mdiag diag;
+} mchain;
+
+/// \brief Settings of mcmc_sample().  Each of the nchain chains is a ladder
+/// of ntemp replicas at temperatures temps[0] = 1 < temps[1] < ...  All
+/// replicas run in parallel and every swapevery iterations one pair of
+/// neighbouring replicas per chain proposes to swap states.  Only the
+/// replicas at temperature 1 are kept.
+typedef struct{
+  int nchain, ntemp;
+  const double *temps;
+  long niter, burnin;
+  int thin, adaptstart, swapevery, nthreads;
+  uint64_t seed;
+  double stoprhat, stopess; ///< stop early once all R-hat < stoprhat and
+                            ///< all ESS > stopess (0 never stops)
+} mcmcopts;
+
+/// \brief Results of mcmc_sample().
+typedef struct{
+  double *draws;  ///< [(c*npar + k)*ndraw + i], may be NULL
+  double *lp;     ///< [c*ndraw + i], may be NULL
+  long ndraw;     ///< rows of draws and lp per chain
+  FILE *fp;       ///< if not NULL the kept draws are written as csv
+  long kept;      ///< returns the draws kept per chain
+  long iter;      ///< returns the iterations run
+  double *accept; ///< returns the acceptance rate of each chain [nchain]
+  double swaprate;
+  double steps;   ///< returns the mean steps simulated per iteration
+  double csteps;  ///< returns the mean coarse steps simulated per iteration
+  double screen;  ///< returns the fraction of proposals passing the screen
+  double solveiter; ///< returns the mean radius solver demand evaluations
+                    ///< per simulated step
+  double *rhat;   ///< returns R-hat [npar], NAN for a single chain
+  double *ess;    ///< returns the ESS over all chains [npar]
+} mcmcres;
+
+extern int mcmc_obs_sort(mtarget *tg);
+
+extern double mcmc_logprior(mtarget *tg, const double *theta);
+
+extern double mcmc_loglik(mchain *c, const double *theta, double llmin,
+  const double *shift, double *pred);
+
+extern int mcmc_chain_init(mchain *c, mtarget *tg, const double *theta0,
+  const double *scale, double temp, int adaptstart, uint64_t seed,
+  uint64_t stream);
+
+extern int mcmc_iterate(mchain *c);
+
+extern void mcmc_diag(mchain *cold[], int nchain, int npar, double *rhat,
+  double *ess);
+
+extern int mcmc_sample(mtarget *tg, const double *theta0, const double *scale,
+  mcmcopts *o, mcmcres *r);
+
+extern void mcmc_write_header(FILE *fp, mtarget *tg);
+
+extern void mcmc_chain_free(mchain *c);
+
+#endif
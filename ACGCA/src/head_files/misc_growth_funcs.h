@@ -16,12 +16,24 @@
 #define MISC_GROWTH_FUNCS_H
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+/// \brief Scalar type of the species parameters and tree states.
+///
+/// double, except in the forward mode AD build (growthad.cpp), which defines
+/// ACGCA_AD and compiles the model sources a second time with greal a dual
+/// number type (dual.h).  GVAL(x) is the value of x without derivatives,
+/// for comparisons that must not see the AD type and for printing.
+#ifndef ACGCA_AD
+typedef double greal;
+#define GVAL(x) (x)
+#endif
+
 #define fminmacro(X, Y) ((X) < (Y) ? (X) : (Y))
 #define fmaxmacro(X, Y) ((X) > (Y) ? (X) : (Y))
 
@@ -33,43 +45,43 @@
 ///
 ///
 typedef struct{
-  double hmax; ///< Max. tree height
-  double phih; ///< Slope at H vs. r curve at r=0
-  double eta; ///< Relative crown height
-  double etaB; ///< Relative height at which trunc transitions from a 
+  greal hmax; ///< Max. tree height
+  greal phih; ///< Slope at H vs. r curve at r=0
+  greal eta; ///< Relative crown height
+  greal etaB; ///< Relative height at which trunc transitions from a 
 			   ///neiloid to parabolid
-  double swmax; ///< Maximum sapwood width
-  double lamdas; ///< Proportionality between BT and BO for sapwood
-  double lamdah; ///< Proportionality between BT and BO for heart
-  double rhomax; ///< Wood density
-  double rhomin; ///< Wood density
-  double f2; ///< Leaf area to xylem conducting area ratio
-  double f1; ///< Fine root area to leaf area ratio
-  double gammac; ///< Max. storage capacity of sapwood cellsx
-  double gammaw; ///< (Inverse) density of sapwood structural tissue
-  double gammax; ///< Xylem conducting area to sapwood area ratio
-  double cgl; ///< Construction costs of producing leaves
-  double cgr; ///< Construction costs of producing fine roots
-  double cgw; ///< Construction costs of producing sapwood
-  double deltal; ///< Labile carbon storage capacity of leaves
-  double deltar; ///< Labile carbon storage capacity of fine roots
-  double sl; ///< Senescence rate of leaves
-  double sla; ///< Specific leaf area
-  double sr; ///< Senescence rate of fine roots
-  double so; ///< Senescence rate of course roots and branches
-  double rr; ///< Average fine root radius
-  double rhor; ///< Tissue density of fine roots
-  double rml; ///< Maintenance respiration rate of leaves
-  double rms; ///< Maintenance respiration rate of sapwood
-  double rmr; ///< Maintenance respiration rate of fine roots
-  double drcrit; ///< ???
-  double drinit; ///< radial increment (may vary by tree??)
-  double K; ///< Crown light extinction coefficient
-  double epsg; ///< Radiation-use-efficiency 
-  double M; ///< Maximum relative crown depth
-  double alpha; ///< Crown Curvature parameter
-  double R0; ///< Maximum potential crown radius of a tree with diameter at breast height of 0 m.
-  double R40; ///< Maximum potential crown radius of a tree with diameter at breast height of 0.4 m.
+  greal swmax; ///< Maximum sapwood width
+  greal lamdas; ///< Proportionality between BT and BO for sapwood
+  greal lamdah; ///< Proportionality between BT and BO for heart
+  greal rhomax; ///< Wood density
+  greal rhomin; ///< Wood density
+  greal f2; ///< Leaf area to xylem conducting area ratio
+  greal f1; ///< Fine root area to leaf area ratio
+  greal gammac; ///< Max. storage capacity of sapwood cellsx
+  greal gammaw; ///< (Inverse) density of sapwood structural tissue
+  greal gammax; ///< Xylem conducting area to sapwood area ratio
+  greal cgl; ///< Construction costs of producing leaves
+  greal cgr; ///< Construction costs of producing fine roots
+  greal cgw; ///< Construction costs of producing sapwood
+  greal deltal; ///< Labile carbon storage capacity of leaves
+  greal deltar; ///< Labile carbon storage capacity of fine roots
+  greal sl; ///< Senescence rate of leaves
+  greal sla; ///< Specific leaf area
+  greal sr; ///< Senescence rate of fine roots
+  greal so; ///< Senescence rate of course roots and branches
+  greal rr; ///< Average fine root radius
+  greal rhor; ///< Tissue density of fine roots
+  greal rml; ///< Maintenance respiration rate of leaves
+  greal rms; ///< Maintenance respiration rate of sapwood
+  greal rmr; ///< Maintenance respiration rate of fine roots
+  greal drcrit; ///< ???
+  greal drinit; ///< radial increment (may vary by tree??)
+  greal K; ///< Crown light extinction coefficient
+  greal epsg; ///< Radiation-use-efficiency 
+  greal M; ///< Maximum relative crown depth
+  greal alpha; ///< Crown Curvature parameter
+  greal R0; ///< Maximum potential crown radius of a tree with diameter at breast height of 0 m.
+  greal R40; ///< Maximum potential crown radius of a tree with diameter at breast height of 0.4 m.
   /* NOTE: f2 = gammax*NEWf2, where NEWf2 is actually the value reported for
    * f2 in the tree growth manuscript (Ogle and Pacala 2009). */
 } sparms;
@@ -98,18 +110,18 @@ typedef struct{
 ///
 ///
 typedef struct{
-  double tot; ///< ???
-  double top; ///< ???
-  double bot; ///< ???
+  greal tot; ///< ???
+  greal top; ///< ???
+  greal bot; ///< ???
 } LAindex;
 
 /// \brief Leaf area (index??) structures
 ///
 ///
 typedef struct{
-  double tot; ///< ???
-  double top; ///< ???
-  double bot; ///< ???
+  greal tot; ///< ???
+  greal top; ///< ???
+  greal bot; ///< ???
 } Larea;
 
 
@@ -128,72 +140,72 @@ typedef struct{
 /// don't need
 ///
 typedef struct{
-  double hB; ///< ???
-  double hC; ///< ???
-  double H; ///< ???
-  double hBH; ///< ???
+  greal hB; ///< ???
+  greal hC; ///< ???
+  greal H; ///< ???
+  greal hBH; ///< ???
 } height;
 
 /// \brief Radius structure for LAIcalc()
 /// don't need
 ///
 typedef struct{
-  double r0; ///< ???
-  double rB; ///< ???
-  double rC; ///< ???,
-  double rBH; ///< ???
+  greal r0; ///< ???
+  greal rB; ///< ???
+  greal rC; ///< ???,
+  greal rBH; ///< ???
 } radius;
 
 /// \brief Volume structure for LAIcalc() and trunkvolume()
 /// don't need
 ///
 typedef struct{
-   double vt; ///< total trunk volume
-   double vts; ///< volume of trunk sapwood
-   double vth; /// volume of trunk heartwood
+   greal vt; ///< total trunk volume
+   greal vts; ///< volume of trunk sapwood
+   greal vth; /// volume of trunk heartwood
 } volume;
 
 
 /* These are scalar.  New values will be printed to a file, and any values needed
  * For MCMC will be returned as needed. */
 typedef struct{
-  double h; ///<  tree height, m
-  double hh; ///< height to base of crown, m
-  double hC; ///< same as hh
-  double hB; ///<??
-  double hBH; ///<
-  double r; ///< basal trunk radius, m
-  double rB; ///< trunk radius at neiloid to paraboloid transition, m
-  double rC; ///< trunk radius at paraboloid to cone transition, m
-  double rBH; ///< trunk radius at breast height, m
-  double sw; ///< sapwood width at base, m
-  double vts; ///< trunk sapwood volume, m3
-  double vt; ///< total trunk volume, m3
-  double vth; ///< trunk heartwood volume, m3
-  double sa; ///< sapwood area at base, m2
-  double la; ///< total leaf area, m2
-  double ra; ///< total fineroot surface area, m2
-  double dr; ///< radia increment
-  double xa; ///<
-  double bl; ///< leaf biomass, g dw
-  double br; ///< root biomass, g dw
-  double bt; ///< total trunk biomass, g dw
-  double bts; ///< trunk sapwood biomass, g dw
-  double bth; ///< trunk heartwood biomass, g dw
-  double boh; ///< heartwood biomass of c. roots & branches, g dw
-  double bos; ///< sapwood biomass of coarse roots & branches, g dw
-  double bo; ///< total biomass of c. roots & branches, g dw
-  double bs; ///< total sapwood biomass, bos+bts, g dw
-
-  double cs; ///< labile carbon in sapwood, g glucose
-  double clr; ///< labile carbin in leaves & fineroots, g gluc
-  double fl; ///< relative allocation to leaves
-  double fr; ///< relative allocation to fine roots
-  double ft; ///< relative allocation to trunk
-  double fo; ///< relative allocation to trunk
-  double rfl; ///< relative retranslocation from leaves
-  double rfr; ///< relative retranslocation from fineroots
-  double rfs; ///< relative retranslocation from sapwood
+  greal h; ///<  tree height, m
+  greal hh; ///< height to base of crown, m
+  greal hC; ///< same as hh
+  greal hB; ///<??
+  greal hBH; ///<
+  greal r; ///< basal trunk radius, m
+  greal rB; ///< trunk radius at neiloid to paraboloid transition, m
+  greal rC; ///< trunk radius at paraboloid to cone transition, m
+  greal rBH; ///< trunk radius at breast height, m
+  greal sw; ///< sapwood width at base, m
+  greal vts; ///< trunk sapwood volume, m3
+  greal vt; ///< total trunk volume, m3
+  greal vth; ///< trunk heartwood volume, m3
+  greal sa; ///< sapwood area at base, m2
+  greal la; ///< total leaf area, m2
+  greal ra; ///< total fineroot surface area, m2
+  greal dr; ///< radia increment
+  greal xa; ///<
+  greal bl; ///< leaf biomass, g dw
+  greal br; ///< root biomass, g dw
+  greal bt; ///< total trunk biomass, g dw
+  greal bts; ///< trunk sapwood biomass, g dw
+  greal bth; ///< trunk heartwood biomass, g dw
+  greal boh; ///< heartwood biomass of c. roots & branches, g dw
+  greal bos; ///< sapwood biomass of coarse roots & branches, g dw
+  greal bo; ///< total biomass of c. roots & branches, g dw
+  greal bs; ///< total sapwood biomass, bos+bts, g dw
+
+  greal cs; ///< labile carbon in sapwood, g glucose
+  greal clr; ///< labile carbin in leaves & fineroots, g gluc
+  greal fl; ///< relative allocation to leaves
+  greal fr; ///< relative allocation to fine roots
+  greal ft; ///< relative allocation to trunk
+  greal fo; ///< relative allocation to trunk
+  greal rfl; ///< relative retranslocation from leaves
+  greal rfr; ///< relative retranslocation from fineroots
+  greal rfs; ///< relative retranslocation from sapwood
 
   //%           st.LAtop = LA of target tree above the forest canopy (m2);
   //%           st.LAbot = LA of target tree below the forest canopy (m2);
@@ -201,15 +213,15 @@ typedef struct{
   //%           st.LAItop = LAI of target tree above the forest canopy
   //%           st.LAIbot = LAI of target tree below the forest canopy
 
-  double egrow; ///< excess labile carbon available for growth, g gluc
-  double ex; ///< excess labile carbon after maintenance, g gluc
-  double rtrans; ///< total labile carbon retranslocated, g gluc
-  double light; ///< annual absorbed PAR, mol m2 year1) (UNITS CHANGE?)
+  greal egrow; ///< excess labile carbon available for growth, g gluc
+  greal ex; ///< excess labile carbon after maintenance, g gluc
+  greal rtrans; ///< total labile carbon retranslocated, g gluc
+  greal light; ///< annual absorbed PAR, mol m2 year1) (UNITS CHANGE?)
   //double t; ///< time, fraction of year?
-  double nut; ///< sapwood-to-heartwood conversion in trunk
-  double deltas; ///<
+  greal nut; ///< sapwood-to-heartwood conversion in trunk
+  greal deltas; ///<
   //double cstar; ///<
-  double LAI; ///<
+  greal LAI; ///<
   int status; ///< dead or alive
   //int Jstatus;
   //int yr; ///< time, year
@@ -219,15 +231,15 @@ typedef struct{
 
 //Intermediate structure.  Needed in shrinkingsize.c functions.
 typedef struct{
-  double bosmax,bosmid,bosmin,bosst,bohst,blst,brst,bosl,bosr,boso;
+  greal bosmax,bosmid,bosmin,bosst,bohst,blst,brst,bosl,bosr,boso;
 } bioms;
 
 typedef struct{
-  double nuoerb,elerb,ererb,eoerb,erb;
+  greal nuoerb,elerb,ererb,eoerb,erb;
 } rebuild;
 
 typedef struct{
-  double eo,el,er,ea,nuoa;
+  greal eo,el,er,ea,nuoa;
 } puton;
 /// \brief These parameters are a subset of the sparms that are updated via MCMC
 ///
@@ -238,18 +250,44 @@ typedef struct{
   double hmax,phih,sla,rhomax;
 } model_parms;
 
+/// \brief Number of entries in sparms, in the order of the sparms list in R
+/// followed by rhomin, gammaw, drinit and drcrit (as packed by runacgca()).
+#define NSPARMS 36
+
+/// \brief Number of double valued entries in tstates (everything but status).
+#define NTSTATES 43
+
+/// Names and byte offsets of the sparms entries.  Index k matches index k of
+/// parameterLength in Rgrowthloop().
+extern const char *sparms_names[NSPARMS];
+extern const size_t sparms_offsets[NSPARMS];
+
+/// Names and byte offsets of the double valued tstates entries.
+extern const char *tstates_names[NTSTATES];
+extern const size_t tstates_offsets[NTSTATES];
+
+/// Access an entry of sparms or tstates by its table index.
+#define SPARMS_REF(p, k) ((greal *)((char *)(p) + sparms_offsets[(k)]))
+#define TSTATES_REF(st, k) ((greal *)((char *)(st) + tstates_offsets[(k)]))
+
+extern int sparms_index(const char *name);
+
+extern void sparms_set(sparms *p, int k, greal v, int rhominset);
+
+extern int species_parms(const char *name, double *v);
+
 extern void initialize(sparms *p, gparms *gp, tstates *st, double *r0);
 
-extern void trunkradii(double r0, height *h, radius *r, tstates *st);
+extern void trunkradii(greal r0, height *h, radius *r, tstates *st);
 
-extern void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st);
+extern void trunkvolume(radius *r, height *h, greal sw, volume *v, tstates *st);
 
 
-extern void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
-		    double H, double rBH, sparms *p, gparms *gp, double Hc,
+extern void LAIcalc(LAindex *LAI, Larea *LA, greal LAtot, greal r0,
+		    greal H, greal rBH, sparms *p, gparms *gp, double Hc,
 		    tstates *st);
 
-extern void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, double H,
+extern void APARcalc(greal *APARout, LAindex *LAI, Larea *LA, greal eta, greal k, greal H,
                        double Hc, double FLAI, double Io,
                        Forestparms *ForParms);
 
@@ -8,6 +8,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <R.h>
+#include "rprint.h"
 
-extern double photosynthesis(sparms *p, tstates *st);
\ No newline at end of file
+extern greal photosynthesis(sparms *p, tstates *st);
\ No newline at end of file
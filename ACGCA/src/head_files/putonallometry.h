@@ -7,7 +7,8 @@
 //#include "head_files/misc_growth_funcs.h"
 
 
-extern void putonallometry(tstates *st, sparms *p, gparms *gp, puton *pton, int i, double deltaw);
+extern int putonallometry(tstates *st, sparms *p, gparms *gp, puton *pton, int i, greal deltaw,
+  double warm[]);
 
 
 #endif
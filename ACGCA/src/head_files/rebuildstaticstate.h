@@ -3,6 +3,6 @@
 
 #include "misc_growth_funcs.h"
 
-extern void rebuildstaticstate(sparms *p, tstates *st,  gparms *gp, rebuild *rebld, int i, double deltaw);
+extern void rebuildstaticstate(sparms *p, tstates *st,  gparms *gp, rebuild *rebld, int i, greal deltaw);
 
 #endif
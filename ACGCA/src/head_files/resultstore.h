@@ -0,0 +1,55 @@
+/// \file resultstore.h
+/// \brief Columnar binary store for simulation results (see resultstore.c)
+/// \author Michael Fell
+
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+
+/// Version of the result store layout.  Bump when the layout changes.
+#define RSTORE_VERSION 2
+
+/// Length of a field name in the header (including the terminating 0).
+#define RSTORE_NAMELEN 16
+
+/// \brief An open result store.
+///
+/// The file holds a header describing the fields followed by one record
+/// per run.  A record holds the run id, the number of stored steps and one
+/// column chunk of lenvars values per field (doubles first, then integers),
+/// either as is (fixed size records) or encoded (see encoding.c).  Records
+/// are only ever appended and a partly written last record is ignored.
+///
+typedef struct{
+  FILE *fp;        ///< open file (append mode when writing)
+  char *map;       ///< memory map of the file when reading (NULL if not mapped)
+  size_t maplen;   ///< length of map
+  int writable;    ///< 1 if opened with rstore_open()
+  int lenvars;     ///< values per column chunk (steps*years+1)
+  int nd;          ///< number of double valued fields
+  int ni;          ///< number of integer valued fields
+  int did[GF_NDOUBLE]; ///< gfield index of double field k
+  int iid[GI_NINT];    ///< gifield index of integer field k
+  long long hdrsize;    ///< bytes before the first record
+  long long recsize;    ///< bytes per record
+  long long nrec;       ///< number of complete records
+  int encoding;    ///< ENC_RAW, ENC_EXACT or ENC_QUANT
+  double errbound; ///< relative error bound of ENC_QUANT
+  long long *recoff; ///< offsets of the encoded records when reading
+} rstore;
+
+extern int rstore_open(rstore *rs, const char *file, int lenvars, goutput *fields,
+  int encoding, double errbound);
+extern int rstore_append(rstore *rs, long long runid, int nstored, goutput *out);
+extern int rstore_openread(rstore *rs, const char *file);
+extern long long rstore_runid(rstore *rs, long long rec);
+extern int rstore_nstored(rstore *rs, long long rec);
+extern int rstore_column(rstore *rs, long long rec, int k, double *dst);
+extern int rstore_icolumn(rstore *rs, long long rec, int k, int *dst);
+extern void rstore_close(rstore *rs);
+
+#endif
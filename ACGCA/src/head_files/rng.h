@@ -0,0 +1,20 @@
+/// \file rng.h
+/// \brief Random numbers for the samplers (see rng.c)
+/// \author Michael Fell
+
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+
+/// \brief State of a xoshiro256** generator.  Each chain or thread has its
+/// own so no state is shared.
+typedef struct{
+  uint64_t s[4];
+} rngstate;
+
+extern void rng_seed(rngstate *rng, uint64_t seed, uint64_t stream);
+extern uint64_t rng_next(rngstate *rng);
+extern double rng_unif(rngstate *rng);
+extern double rng_norm(rngstate *rng);
+
+#endif
@@ -0,0 +1,17 @@
+/// \file rprint.h
+/// \brief Lets the model sources build with or without R.  The model only
+/// needs Rprintf() from R; the standalone build (standalone/makefile)
+/// defines ACGCA_STANDALONE and prints with printf() instead.
+/// \author Michael Fell
+
+#ifndef RPRINT_H
+#define RPRINT_H
+
+#ifdef ACGCA_STANDALONE
+#include <stdio.h>
+#define Rprintf printf
+#else
+#include <R.h>
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+/// \file sensitivity.h
+/// \brief Global sensitivity analysis (Morris and Sobol) over species
+/// parameters (see sensitivity.c)
+/// \author Michael Fell
+
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+#include "rng.h"
+
+/// Largest number of outputs analysed at once.
+#define SA_MAXOUT 16
+
+/// Outputs that are not a gfield: the time of death in years (the simulated
+/// years if the tree lives) and the total biomass bl + br + bt + bo.
+#define SA_DEATH -1
+#define SA_BIOMASS -2
+
+/// \brief The model set up, the varied parameters with their ranges and the
+/// outputs.  Read only while the runs are done so it is shared by threads.
+typedef struct{
+  gparms gp;
+  sparms p;              ///< species parameters, varied ones are replaced
+  pschedule *ps;         ///< time varying parameters (none of them varied)
+  gforcing f;            ///< light forcing, indexed by step
+  double r0;             ///< initial radius
+  int nsteps;            ///< steps simulated per run
+  int npar;
+  int park[NSPARMS];     ///< sparms index of each varied parameter
+  double lo[NSPARMS];    ///< range of each varied parameter
+  double hi[NSPARMS];
+  int nout;
+  int out[SA_MAXOUT];    ///< gfield, SA_DEATH or SA_BIOMASS
+  double mult[SA_MAXOUT]; ///< outputs are mult times the value at the end
+} satarget;
+
+/// \brief Sobol indices for each output o and parameter k at [o*npar + k].
+typedef struct{
+  long n;        ///< returns the rows (base samples) used
+  long nskip;    ///< returns the rows skipped since an output was not finite
+  double *mean;  ///< returns the mean of each output [nout]
+  double *var;   ///< returns the variance of each output [nout]
+  double *S1;    ///< returns the first order indices
+  double *ST;    ///< returns the total indices
+  double *S1se;  ///< returns the standard errors, may be NULL
+  double *STse;
+} sasobol;
+
+/// \brief Morris elementary effects (on the unit scale of each range) for
+/// each output o and parameter k at [o*npar + k].
+typedef struct{
+  long n;        ///< returns the trajectories used
+  long nskip;    ///< returns the trajectories skipped (not finite outputs)
+  double *mu;    ///< returns the mean effect
+  double *mustar; ///< returns the mean absolute effect
+  double *sigma; ///< returns the sd of the effects
+} samorris;
+
+extern int sa_eval(const satarget *t, const double *u, double *y);
+
+extern int sa_sobol(const satarget *t, long n, uint64_t seed, int nthreads,
+  sasobol *r);
+
+extern int sa_morris(const satarget *t, long n, int levels, uint64_t seed,
+  int nthreads, samorris *r);
+
+#endif
@@ -3,16 +3,16 @@
 
 #include "misc_growth_funcs.h"
 
-extern void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, double *deltaw, double *pnet);
+extern void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, greal *deltaw, greal *pnet);
 
 
 extern void shrinkingsizeA(sparms *p, tstates *st, gparms *gp, int i,
-			   double *deltaw, bioms *bio, double *csst,
-			   double *pnet);
+			   greal *deltaw, bioms *bio, greal *csst,
+			   greal *pnet);
 
 
 extern void shrinkingsizeB(sparms *p, tstates *st, gparms *gp, int i,  
-			   double *deltaw, bioms *bio, double *csst, 
-			   double *pnet);
+			   greal *deltaw, bioms *bio, greal *csst, 
+			   greal *pnet);
 
 #endif
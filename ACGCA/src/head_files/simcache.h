@@ -0,0 +1,51 @@
+/// \file simcache.h
+/// \brief Content addressed cache of simulation results (see simcache.c)
+/// \author Michael Fell
+
+#ifndef SIMCACHE_H
+#define SIMCACHE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+
+/// Version of the model hashed into every key.  Bump when a change to the
+/// growth code changes its outputs so old cached results are not reused.
+#define SIMCACHE_MODEL "ACGCA 1.0 growthloop 2"
+
+/// Version of the layout of the cache files on disk.
+#define SIMCACHE_VERSION 1
+
+/// Default memory budget of the cache in bytes.
+#define SIMCACHE_DEFSIZE (256LL << 20)
+
+/// \brief 128 bit key of a simulation: two independent 64 bit hashes of
+/// everything the outputs depend on.
+typedef struct{
+	uint64_t h[2];
+} simkey;
+
+/// \brief Counters of the cache, returned by simcache_stats().
+typedef struct{
+	long long hits;      ///< lookups found in memory
+	long long dhits;     ///< lookups found on disk
+	long long misses;    ///< lookups not found
+	long long evictions; ///< entries dropped from memory to stay in budget
+	long long entries;   ///< entries in memory
+	long long bytes;     ///< bytes of the entries in memory
+	long long maxbytes;  ///< memory budget
+} simstats;
+
+extern simkey simcache_key(const double *gp2, const double *r0, int lenvars,
+	const double *Io, const double *Hc, const double *LAIF, const double *kF,
+	const double *intF, const double *slopeF, const double *sparms2,
+	const int *startIndex, const int *parameterLength);
+extern int simcache_get(const simkey *key, int lenvars, goutput *out, int *t);
+extern void simcache_put(const simkey *key, int lenvars, int t, goutput *out);
+extern int simcache_config(long long maxbytes, const char *dir);
+extern void simcache_clear(void);
+extern void simcache_stats(simstats *s);
+
+#endif
@@ -0,0 +1,49 @@
+/// \file surrogate.h
+/// \brief Polynomial chaos emulator of yearly DBH and survival over a box
+/// of species parameters (see surrogate.c)
+/// \author Michael Fell
+
+#ifndef SURROGATE_H
+#define SURROGATE_H
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc_growth_funcs.h"
+#include "growthloop.h"
+#include "explore.h"
+
+/// Highest total degree of the polynomials.
+#define SG_MAXDEG 10
+
+/// \brief A fitted emulator.  Output o of a point is
+/// sum_b coef[b*nout + o] * prod_k L_alpha[b*npar + k](xi_k), where L_d is
+/// the orthonormal Legendre polynomial of degree d and xi_k in [-1, 1] the
+/// position of parameter k in its range (on its scale).
+typedef struct{
+  int npar;
+  int deg;       ///< total degree
+  int nbasis;    ///< number of polynomials, choose(npar + deg, deg)
+  int *alpha;    ///< degrees of each polynomial [nbasis*npar]
+  int nout;      ///< outputs, dbh then alive at each output step
+  double *coef;  ///< coefficients [nbasis*nout]
+} sgmodel;
+
+extern int sg_nbasis(int npar, int deg);
+
+extern void sg_multiindex(int npar, int deg, int *alpha);
+
+extern int sg_sim(const extarget *t, int every, const double *x, double *rbh,
+  double *y);
+
+extern int sg_train(const extarget *t, int every, long long n, uint64_t seed,
+  int nthreads, sgmodel *m, double *loo);
+
+extern int sg_predict(const extarget *t, int every, const sgmodel *m,
+  long long nx, const double *x, int fallback, int nthreads, double *y,
+  int *sim);
+
+extern int sg_validate(const extarget *t, int every, const sgmodel *m,
+  long long n, long long nval, uint64_t seed, int nthreads, double *ypred,
+  double *ytrue);
+
+#endif
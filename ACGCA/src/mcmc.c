@@ -0,0 +1,730 @@
+/// \file mcmc.c
+/// \brief Adaptive Metropolis sampler (Haario et al. 2001) over a set of
+/// free species parameters, with priors and a normal likelihood of observed
+/// sizes (e.g., diameters or tree ring widths).
+///
+/// The whole chain runs in C.  Each chain allocates its output buffers once
+/// and every proposal runs the growthloop step by step into them, so the
+/// only cost per iteration is the simulation itself.  Proposals start out
+/// as independent normal steps with sd scale0 and after adaptstart
+/// iterations use (2.38^2/d) times the covariance of the chain so far.
+///
+/// mcmc_sample() runs several chains, each optionally a ladder of tempered
+/// replicas (parallel tempering) for multimodal posteriors, in parallel
+/// with OpenMP.  Each replica stays on one thread (static schedule) and
+/// allocates its buffers there.  R-hat and the effective sample size are
+/// updated as draws are kept.
+///
+/// Simulations stop once the proposal is certain to be rejected, and with
+/// a coarse target (mtarget) proposals are first screened with a cheaper
+/// simulation (delayed acceptance, Christen and Fox 2005).
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/rng.h"
+#include "head_files/mcmc.h"
+
+// Orders by step and then by lag, field and value so that a coarse copy of
+// the observations (steps and lags divided by the same factor) sorts the
+// same way.
+static int mobs_cmp(const void *a, const void *b){
+  const mobs *x = a, *y = b;
+  if(x->step != y->step){
+    return (x->step > y->step) - (x->step < y->step);
+  }
+  if(x->lag != y->lag){
+    return (x->lag > y->lag) - (x->lag < y->lag);
+  }
+  if(x->field != y->field){
+    return (x->field > y->field) - (x->field < y->field);
+  }
+  return (x->y > y->y) - (x->y < y->y);
+}
+
+/// mcmc_obs_sort() sorts the observations by step and sets the number of
+/// steps to simulate and the largest possible log likelihood.  Returns 1 if
+/// an observation refers to a step before the start of the run, 0 otherwise.
+int mcmc_obs_sort(mtarget *tg){
+  qsort(tg->obs, tg->nobs, sizeof(mobs), mobs_cmp);
+  tg->nsteps = 0;
+  tg->llmax = 0;
+  for(int k = 0; k < tg->nobs; k++){
+    tg->llmax -= log(tg->obs[k].sd) + LOG_SQRT_2PI;
+    if(tg->obs[k].step - tg->obs[k].lag < 0){
+      return 1;
+    }
+    if(tg->obs[k].step > tg->nsteps){
+      tg->nsteps = tg->obs[k].step;
+    }
+  }
+  return 0;
+}
+
+/// mcmc_logprior() returns the log prior density of theta, -INFINITY
+/// outside the support.
+double mcmc_logprior(mtarget *tg, const double *theta){
+  double lp = 0, z;
+
+  for(int k = 0; k < tg->npar; k++){
+    mprior *pr = &tg->prior[k];
+    switch(pr->type){
+    case MP_UNIFORM:
+      if(theta[k] < pr->a || theta[k] > pr->b){
+        return -INFINITY;
+      }
+      lp -= log(pr->b - pr->a);
+      break;
+    case MP_NORMAL:
+      z = (theta[k] - pr->a)/pr->b;
+      lp -= 0.5*z*z + log(pr->b);
+      break;
+    case MP_LOGNORMAL:
+      if(theta[k] <= 0){
+        return -INFINITY;
+      }
+      z = (log(theta[k]) - pr->a)/pr->b;
+      lp -= 0.5*z*z + log(pr->b) + log(theta[k]);
+      break;
+    }
+  }
+  return lp;
+}
+
+/// mcmc_loglik() simulates the tree with the free parameters set to theta
+/// and returns the log likelihood of the observations (normal errors).  A
+/// tree that dies before the last observation has likelihood 0.
+///
+/// Each observation adds at most -log(sd) - log(sqrt(2 pi)) so once the
+/// terms so far plus this bound for the observations still to come fall
+/// to llmin the simulation stops and -INFINITY is returned.  A Metropolis
+/// step that draws its uniform first passes the log likelihood it needs to
+/// accept, so simulations of proposals that are certain to be rejected end
+/// early (delayed acceptance without approximation).
+///
+/// \param c        chain, its buffers are used for the simulation
+/// \param theta    free parameter values
+/// \param llmin    -INFINITY to always simulate to the last observation
+/// \param shift    NULL or added to the prediction of each observation
+/// \param pred     NULL or returns the prediction of each observation
+///                 (without shift)
+///
+double mcmc_loglik(mchain *c, const double *theta, double llmin,
+  const double *shift, double *pred){
+  mtarget *tg = c->tg;
+  sparms p = tg->p;
+  double ll = 0, rest = tg->llmax, x0, z, r0 = tg->r0;
+  int j, k, o = 0;
+  gforcing f;
+
+  for(k = 0; k < tg->npar; k++){
+    sparms_set(&p, tg->park[k], theta[k], 0);
+  }
+
+  // Warm start from the last accepted simulation
+  f = tg->f;
+  f.drref = c->drref;
+
+  growthloop_init(&p, &tg->gp, &r0, &c->ck);
+  growthloop_store(&c->ck, &tg->gp, &c->out, 0);
+  for(j = 0; ; j++){
+    // Observations at this step
+    for(; o < tg->nobs && tg->obs[o].step == j; o++){
+      mobs *ob = &tg->obs[o];
+      double *x = c->out.v[ob->field];
+      x0 = ob->mult*(ob->lag > 0 ? x[j] - x[j - ob->lag] : x[j]);
+      if(pred != NULL){
+        pred[o] = x0;
+      }
+      z = (ob->y - x0 - (shift != NULL ? shift[o] : 0))/ob->sd;
+      ll -= 0.5*z*z + log(ob->sd) + LOG_SQRT_2PI;
+      rest += log(ob->sd) + LOG_SQRT_2PI;
+    }
+    if(o == tg->nobs){
+      break;
+    }
+    if(ll + rest <= llmin || isnan(ll)){
+      ll = -INFINITY;
+      break;
+    }
+    c->simsteps++;
+    if(growthloop_step(&tg->gp, &c->ck, tg->ps, &f, &c->out, j + 1)){
+      ll = -INFINITY;
+      break;
+    }
+  }
+  c->solveiter += c->ck.solveiter;
+  return isnan(ll) ? -INFINITY : ll;
+}
+
+// Log likelihood of given predictions of the observations.
+static double mcmc_obsll(mtarget *tg, const double *pred){
+  double ll = 0, z;
+
+  for(int o = 0; o < tg->nobs; o++){
+    z = (tg->obs[o].y - pred[o])/tg->obs[o].sd;
+    ll -= 0.5*z*z + log(tg->obs[o].sd) + LOG_SQRT_2PI;
+  }
+  return isnan(ll) ? -INFINITY : ll;
+}
+
+// Cholesky factor L (lower, row major) of the d x d matrix A.  Returns 1 if
+// A is not positive definite.
+static int cholesky(const double *A, double *L, int d){
+  int i, j, k;
+  double s;
+
+  for(i = 0; i < d; i++){
+    for(j = 0; j <= i; j++){
+      s = A[i*d + j];
+      for(k = 0; k < j; k++){
+        s -= L[i*d + k]*L[j*d + k];
+      }
+      if(i == j){
+        if(!(s > 0)){
+          return 1;
+        }
+        L[i*d + i] = sqrt(s);
+      }else{
+        L[i*d + j] = s/L[j*d + j];
+      }
+    }
+    for(j = i + 1; j < d; j++){
+      L[i*d + j] = 0;
+    }
+  }
+  return 0;
+}
+
+// Adds the current state to the running mean and covariance and, once
+// adapting, refreshes the Cholesky factor of the proposal covariance.
+static void mcmc_adapt(mchain *c){
+  int d = c->tg->npar, i, j;
+  double n, delta[MCMC_MAXPAR], A[MCMC_MAXPAR*MCMC_MAXPAR];
+  double L[MCMC_MAXPAR*MCMC_MAXPAR];
+
+  // Welford update, cov holds the sums of squares
+  n = (double)c->iter;
+  for(i = 0; i < d; i++){
+    delta[i] = c->theta[i] - c->mean[i];
+    c->mean[i] += delta[i]/n;
+  }
+  for(i = 0; i < d; i++){
+    for(j = 0; j < d; j++){
+      c->cov[i*d + j] += delta[i]*(c->theta[j] - c->mean[j]);
+    }
+  }
+
+  if(c->iter < c->adaptstart || n < 2){
+    return;
+  }
+  for(i = 0; i < d; i++){
+    for(j = 0; j < d; j++){
+      A[i*d + j] = 2.38*2.38/d*c->cov[i*d + j]/(n - 1);
+    }
+    // Keeps the proposal from collapsing when a parameter has not moved
+    A[i*d + i] += 1e-6*c->scale0[i]*c->scale0[i];
+  }
+  if(cholesky(A, L, d) == 0){
+    memcpy(c->L, L, d*d*sizeof(double));
+  }
+}
+
+// The dr trajectory of the last simulation becomes the reference of warm
+// starts (called when it is accepted).
+static void mcmc_keepdr(mchain *c){
+  if(c->drref != NULL){
+    memcpy(c->drref, c->out.v[GF_dr], (c->tg->nsteps + 1)*sizeof(double));
+  }
+}
+
+/// mcmc_chain_init() sets up a chain at theta0 and allocates its buffers.
+///
+/// \param c            chain
+/// \param tg           target, has to outlive the chain
+/// \param theta0       starting values of the free parameters
+/// \param scale        sd of the proposals before adaptation
+/// \param temp         temperature, the likelihood is raised to 1/temp
+/// \param adaptstart   iterations before the covariance is adapted
+/// \param seed         random seed
+/// \param stream       random stream (e.g., the chain number)
+///
+/// Returns 0 on success, 1 if memory could not be allocated and 2 if the
+/// posterior density is 0 at theta0.
+///
+int mcmc_chain_init(mchain *c, mtarget *tg, const double *theta0,
+  const double *scale, double temp, int adaptstart, uint64_t seed,
+  uint64_t stream){
+
+  int d = tg->npar, k, nf = 0, used[GF_NDOUBLE] = {0};
+
+  memset(c, 0, sizeof(mchain));
+  c->tg = tg;
+  c->temp = temp;
+  c->adaptstart = adaptstart;
+  c->diag.bsize = 1;
+  rng_seed(&c->rng, seed, stream);
+
+  // Only the observed outputs are stored, and dr for warm starts
+  if(tg->warm){
+    used[GF_dr] = 1;
+    nf++;
+  }
+  for(k = 0; k < tg->nobs; k++){
+    if(!used[tg->obs[k].field]){
+      used[tg->obs[k].field] = 1;
+      nf++;
+    }
+  }
+  c->buf = malloc((size_t)(nf > 0 ? nf : 1)*(tg->nsteps + 1)*sizeof(double));
+  c->pred = malloc((size_t)3*(tg->nobs > 0 ? tg->nobs : 1)*sizeof(double));
+  if(c->buf == NULL || c->pred == NULL){
+    return 1;
+  }
+  if(tg->warm){
+    c->drref = calloc(tg->nsteps + 1, sizeof(double));
+    if(c->drref == NULL){
+      return 1;
+    }
+  }
+  for(k = 0, nf = 0; k < GF_NDOUBLE; k++){
+    if(used[k]){
+      c->out.v[k] = c->buf + (size_t)(nf++)*(tg->nsteps + 1);
+    }
+  }
+
+  for(k = 0; k < d; k++){
+    c->theta[k] = theta0[k];
+    c->scale0[k] = scale[k];
+    c->L[k*d + k] = scale[k];
+  }
+  c->loglik = mcmc_loglik(c, c->theta, -INFINITY, NULL, c->pred);
+  c->logprior = mcmc_logprior(tg, c->theta);
+  c->logpost = c->loglik/temp + c->logprior;
+  c->simsteps = 0;
+  c->solveiter = 0;
+  mcmc_keepdr(c);
+  if(!isfinite(c->logpost)){
+    return 2;
+  }
+
+  // The screening simulations get their own chain for the buffers
+  if(tg->coarse != NULL){
+    c->cs = malloc(sizeof(mchain));
+    c->shift = malloc((size_t)(tg->nobs > 0 ? tg->nobs : 1)*sizeof(double));
+    if(c->cs == NULL || c->shift == NULL){
+      free(c->cs);
+      c->cs = NULL;
+      return 1;
+    }
+    k = mcmc_chain_init(c->cs, tg->coarse, theta0, scale, temp, adaptstart,
+      seed, stream);
+    if(k != 0){
+      return k;
+    }
+    for(k = 0; k < tg->nobs; k++){
+      c->shift[k] = c->pred[k] - c->cs->pred[k];
+    }
+  }
+  return 0;
+}
+
+// Two stage delayed acceptance of prop (Christen and Fox 2005).  The
+// coarse posterior is made to match the full one at theta by shifting the
+// coarse predictions by c->shift (full minus coarse at theta, Cui et al.
+// 2011), so it only has to follow the shape of the full posterior.  Stage 1
+// is a Metropolis step on the shifted coarse posterior pc_x with the
+// uniform of mcmc_iterate() (threshold llmin), stage 2 accepts with
+// min(p(y), pc_y(x))/min(p(x), pc_x(y)), which keeps p invariant.  Returns
+// 1 and the full log likelihood of prop if it is accepted.
+static int mcmc_delayed(mchain *c, const double *prop, double lprior,
+  double llmin, double *ll){
+
+  mtarget *tg = c->tg;
+  mchain *cs = c->cs;
+  int n = tg->nobs, o;
+  double lpc, m, lu, lpx, *pf = c->pred, *pc = cs->pred;
+
+  // pc_x(y)
+  lpc = mcmc_loglik(cs, prop, llmin, c->shift, pc + n);
+  if(!(lpc > llmin)){
+    return 0;
+  }
+  c->screened++;
+  lpc = lpc/c->temp + lprior;
+
+  // p(y) (and so min(p(y), pc_y(x))) has to exceed u*min(p(x), pc_x(y))
+  m = fmin(c->logpost, lpc);
+  lu = log(rng_unif(&c->rng));
+  llmin = c->temp*(lu + m - lprior);
+  *ll = mcmc_loglik(c, prop, llmin, NULL, pf + n);
+  if(!(*ll > llmin)){
+    return 0;
+  }
+
+  // pc_y(x): coarse at x shifted by full minus coarse at y
+  for(o = 0; o < n; o++){
+    pf[2*n + o] = pc[o] + pf[n + o] - pc[n + o];
+  }
+  lpx = mcmc_obsll(tg, pf + 2*n)/c->temp + c->logprior;
+  if(!(lu < fmin(*ll/c->temp + lprior, lpx) - m)){
+    return 0;
+  }
+
+  mcmc_keepdr(cs);
+  memcpy(pf, pf + n, n*sizeof(double));
+  memcpy(pc, pc + n, n*sizeof(double));
+  for(o = 0; o < n; o++){
+    c->shift[o] = pf[o] - pc[o];
+  }
+  return 1;
+}
+
+/// mcmc_iterate() does one Metropolis update of the chain.  Returns 1 if
+/// the proposal was accepted, 0 if not.
+int mcmc_iterate(mchain *c){
+  mtarget *tg = c->tg;
+  int d = tg->npar, i, j, acc = 0;
+  double z[MCMC_MAXPAR], prop[MCMC_MAXPAR], lprior, ll = 0, llmin, lu;
+
+  for(i = 0; i < d; i++){
+    z[i] = rng_norm(&c->rng);
+  }
+  for(i = 0; i < d; i++){
+    prop[i] = c->theta[i];
+    for(j = 0; j <= i; j++){
+      prop[i] += c->L[i*d + j]*z[j];
+    }
+  }
+  lu = log(rng_unif(&c->rng));
+
+  // The prior is checked first so proposals outside its support are not
+  // simulated.  The proposal is accepted if ll > llmin, which lets the
+  // simulation stop as soon as that is out of reach.
+  lprior = mcmc_logprior(tg, prop);
+  if(isfinite(lprior)){
+    llmin = c->temp*(lu - lprior + c->logpost);
+    if(c->cs == NULL){
+      ll = mcmc_loglik(c, prop, llmin, NULL, NULL);
+      acc = lu < ll/c->temp + lprior - c->logpost;
+    }else{
+      acc = mcmc_delayed(c, prop, lprior, llmin, &ll);
+    }
+  }
+  if(acc){
+    mcmc_keepdr(c);
+    memcpy(c->theta, prop, d*sizeof(double));
+    c->loglik = ll;
+    c->logprior = lprior;
+    c->logpost = ll/c->temp + lprior;
+    c->accepted++;
+  }
+
+  c->iter++;
+  mcmc_adapt(c);
+  return acc;
+}
+
+/// mcmc_write_header() writes the csv header of the draws written by
+/// mcmc_sample().
+void mcmc_write_header(FILE *fp, mtarget *tg){
+  fprintf(fp, "chain,iter");
+  for(int k = 0; k < tg->npar; k++){
+    fprintf(fp, ",%s", sparms_names[tg->park[k]]);
+  }
+  fprintf(fp, ",logpost\n");
+}
+
+// Adds the current state of a chain to its diagnostics.
+static void mcmc_diag_add(mdiag *dg, const double *theta, int d){
+  int i, k;
+  double delta;
+
+  dg->n++;
+  for(k = 0; k < d; k++){
+    delta = theta[k] - dg->mean[k];
+    dg->mean[k] += delta/dg->n;
+    dg->m2[k] += delta*(theta[k] - dg->mean[k]);
+    dg->bcur[k] += theta[k];
+  }
+  if(++dg->bcount < dg->bsize){
+    return;
+  }
+  for(k = 0; k < d; k++){
+    dg->bmean[dg->nb*d + k] = dg->bcur[k]/dg->bsize;
+    dg->bcur[k] = 0;
+  }
+  dg->bcount = 0;
+  // Merge neighbouring batches once all are full
+  if(++dg->nb == 2*MCMC_NBATCH){
+    for(i = 0; i < MCMC_NBATCH; i++){
+      for(k = 0; k < d; k++){
+        dg->bmean[i*d + k] = 0.5*(dg->bmean[2*i*d + k] +
+          dg->bmean[(2*i + 1)*d + k]);
+      }
+    }
+    dg->nb = MCMC_NBATCH;
+    dg->bsize *= 2;
+  }
+}
+
+/// mcmc_diag() computes R-hat (Gelman and Rubin 1992) and the batch means
+/// effective sample size summed over chains from the running statistics of
+/// the kept draws.  R-hat is NAN for a single chain, and the ESS is 0
+/// until each chain has two full batches.
+///
+/// \param cold     the chains at temperature 1
+/// \param nchain   number of chains
+/// \param npar     number of parameters
+/// \param rhat     returns R-hat of each parameter
+/// \param ess      returns the ESS of each parameter
+///
+void mcmc_diag(mchain *cold[], int nchain, int npar, double *rhat,
+  double *ess){
+
+  int c, i, k;
+  double n = cold[0]->diag.n, W, B, m, v, bm, bv, s2;
+
+  for(k = 0; k < npar; k++){
+    W = 0;
+    m = 0;
+    ess[k] = 0;
+    for(c = 0; c < nchain; c++){
+      mdiag *dg = &cold[c]->diag;
+      s2 = (dg->n > 1) ? dg->m2[k]/(dg->n - 1) : 0;
+      W += s2/nchain;
+      m += dg->mean[k]/nchain;
+
+      // Variance of the batch means
+      if(dg->nb >= 2){
+        bm = 0;
+        bv = 0;
+        for(i = 0; i < dg->nb; i++){
+          bm += dg->bmean[i*npar + k]/dg->nb;
+        }
+        for(i = 0; i < dg->nb; i++){
+          bv += pow(dg->bmean[i*npar + k] - bm, 2)/(dg->nb - 1);
+        }
+        v = dg->bsize*bv;
+        ess[k] += (v > 0) ? fmin(dg->n, dg->n*s2/v) : dg->n;
+      }
+    }
+    if(nchain < 2 || n < 2 || W <= 0){
+      rhat[k] = NAN;
+      continue;
+    }
+    B = 0;
+    for(c = 0; c < nchain; c++){
+      B += pow(cold[c]->diag.mean[k] - m, 2)/(nchain - 1);
+    }
+    rhat[k] = sqrt(((n - 1)/n*W + B)/W);
+  }
+}
+
+// Proposes to swap the states of replicas a and b (Metropolis coupled MCMC).
+static int mcmc_swap(mchain *a, mchain *b, rngstate *rng){
+  double lr = (1/a->temp - 1/b->temp)*(b->loglik - a->loglik), tmp;
+  double theta[MCMC_MAXPAR];
+  int d = a->tg->npar, k;
+
+  if(log(rng_unif(rng)) >= lr){
+    return 0;
+  }
+  memcpy(theta, a->theta, d*sizeof(double));
+  memcpy(a->theta, b->theta, d*sizeof(double));
+  memcpy(b->theta, theta, d*sizeof(double));
+  tmp = a->loglik; a->loglik = b->loglik; b->loglik = tmp;
+  tmp = a->logprior; a->logprior = b->logprior; b->logprior = tmp;
+  // The predictions and dr trajectories at theta move with it
+  for(k = 0; a->drref != NULL && k <= a->tg->nsteps; k++){
+    tmp = a->drref[k]; a->drref[k] = b->drref[k]; b->drref[k] = tmp;
+  }
+  for(k = 0; a->cs != NULL && a->cs->drref != NULL && k <= a->cs->tg->nsteps; k++){
+    tmp = a->cs->drref[k]; a->cs->drref[k] = b->cs->drref[k]; b->cs->drref[k] = tmp;
+  }
+  for(k = 0; a->cs != NULL && k < a->tg->nobs; k++){
+    tmp = a->pred[k]; a->pred[k] = b->pred[k]; b->pred[k] = tmp;
+    tmp = a->cs->pred[k]; a->cs->pred[k] = b->cs->pred[k]; b->cs->pred[k] = tmp;
+    tmp = a->shift[k]; a->shift[k] = b->shift[k]; b->shift[k] = tmp;
+  }
+  a->logpost = a->loglik/a->temp + a->logprior;
+  b->logpost = b->loglik/b->temp + b->logprior;
+  return 1;
+}
+
+/// mcmc_sample() runs o->nchain chains of o->ntemp tempered replicas each
+/// in parallel for up to o->niter iterations.  Draws of the replicas at
+/// temperature 1 are kept every o->thin iterations after o->burnin.
+///
+/// \param tg       target, shared by all replicas
+/// \param theta0   starting values of chain c at theta0[c*npar + k]
+/// \param scale    sd of the proposals before adaptation
+/// \param o        settings
+/// \param r        outputs
+///
+/// Returns 0 on success, 1 if memory could not be allocated and 2 if the
+/// posterior density is 0 at the starting values of a chain.
+///
+int mcmc_sample(mtarget *tg, const double *theta0, const double *scale,
+  mcmcopts *o, mcmcres *r){
+
+  int nrep = o->nchain*o->ntemp, d = tg->npar, c, k, err = 0, stop = 0;
+  int nthreads = o->nthreads;
+  long it, block, first, i, nswap = 0, swapped = 0, nsim = 0, nsolve = 0;
+  mchain *rep, **cold;
+  rngstate swaprng;
+
+  rep = malloc(nrep*sizeof(mchain));
+  cold = malloc(o->nchain*sizeof(mchain *));
+  if(rep == NULL || cold == NULL){
+    free(rep);
+    free(cold);
+    return 1;
+  }
+  rng_seed(&swaprng, o->seed, (uint64_t)nrep);
+
+#ifdef _OPENMP
+  if(nthreads <= 0){
+    nthreads = omp_get_max_threads();
+  }
+#else
+  (void)nthreads;
+#endif
+
+  // Replica c*ntemp + t is chain c at temperature temps[t].  Buffers are
+  // allocated by the thread that runs the replica.
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads(nthreads) reduction(max:err)
+#endif
+  for(k = 0; k < nrep; k++){
+    int e = mcmc_chain_init(&rep[k], tg, theta0 + (k/o->ntemp)*d, scale,
+      o->temps[k % o->ntemp], o->adaptstart, o->seed, (uint64_t)k);
+    if(e > err){
+      err = e;
+    }
+  }
+  for(c = 0; c < o->nchain; c++){
+    cold[c] = &rep[c*o->ntemp];
+  }
+
+  for(it = 0; it < o->niter && err == 0 && !stop; it += block){
+    block = (o->swapevery < o->niter - it) ? o->swapevery : o->niter - it;
+    first = cold[0]->kept;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads(nthreads) private(i)
+#endif
+    for(k = 0; k < nrep; k++){
+      mchain *ch = &rep[k];
+      for(i = 0; i < block; i++){
+        mcmc_iterate(ch);
+        if(k % o->ntemp != 0 || ch->iter <= o->burnin ||
+          (ch->iter - o->burnin) % o->thin != 0){
+          continue;
+        }
+        if(ch->kept < r->ndraw){
+          int cc = k/o->ntemp, kk;
+          for(kk = 0; r->draws != NULL && kk < d; kk++){
+            r->draws[((long)cc*d + kk)*r->ndraw + ch->kept] = ch->theta[kk];
+          }
+          if(r->lp != NULL){
+            r->lp[(long)cc*r->ndraw + ch->kept] = ch->logpost;
+          }
+        }
+        mcmc_diag_add(&ch->diag, ch->theta, d);
+        ch->kept++;
+      }
+    }
+
+    // One swap between neighbouring temperatures per chain
+    for(c = 0; c < o->nchain && o->ntemp > 1; c++){
+      k = c*o->ntemp + (int)(rng_unif(&swaprng)*(o->ntemp - 1));
+      swapped += mcmc_swap(&rep[k], &rep[k + 1], &swaprng);
+      nswap++;
+    }
+
+    // Draws kept in this block, written in chain order
+    if(r->fp != NULL && r->draws != NULL){
+      for(c = 0; c < o->nchain; c++){
+        for(i = first; i < cold[c]->kept && i < r->ndraw; i++){
+          fprintf(r->fp, "%d,%ld", c + 1, o->burnin + (i + 1)*o->thin);
+          for(k = 0; k < d; k++){
+            fprintf(r->fp, ",%.17g", r->draws[((long)c*d + k)*r->ndraw + i]);
+          }
+          fprintf(r->fp, ",%.17g\n", (r->lp != NULL) ?
+            r->lp[(long)c*r->ndraw + i] : NAN);
+        }
+      }
+      fflush(r->fp);
+    }
+
+    mcmc_diag(cold, o->nchain, d, r->rhat, r->ess);
+    if(o->stoprhat > 0 && cold[0]->diag.nb >= 2){
+      stop = 1;
+      for(k = 0; k < d; k++){
+        if(!(r->rhat[k] < o->stoprhat) || !(r->ess[k] > o->stopess)){
+          stop = 0;
+        }
+      }
+    }
+  }
+
+  r->kept = (cold[0]->kept < r->ndraw) ? cold[0]->kept : r->ndraw;
+  r->iter = cold[0]->iter;
+  for(c = 0; c < o->nchain; c++){
+    r->accept[c] = (cold[c]->iter > 0) ?
+      (double)cold[c]->accepted/cold[c]->iter : 0;
+  }
+  r->swaprate = (nswap > 0) ? (double)swapped/nswap : NAN;
+  r->steps = 0;
+  r->csteps = 0;
+  r->screen = 0;
+  for(k = 0; k < nrep; k++){
+    if(rep[k].iter == 0){
+      continue;
+    }
+    r->steps += (double)rep[k].simsteps/rep[k].iter/nrep;
+    nsim += rep[k].simsteps;
+    nsolve += rep[k].solveiter;
+    if(rep[k].cs != NULL){
+      r->csteps += (double)rep[k].cs->simsteps/rep[k].iter/nrep;
+      r->screen += (double)rep[k].screened/rep[k].iter/nrep;
+      nsim += rep[k].cs->simsteps;
+      nsolve += rep[k].cs->solveiter;
+    }
+  }
+  r->solveiter = (nsim > 0) ? (double)nsolve/nsim : 0;
+
+  for(k = 0; k < nrep; k++){
+    mcmc_chain_free(&rep[k]);
+  }
+  free(rep);
+  free(cold);
+  return err;
+}
+
+/// mcmc_chain_free() frees the buffers of a chain.
+void mcmc_chain_free(mchain *c){
+  free(c->buf);
+  free(c->pred);
+  free(c->shift);
+  free(c->drref);
+  c->buf = NULL;
+  c->pred = NULL;
+  c->shift = NULL;
+  c->drref = NULL;
+  if(c->cs != NULL){
+    mcmc_chain_free(c->cs);
+    free(c->cs);
+    c->cs = NULL;
+  }
+}
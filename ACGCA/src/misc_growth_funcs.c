@@ -13,9 +13,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <assert.h>
 #include "head_files/misc_growth_funcs.h"
-#include <R.h>
+#include "head_files/rprint.h"
+#include "head_files/gtrace.h"
+#include "head_files/gmath.h"
 
 // Only define M_PI if it is not defined already
 // Added by MKF for compilers that don't define this
@@ -55,7 +58,7 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
     st->r=*r0;
   }
   else {
-    //printf("error in initialize, line 48 \n");
+    GTRACE(GT_fault, 111, *r0, 0, 0);
     getchar();
   }
 
@@ -64,10 +67,10 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
   //*excess=0.001;
   // initial height, function of initial radius
   if (p->hmax > 0){  // should never happen
-    st->h=p->hmax*(1-exp(-p->phih*st->r/p->hmax));
+    st->h=p->hmax*(1-gexp(-p->phih*st->r/p->hmax));
   }
   else {
-    //printf("hmax is 0 in initialize \n");
+    GTRACE(GT_fault, 112, st->r, 0, 0);
     st->status=0;   // tree dies
   }
 
@@ -81,10 +84,9 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
   }
 
   if (st->h <= 0){
+    GTRACE(GT_fault, 113, st->r, st->h, 0);
     st->h = 1e-300;
     st->status=0;
-    //printf("error in initialize, line 75 \n");
-    //getchar();
   }
 
   // Trunk volume calculations based on neiloid, paraboloid, cone taper
@@ -104,11 +106,9 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
   st->vt=vin.vt;
   st->vth=vin.vth;
 
-  //printf("r=%g, rB=%g, rC=%g, rBH=%g \n", st->r, st->rB, st->rC, st->rBH);
   // trunkvolume needs the updated radii from trunkradii and returns
   // volume of different trunk compartments vt, vth, vts in st
 
-  //printf("vt=%g, vth=%g, vts=%g \n", st->vt, st->vth, st->vts);
   // compute other state variables
   st->sa=M_PI*st->sw*(2*st->r-st->sw);
   st->la=p->f2*st->sa;
@@ -118,7 +118,7 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
     st->bl=st->la/p->sla;
   }
   else {
-    //printf("problem in initialize 2");
+    GTRACE(GT_fault, 114, st->r, st->h, 0);
     st->status=0; // tree dies
   }
   st->br=p->rr*p->rhor*st->ra/2;
@@ -144,9 +144,8 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
     }
   }
   else {
-    // printf("problem in initialize 1 \n");
+    GTRACE(GT_fault, 115, st->r, st->h, 0);
     st->cs=0;
-    // printf("st->r=%g, st->h=%g, r0=%g \n",st->r,st->h, *r0);
     st->status=0;  //tree dies
   }
 
@@ -205,7 +204,7 @@ void initialize(sparms *p, gparms *gp, tstates *st, double *r0){
 /// Updated the error checks.
 ///
 
-void trunkradii(double r0, height *h, radius *r, tstates *st){
+void trunkradii(greal r0, height *h, radius *r, tstates *st){
 
   //NOTE: only need p.etaB, so should simplify later
   // Also, h.BH (hBH) always equals 1.37 m
@@ -219,33 +218,27 @@ void trunkradii(double r0, height *h, radius *r, tstates *st){
       (h->H > h->hC) && (h->hB < h->hC) && (r0>0) &&
       (isnan(r0)==0) && (isinf(r0)==0)){
 
-    r->rB = r0*sqrt(pow(((h->H-h->hB)/h->H),3));
+    r->rB = r0*sqrt(gcube((h->H-h->hB)/h->H));
     r->rC = r->rB*sqrt((h->H-h->hC)/(h->H-h->hB));
 
-    //printf("in trunkradii: st.r=%g, st.rB=%g, st.rC=%g \n", r->r0, r->rB, r->rC);
-    //printf("in trunkradii: hB=%g, st.hC=%g, st.h=%g, st.hBH=%g \n", h->hB, h->hC, h->H,h->hBH);
     // Below calculates radius at breast height.
     if(h->hBH < h->hB){
-      //printf("here 1 \n");
-      r->rBH = r0*sqrt(pow(((h->H-h->hBH)/h->H),3));
+      r->rBH = r0*sqrt(gcube((h->H-h->hBH)/h->H));
     }
     else if((h->hB < h->hBH) && (h->hBH < h->hC)){
-      //printf("here 2 \n");
       r->rBH = r->rB*sqrt((h->H-h->hBH)/(h->H-h->hB));
     }
     else if((h->hC < h->hBH) && (h->hBH < h->H)){  // this also checks that H>hC
-      //printf("here 3 \n");
       r->rBH = r->rC*(h->H-h->hBH)/(h->H-h->hC);
     }
     else{
-      //printf("here 4 \n");
       r->rBH = 0;
     }
 
     r->r0=r0;  // don't need this
   }
   else if ((r0 > 0) && (h->H > 0)){
-    // printf("problem in trunkradii, line 237 \n");
+    GTRACE(GT_fault, 121, r0, h->H, 0);
     r->r0=r0;
     r->rB = r0;
     r->rC = r0;
@@ -253,7 +246,7 @@ void trunkradii(double r0, height *h, radius *r, tstates *st){
      st->status=0;
   }
   else {
-    // printf("problem in trunkradii, line 241 \n");
+    GTRACE(GT_fault, 122, r0, h->H, 0);
     r->r0=1e-300;
     r->rB = 1e-300;
     r->rC = 1e-300;
@@ -285,10 +278,10 @@ void trunkradii(double r0, height *h, radius *r, tstates *st){
 /// \date 01-11-2010
 ///
 
-void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
+void trunkvolume(radius *r, height *h, greal sw, volume *v, tstates *st){
 
   // intermediate calculations/quantities local to this function:
-  double neiloidV=0, parabloidV=0, coneV=0;
+  greal neiloidV=0, parabloidV=0, coneV=0;
 
   /* compute total trunk volume (vt). First, compute the volume of each of the
    * trunk segments:   */
@@ -298,30 +291,28 @@ void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
   // Compute total trunk volume (vt). First, compute the volume of each of the
   // trunk segments.  Check that hB<hC<H.  Uses current r->r0,r->rB and r->rC
   if ((h->H > 0) && (h->H > h->hC) && (h->hB < h->hC) && (st->status!=0)){
-    neiloidV = (M_PI/4)*(pow(r->r0,2))*(pow(h->H,4) -
-					pow((h->H-h->hB),4))/(pow(h->H,3));
+    neiloidV = (M_PI/4)*(gsq(r->r0))*(gpow4(h->H) -
+					gpow4(h->H-h->hB))/(gcube(h->H));
 
-    parabloidV = (M_PI/2)*(pow(r->rB,2))*(pow(h->hB,2) -
-					  pow(h->hC,2) + 2*h->H*(h->hC-h->hB))/(h->H-h->hB);
+    parabloidV = (M_PI/2)*(gsq(r->rB))*(gsq(h->hB) -
+					  gsq(h->hC) + 2*h->H*(h->hC-h->hB))/(h->H-h->hB);
 
-    coneV = (M_PI/3)*(pow(r->rC,2))*(h->H-h->hC);
+    coneV = (M_PI/3)*(gsq(r->rC))*(h->H-h->hC);
 
     // Compute total trunk volume.
     if ((neiloidV>=0) && (parabloidV>=0) && (coneV>=0)){
       v->vt = neiloidV + parabloidV + coneV;
     }
     else {
-      //printf("problems in trunkvolume 1a \n");
-      //getchar();
+      GTRACE(GT_fault, 131, r->r0, h->H, 0);
       st->status=0;  // tree dies
     }
-    //printf("neilV=%g, paraV=%g, coneV=%g, vt=%g \n",neiloidV, parabloidV,coneV,v->vt);
     // Now compute volume of trunk heartwood (vth).
 
     // Potential radii of heartwood section:
-    double r0 = r->r0 - sw;
-    double rB = r->rB - sw;
-    double rC = r->rC - sw;
+    greal r0 = r->r0 - sw;
+    greal rB = r->rB - sw;
+    greal rC = r->rC - sw;
     v->vth=0;
 
     if(r0 < 0){
@@ -331,43 +322,41 @@ void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
     else if(rB < 0){
       // heartwood terminates in basal neiloid section.
       // Height if heartwood ends in neiloid:
-      v->vth = (M_PI/4)*(h->H - h->H*(pow((sw/r->r0),(2/3))))*pow(r0,2);
+      v->vth = (M_PI/4)*(h->H - h->H*(pow((sw/r->r0),(2/3))))*gsq(r0);
     }
     else if(rC < 0){
       // heartwood terminates in middle paraboloid section.
       // Height if heartwood ends in paraboloid:
-      double temp;
-      temp = h->H - (h->H-h->hB)*pow((sw/r->rB),2);
+      greal temp;
+      temp = h->H - (h->H-h->hB)*gsq(sw/r->rB);
       //H = Hp;
       // TODO: check that Volumes are > 0
       if (temp != 0){
-	neiloidV = (M_PI/4)*pow(r0,2)*(pow(temp,4) -
-				       pow((temp-h->hB),4))/(pow(temp,3));
-	parabloidV = (M_PI/2)*(temp-h->hB)*(pow(rB,2));
+	neiloidV = (M_PI/4)*gsq(r0)*(gpow4(temp) -
+				       gpow4(temp-h->hB))/(gcube(temp));
+	parabloidV = (M_PI/2)*(temp-h->hB)*(gsq(rB));
 	v->vth = neiloidV + parabloidV;
       }
       else {
-	//printf("problems in trunkvolume 2 \n");
-	//getchar();
+	GTRACE(GT_fault, 132, r->r0, h->H, 0);
 	st->status=0;  // tree dies
       }
     } // end if rC <0
     else{
       // heartwood terminates in top cone section.
       // Height if heartwood reaches cone
-      double temp;
+      greal temp;
       temp=fminmacro((h->H-sw),(h->H*rC+h->hC*sw)/r->rC);
       if((temp != 0) && (temp != h->hB)){
-	neiloidV = (M_PI/4)*pow(r0,2)*(pow(temp,4) -
-				       pow((temp-h->hB),4))/(pow(temp,3));
-	parabloidV = (M_PI/2)*(pow(rB,2))*(pow(h->hB,2) -
-					   pow(h->hC,2) + 2*temp*(h->hC-h->hB))/(temp-h->hB);
-	coneV = (M_PI/3)*(pow(rC,2))*(temp-h->hC);
+	neiloidV = (M_PI/4)*gsq(r0)*(gpow4(temp) -
+				       gpow4(temp-h->hB))/(gcube(temp));
+	parabloidV = (M_PI/2)*(gsq(rB))*(gsq(h->hB) -
+					   gsq(h->hC) + 2*temp*(h->hC-h->hB))/(temp-h->hB);
+	coneV = (M_PI/3)*(gsq(rC))*(temp-h->hC);
 	v->vth = neiloidV + parabloidV + coneV;
       }
       else {
-	//printf("problems in trunkvolume 3 \n");
-	//getchar();
+	GTRACE(GT_fault, 133, r->r0, h->H, 0);
 	st->status=0; // tree dies
       }
     } // end outer else statement
@@ -378,7 +367,7 @@ void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
       v->vts =v->vt - v->vth;
     }
     else {
-      //printf("error in trunkvolume: vt<vth \n");
+      GTRACE(GT_fault, 134, r->r0, h->H, 0);
       st->status=0; // tree dies
     }
 
@@ -387,7 +376,7 @@ void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
     v->vt=0;
     v->vts=0;
     v->vth=0;
-    //printf("error in trunkvolume 1 \n");
+    GTRACE(GT_fault, 135, r->r0, h->H, 0);
     st->status=0;  // tree dies
   }
 
@@ -423,8 +412,8 @@ void trunkvolume(radius *r, height *h, double sw, volume *v, tstates *st){
 /// date March 14, 2018
 ///
 
-void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
-	     double H, double rBH, sparms *p, gparms *gp, double Hc,
+void LAIcalc(LAindex *LAI, Larea *LA, greal LAtot, greal r0,
+	     greal H, greal rBH, sparms *p, gparms *gp, double Hc,
 	     tstates *st){
 
   /******* Matlab comments
@@ -455,11 +444,7 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
 	   % (CanArea) at base of canopy in m^2. Model modified from Purves et al.
 	   % PLOS
   ***************/
-  double diam, Rmax, r0star=0, CAtot, Vtot, LAItot, z, CAz, Vz;
-  //printf("in LAIcalc: rBH=%g, p->R0=%g, p->R40=%g, r0=%g \n",rBH,p->R0,p->R40,r0);
-  //printf("p->hmax=%g, p->phih=%g, gp->BH=%g \n",p->hmax,p->phih,gp->BH);
-  
-  //Rprintf("LAICALC: \n");
+  greal diam, Rmax, r0star=0, CAtot, Vtot, LAItot, z, CAz, Vz;
   
   if (rBH > 0){
     diam = 2*rBH*100;
@@ -473,16 +458,14 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
       st->status=0;  // tree dies
     }
     else {
-      r0star = -(p->hmax/p->phih)*log((p->hmax-gp->BH)/p->hmax);
+      r0star = -(p->hmax/p->phih)*glog((p->hmax-gp->BH)/p->hmax);
       Rmax = (p->R0/r0star)*r0;
     }
   }
-  //printf("Rmax=%g, p->eta=%g, p->M=%g, p->alpha=%g \n",Rmax,p->eta,p->M,p->alpha);
   // Total projected crown area of tree at base of crown
-  CAtot = M_PI*pow(Rmax,2)*pow((1-p->eta)/p->M,(2*p->alpha));
+  CAtot = M_PI*gsq(Rmax)*gpow((1-p->eta)/p->M, (2*p->alpha));
   // Total volume of tree's crown:
   Vtot = CAtot*(((1-p->eta)*H)/(1+2*p->alpha));
-  //printf("CAtot=%g, Vtot=%g \n",CAtot,Vtot);
   // Total leaf area index of tree's crown
   if (CAtot > 0){
     LAItot = LAtot/CAtot;
@@ -490,7 +473,6 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
   else {
     // TODO: fix this
     LAItot = LAtot/1e-200;
-    //printf("CAtot=%g, LAItot=%g \n",CAtot,LAtot);
   }
   //hack for now.  Need to make LAIcalc work on variable length arguements
   if (Hc == -99){
@@ -506,28 +488,20 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
     //If given forest canopy height, compute tree's LAI and LA above (top) and
     // below (bot) the height of the forest canopy
 
-    //Rprintf("H=%g \n", H);
-    //Rprintf("Hc=%g \n", H);
-    //Rprintf("\n");
     // If tree's crown is taller than forest canopy:
     if (H > Hc){ //mkf added this >= from > on June 12, 2020
       z = H-Hc;
 
       // If bottom of tree's crown is below forest canopy:
-      //printf("z=%g, H=%g, Hc=%g. \n");
       if (z < (1-p->eta)*H){
-      	CAz= M_PI*pow(Rmax,2)*pow(z/(H*p->M),(2*p->alpha));
+      	CAz= M_PI*gsq(Rmax)*gpow(z/(H*p->M), (2*p->alpha));
       	Vz = CAz*(z/(1+2*p->alpha));
-      	//printf("CAz=%g, Vz=%g. \n");
       	LA->top = LAtot*Vz/Vtot;
       	LA->bot = LAtot - LA->top;
       	//LAI->top = LAtop/CAz;
       	LAI->top = LA->top/CAtot;
       	LAI->bot = LA->bot/CAtot;
       	
-      	//Rprintf("LAI->top=%g \n", LAI->top);
-      	//Rprintf("\n");
-//      	Rprintf("LAIcalc H > Hc LAI->top=%g \n", CAtot);
       }
       // Below, if forest canopy is below tree's crown:
       else{
@@ -535,7 +509,6 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
       	LA->bot = 0;
       	LAI->top = LAItot;
       	LAI->bot = 0;
-//      	Rprintf("Inner else in LAIcalc \n");
       }
     }
     // Below, if forest canopy it taller than tree:
@@ -544,19 +517,15 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
       LAI->bot = LAItot;
       LA->top = 0;
       LA->bot = LAtot;
-//      Rprintf("Outer ouse in LAIcalc \n");
     }
   } // End of else above
   LA->tot=LAtot;
   LAI->tot=LAItot;
 
   if (isnan(LAItot)!=0){
-    //printf("error in LAI_calc: LAItot is nan \n");
+    GTRACE(GT_fault, 141, st->r, st->h, st->ex);
   }
-  //Rprintf("LAIcalc LAI->top=%g \n", LAI->top);
-  //Rprintf("LAIcalc LAI->bot=%g \n", LAI->bot);
-  //Rprintf("LAIcalc LAI->tot=%g \n", LAI->tot);
-  //Rprintf("\n\n");
+  GTRACE(GT_LAI, 0, LAI->tot, LAI->top, LAI->bot);
 } // end LAIcalc()
 
 
@@ -576,61 +545,55 @@ void LAIcalc(LAindex *LAI, Larea *LA, double LAtot, double r0,
  //tstates *st)
 
  // Hc and FLAI can just pass the double values with minimal issue
-void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, double H,
+void APARcalc(greal *APARout, LAindex *LAI, Larea *LA, greal eta, greal k, greal H,
                 double Hc, double FLAI, double Io, Forestparms *ForParms)
 {
 
   // Define internal variables
-  double APAR;
-  double Ioint = 0; //Io internal to this function
+  greal APAR;
+  greal Ioint = 0; //Io internal to this function
   // First block
-  double logitLAImin;
-  double pLAImin;
-  double logitLAImax;
-  double pLAImax;
+  greal logitLAImin;
+  greal pLAImin;
+  greal logitLAImax;
+  greal pLAImax;
   // First if
-  double logitLAIc1;
-  double pLAIc1;
-  double LAIc1;
-  double logitLAIc2;
-  double pLAIc2;
-  double LAIc2;
-  double LAIc;
-  double Kboth;
-  double LAIboth;
-  double fabs_both;
-  double fabs_tree;
-  double fabs_can;
-  double fabs;
+  greal logitLAIc1;
+  greal pLAIc1;
+  greal LAIc1;
+  greal logitLAIc2;
+  greal pLAIc2;
+  greal LAIc2;
+  greal LAIc;
+  greal Kboth;
+  greal LAIboth;
+  greal fabs_both;
+  greal fabs_tree;
+  greal fabs_can;
+  greal fabs;
   // Third if
-  double LogitLAIc;
-  double pLAIc;
-  double fabs_top;
-  double APAR_top;
-  double APAR_bot;
+  greal LogitLAIc;
+  greal pLAIc;
+  greal fabs_top;
+  greal APAR_top;
+  greal APAR_bot;
   // My vars
   //double APARout[2] = {-2, -2};
 
   // Predicted, unscaled forest canopy LAI at top of canopy:
   logitLAImin = ForParms->intF + ForParms->slopeF;
-  pLAImin = exp(logitLAImin) / (1 + exp(logitLAImin));
+  pLAImin = gexp(logitLAImin) / (1 + gexp(logitLAImin));
   // Predicted, unscaled forest canopy LAI at ground level:
   logitLAImax = ForParms->intF;
-  pLAImax = exp(logitLAImax) / (1 + exp(logitLAImax));
+  pLAImax = gexp(logitLAImax) / (1 + gexp(logitLAImax));
   
-  //Rprintf("APARCALC: \n");
-  //Rprintf("APAR_top=%g \n", LAI->top);
-  //Rprintf("APAR_bot=%g \n", LAI->bot);
-  //Rprintf("APAR_tot=%g \n", LAI->tot);
-  //Rprintf("\n");
-
   // This was H < Hc and should go back if this does not work
   if(H <= Hc){
     // Calculate forest canopy LAI from top of forest canopy (height H meters)
     // to top of target tree (height H):
     assert(Hc > 0); // Make sure Hc > 0 or print an error and stop execution
     logitLAIc1 = ForParms->intF + ForParms->slopeF * (H/Hc);
-    pLAIc1 = exp(logitLAIc1) / (1 + exp(logitLAIc1));
+    pLAIc1 = gexp(logitLAIc1) / (1 + gexp(logitLAIc1));
     // Rescale distribution of forest canopy LAI so that LAI = 0 at top of
     // canopy and LAI maximum LAI at ground level:
     assert((pLAImax - pLAImin) > 0); // Prevent divide by 0 this should be
@@ -639,7 +602,7 @@ void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, do
     LAIc1 = FLAI * pLAIc1;
     // Io is light level incedent at top of target tree's canopy, after having
     // accounted for the light absorbed by the forest canopy above the tree.
-    Ioint = Io * exp(-ForParms->kF * LAIc1);
+    Ioint = Io * gexp(-ForParms->kF * LAIc1);
 
     // Now calculate the amount of light absorbed within a cylinder containing
     // the target tree's canopy and partitioning the abount absorbed by the
@@ -649,7 +612,7 @@ void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, do
     // tree's canopy:
     logitLAIc2 = ForParms->intF + ForParms->slopeF * (eta * H / Hc);
     // Rescale distribution of forest canopy LAI:
-    pLAIc2 = exp(logitLAIc2) / (1 + exp(logitLAIc2));
+    pLAIc2 = gexp(logitLAIc2) / (1 + gexp(logitLAIc2));
     pLAIc2 = (pLAIc2 - pLAImin) / (pLAImax - pLAImin);
     LAIc2 = FLAI * pLAIc2;
     LAIc = LAIc2 - LAIc1;
@@ -660,13 +623,13 @@ void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, do
     assert(LAIboth > 0);
     Kboth = (ForParms->kF * LAIc + k * LAI->tot) / LAIboth;
     // Fraction of light absorbed by both canopies:
-    fabs_both = 1 - exp(-Kboth * LAIboth);
+    fabs_both = 1 - gexp(-Kboth * LAIboth);
     // Fraction of light that would have been absorbed by the tree's canopy if
     // not competing with the forest canopy:
-    fabs_tree = 1 - exp(-k * LAI->tot);
+    fabs_tree = 1 - gexp(-k * LAI->tot);
     // Fraction of light that would have been absorbed by the forest's canopy
     // if not competing with the tree's canopy:
-    fabs_can = 1 - exp(-ForParms->kF * LAIc);
+    fabs_can = 1 - gexp(-ForParms->kF * LAIc);
     // "Correction" fraction of light absorbed by the tree's canopy, and total
     // amount of light absorbed by the tree:
     assert((fabs_tree + fabs_can) > 0);
@@ -676,87 +639,60 @@ void APARcalc(double *APARout, LAindex *LAI, Larea *LA, double eta, double k, do
   else if((eta * H) >= Hc){ // changed to >= from > on June 12, 2020 by mkf
     // Fraction and total amount of light absorbed by the target tree's canopy
     // when not competing for light with the forest canopy.
-    fabs = 1 - exp(-k * LAI->tot);
+    fabs = 1 - gexp(-k * LAI->tot);
     assert(LAI->tot > 0);
     APAR = Io * fabs * LA->tot / LAI->tot;
   }
   else if((eta * H) < Hc){
-    //Rprintf("eta=%g \n", eta);
-    //Rprintf("H=%g \n", H);
-    //Rprintf("Hc=%g \n", Hc);
-    //Rprintf("eta * H=%g \n", eta*H);
     // For the portion of the target tree's canopy that is above the forest
     // canopy, compute the fractionand total amount of light absorbed by the
     // top part of the tree's crown, and compute light penetrating to the
     // lower part of the crown (Io):
-    fabs_top = 1 - exp(-k * LAI->top);
+    fabs_top = 1 - gexp(-k * LAI->top);
     assert(LAI->top > 0);
     APAR_top = Io * fabs_top * LA->top / LAI->top;
     Ioint = Io * (1 - fabs_top);
     
-    //Rprintf("APAR_top = Io * fabs_top * LA->top / LAI->top \n");
-    //Rprintf("APAR_top=%g \n", APAR_top);
-    //Rprintf("Io=%g \n", Io);
-    //Rprintf("fabs_top=%g \n", fabs_top);
-    //Rprintf("LA->top=%g \n", LA->top);
-    //Rprintf("LAI->top=%g \n", LAI->top);
-    //Rprintf("\n");
-//    Rprintf("LAI->top=%g, APAR_top=%g, Ioint=%g \n", LAI->top, APAR_top, Ioint);
     // Now, compute the amount of light absorbed by the bottom part of the
     // tree's crown that is competing with the forest canopy for light.
 
     // Compute the LAI of the forest canopy to the bottom of the tree's crown:
     LogitLAIc = ForParms->intF + ForParms->slopeF * (eta * H / Hc);
     // Rescale distribution of forest canopy LAI:
-    pLAIc = exp(LogitLAIc) / (1 + exp(LogitLAIc));
+    pLAIc = gexp(LogitLAIc) / (1 + gexp(LogitLAIc));
     pLAIc = (pLAIc-pLAImin) / (pLAImax - pLAImin);
     LAIc = FLAI * pLAIc;
     
-//    Rprintf("LogitLAIc=%g, pLAIc=%g, LAIc=%g \n", LogitLAIc, pLAIc, LAIc);
     // Total LAI (forest + tree's canopies) within a cylinder containing the
     // target tree's bottom crown portion
     LAIboth = LAIc + LAI->bot;
-//    Rprintf("LAIboth=%g \n", LAIboth);
     // Combined light ext coeff of forest and tree's canopies:
     Kboth = (ForParms->kF * LAIc + k * LAIboth);
-//    Rprintf("Kboth=%g \n", Kboth);
     // Fraction of light absorbed by both canopies:
-    fabs_both = 1 - exp(-Kboth * LAIboth);
-//    Rprintf("fabs_both=%g \n", fabs_both);
+    fabs_both = 1 - gexp(-Kboth * LAIboth);
     // Fraction of light that would have been absorbed by the forest's canopy
     // if not competing with the tree's canopy:
-    fabs_tree = 1 - exp(-k * LAIboth);
-//    Rprintf("fabs_tree=%g \n", fabs_tree);
+    fabs_tree = 1 - gexp(-k * LAIboth);
     // Fraction of light that would have been absorbed by the forest's canopy
     // if not competing with the tree's canopy:
-    fabs_can = 1 - exp(-ForParms->kF * LAIc);
-//    Rprintf("fabs_can=%g \n", fabs_can);
+    fabs_can = 1 - gexp(-ForParms->kF * LAIc);
     // Fraction of light absorbed by the tree's canopy, and total amount of light absorbed by the tree:
     fabs = fminmacro(fabs_tree, fabs_both * fabs_tree / (fabs_tree + fabs_can));
-//    Rprintf("fabs=%g \n", fabs);
-//    Rprintf("LAI->bot=%g \n", LAI->bot);
     assert(LAI->bot > 0);
     APAR_bot = Ioint * fabs * LA->bot / LAI->bot;
-//    Rprintf("APAR_bot=%g \n", APAR_bot);
     APAR = APAR_top + APAR_bot;
-//    Rprintf("APAR=%g \n", APAR);
   }
   else{
     printf("APAR not determined for gap sim. \n");
-    printf("H: %f\n", H);
+    printf("H: %f\n", GVAL(H));
     printf("Hc: %f\n", Hc);
-    printf("eta: %f\n", eta);
+    printf("eta: %f\n", GVAL(eta));
     exit(1);
   }
   // APAR out and save value Ioint to APARout
   APARout[0] = APAR;
   APARout[1] = Ioint;
-  
-  //Rprintf("APARout[0]: %g\n", APAR);
-  //Rprintf("APARout[1]: %g\n", Ioint);
-  //Rprintf("\n");
-  //Rprintf("\n");
-//  Rprintf("Ioint=%g \n", Ioint);
+  GTRACE(GT_APAR, 0, APAR, Ioint, 0);
   //return APARout;
 }
 
@@ -913,12 +849,10 @@ void updateSparms(
 ){
 
   for(int i = 0; i < 33; i++){
-    // Rprintf("value of index: %i value ofsparms_indicator: %i\n", index, sparms_indicator);
   }
   if(sparms_indicator[0] > 1){
     p->hmax = hmax[index];
   }
-  //Rprintf("update hmax: %g index: %i\n", hmax[0], index);
   if(sparms_indicator[1] > 1){
     p->phih = phih[index];
   }
@@ -974,12 +908,10 @@ void updateSparms(
     p->deltar = deltar[index];
   }
   if(sparms_indicator[16] > 1){
-    // Rprintf("update hmax: %g index: %i\n", hmax[0], index);
     p->sl = sl[index];
   }
   if(sparms_indicator[17] > 1){
     p->sla = sla[index];
-    // Rprintf("update sla: %g index: %i\n", sla[index], index);
   }
   if(sparms_indicator[18] > 1){
     p->sr = sr[index];
@@ -1022,4 +954,111 @@ void updateSparms(
   }
   // p->drcrit = 
   // p->drinit = 
-}
\ No newline at end of file
+}
+
+
+///
+/// Lookup tables for sparms and tstates.  These let code that handles
+/// parameters or states generically (checkpoints, the R interface) refer to
+/// an entry by name or index instead of spelling out every member.
+///
+/// The sparms order is the order of the sparms list in R followed by the four
+/// values runacgca() appends (rhomin, gammaw, drinit, drcrit).  Note that the
+/// R name for rhomax is 'rho'.
+///
+const char *sparms_names[NSPARMS] = {
+  "hmax", "phih", "eta", "swmax", "lamdas", "lamdah", "rho", "f2", "f1",
+  "gammac", "gammax", "cgl", "cgr", "cgw", "deltal", "deltar", "sl", "sla",
+  "sr", "so", "rr", "rhor", "rml", "rms", "rmr", "etaB", "K", "epsg", "M",
+  "alpha", "R0", "R40", "rhomin", "gammaw", "drinit", "drcrit"
+};
+
+const size_t sparms_offsets[NSPARMS] = {
+  offsetof(sparms, hmax), offsetof(sparms, phih), offsetof(sparms, eta),
+  offsetof(sparms, swmax), offsetof(sparms, lamdas),
+  offsetof(sparms, lamdah), offsetof(sparms, rhomax), offsetof(sparms, f2),
+  offsetof(sparms, f1), offsetof(sparms, gammac), offsetof(sparms, gammax),
+  offsetof(sparms, cgl), offsetof(sparms, cgr), offsetof(sparms, cgw),
+  offsetof(sparms, deltal), offsetof(sparms, deltar), offsetof(sparms, sl),
+  offsetof(sparms, sla), offsetof(sparms, sr), offsetof(sparms, so),
+  offsetof(sparms, rr), offsetof(sparms, rhor), offsetof(sparms, rml),
+  offsetof(sparms, rms), offsetof(sparms, rmr), offsetof(sparms, etaB),
+  offsetof(sparms, K), offsetof(sparms, epsg), offsetof(sparms, M),
+  offsetof(sparms, alpha), offsetof(sparms, R0), offsetof(sparms, R40),
+  offsetof(sparms, rhomin), offsetof(sparms, gammaw),
+  offsetof(sparms, drinit), offsetof(sparms, drcrit)
+};
+
+const char *tstates_names[NTSTATES] = {
+  "h", "hh", "hC", "hB", "hBH", "r", "rB", "rC", "rBH", "sw", "vts", "vt",
+  "vth", "sa", "la", "ra", "dr", "xa", "bl", "br", "bt", "bts", "bth", "boh",
+  "bos", "bo", "bs", "cs", "clr", "fl", "fr", "ft", "fo", "rfl", "rfr",
+  "rfs", "egrow", "ex", "rtrans", "light", "nut", "deltas", "LAI"
+};
+
+const size_t tstates_offsets[NTSTATES] = {
+  offsetof(tstates, h), offsetof(tstates, hh), offsetof(tstates, hC),
+  offsetof(tstates, hB), offsetof(tstates, hBH), offsetof(tstates, r),
+  offsetof(tstates, rB), offsetof(tstates, rC), offsetof(tstates, rBH),
+  offsetof(tstates, sw), offsetof(tstates, vts), offsetof(tstates, vt),
+  offsetof(tstates, vth), offsetof(tstates, sa), offsetof(tstates, la),
+  offsetof(tstates, ra), offsetof(tstates, dr), offsetof(tstates, xa),
+  offsetof(tstates, bl), offsetof(tstates, br), offsetof(tstates, bt),
+  offsetof(tstates, bts), offsetof(tstates, bth), offsetof(tstates, boh),
+  offsetof(tstates, bos), offsetof(tstates, bo), offsetof(tstates, bs),
+  offsetof(tstates, cs), offsetof(tstates, clr), offsetof(tstates, fl),
+  offsetof(tstates, fr), offsetof(tstates, ft), offsetof(tstates, fo),
+  offsetof(tstates, rfl), offsetof(tstates, rfr), offsetof(tstates, rfs),
+  offsetof(tstates, egrow), offsetof(tstates, ex), offsetof(tstates, rtrans),
+  offsetof(tstates, light), offsetof(tstates, nut),
+  offsetof(tstates, deltas), offsetof(tstates, LAI)
+};
+
+/// Species parameters of acer rubrum and pinus taeda (the acru and pita
+/// lists in R, Ogle and Pacala 2009) in the order of sparms_names.
+static const double species_acru[32] = {27.5, 263, 0.64, 0.1, 0.95, 0.95,
+  525000, 7000, 4, 131000, 0.12, 1.45, 1.25, 1.37, 0.095, 0.15, 1, 0.0141, 1,
+  0.05, 0.00015, 160000, 1.25, 0.025, 0.75, 0.045, 0.7, 6.75, 0.95, 0.365,
+  1.909, 5.592};
+static const double species_pita[32] = {42, 220, 0.71, 0.06, 0.95, 0.95,
+  380000, 2100, 4, 265000, 0.62, 1.51, 1.3, 1.47, 0.11, 0.08, 0.33, 0.006,
+  0.5, 0.05, 0.00027, 200000, 0.95, 0.025, 0.075, 0.045, 0.55, 4.5, 0.95,
+  0.308, 1.434, 3.873};
+
+/// Fills v with the sparms of species "acru" or "pita", returns 1 if unknown.
+int species_parms(const char *name, double *v){
+  const double *sp;
+
+  if(strcmp(name, "acru") == 0){
+    sp = species_acru;
+  }else if(strcmp(name, "pita") == 0){
+    sp = species_pita;
+  }else{
+    return 1;
+  }
+  memcpy(v, sp, 32*sizeof(double));
+  v[32] = sp[6];      // rhomin = rho, as in runacgca()
+  v[33] = 0.000000667; // gammaw
+  v[34] = 0.00001;    // drinit
+  v[35] = 0.0075;     // drcrit
+  return 0;
+}
+
+/// Returns the sparms table index for a parameter name or -1 if unknown.
+int sparms_index(const char *name){
+  for(int k = 0; k < NSPARMS; k++){
+    if(strcmp(name, sparms_names[k]) == 0){
+      return k;
+    }
+  }
+  return -1;
+}
+
+/// Sets entry k of the sparms table to v.  rhomin follows rho (as in
+/// runacgca()) unless rhominset is 1.
+void sparms_set(sparms *p, int k, greal v, int rhominset){
+  *SPARMS_REF(p, k) = v;
+  if(k == 6 && !rhominset){
+    p->rhomin = v;
+  }
+}
@@ -6,12 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <R.h>
+#include "head_files/rprint.h"
 
 #include "head_files/misc_growth_funcs.h"
 
-double photosynthesis(sparms *p, tstates *st){
-    //Rprintf("epsg: %g\n", p->epsg);
-    //Rprintf("light: %g\n", st->light);
+greal photosynthesis(sparms *p, tstates *st){
     return(p->epsg*st->light);
 }
\ No newline at end of file
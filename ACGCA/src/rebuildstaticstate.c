@@ -36,7 +36,7 @@
 ///
 /// \date 12-07-2010
 ///
-void rebuildstaticstate(sparms *p, tstates *st, gparms *gp, rebuild *rebld, int i, double deltaw){
+void rebuildstaticstate(sparms *p, tstates *st, gparms *gp, rebuild *rebld, int i, greal deltaw){
 
   // Calculate new state variables:
   //nut=0.0;  //ask about this
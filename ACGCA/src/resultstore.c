@@ -0,0 +1,542 @@
+/// \file resultstore.c
+/// \brief Columnar binary store for simulation results.  Large ensembles
+/// are written run by run from C so they never have to be held in R, and
+/// single columns can be read back without loading the whole file.
+///
+/// Layout (native byte order, checked on open):
+///   char magic[8]        "ACGCARS"
+///   int  hdr[8]          version, byte order marker, lenvars, nd, ni,
+///                        encoding (ENC_*), 0, 0
+///   double errbound      error bound of ENC_QUANT
+///   int  ids[nd + ni]    gfield/gifield index of each field
+///   char names[nd + ni][RSTORE_NAMELEN]
+///   (padding to a multiple of 8 bytes)
+///   records (ENC_RAW):
+///     long long runid
+///     int nstored, int 0
+///     double column[nd][lenvars]
+///     int    column[ni][lenvars]
+///     (padding to a multiple of 8 bytes)
+///   records (ENC_EXACT, ENC_QUANT):
+///     long long runid
+///     int nstored, int nbytes (bytes of the chunks that follow)
+///     nd + ni chunks of: int len, unsigned char chunk[len] (see encoding.c)
+///
+/// Raw records have a fixed size so record i is found directly.  Encoded
+/// records vary in size and are indexed when the store is opened for
+/// reading.  Appends from several threads are serialized so each record is
+/// written in one piece; encoding happens before, in parallel.  When
+/// reading the file is memory mapped where available.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/encoding.h"
+#include "head_files/resultstore.h"
+
+#if defined(_WIN32)
+#define rs_fseek _fseeki64
+#define rs_ftell _ftelli64
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#define rs_fseek fseeko
+#define rs_ftell ftello
+#endif
+
+static const char rsmagic[8] = "ACGCARS";
+static const int rsendian = 0x01020304;
+
+#define RS_PAD8(x) (((x) + 7) & ~7LL)
+
+// Bytes of the run id, nstored and nbytes at the start of each record.
+#define RS_RECHDR ((long long)(sizeof(long long) + 2*sizeof(int)))
+
+// Sizes of the header and of one record for the fields in rs.
+static void rstore_sizes(rstore *rs){
+	rs->hdrsize = RS_PAD8(8 + 8*(long long)sizeof(int) + sizeof(double) +
+		(long long)(rs->nd + rs->ni)*(sizeof(int) + RSTORE_NAMELEN));
+	rs->recsize = RS_PAD8(sizeof(long long) + 2*sizeof(int) +
+		(long long)rs->lenvars*(rs->nd*sizeof(double) + rs->ni*sizeof(int)));
+}
+
+// Reads and checks the header of an open file.  Returns 0 on success.
+static int rstore_readheader(rstore *rs){
+	char magic[8];
+	int hdr[8], ids[GF_NDOUBLE + GI_NINT], k;
+
+	if (rs_fseek(rs->fp, 0, SEEK_SET) != 0 || fread(magic, 1, 8, rs->fp) != 8 ||
+		memcmp(magic, rsmagic, 8) != 0 || fread(hdr, sizeof(int), 8, rs->fp) != 8){
+		return 2;
+	}
+	if (hdr[0] != RSTORE_VERSION || hdr[1] != rsendian || hdr[2] < 1 ||
+		hdr[3] < 0 || hdr[3] > GF_NDOUBLE || hdr[4] < 0 || hdr[4] > GI_NINT ||
+		hdr[5] < ENC_RAW || hdr[5] > ENC_QUANT){
+		return 3;
+	}
+	rs->lenvars = hdr[2];
+	rs->nd = hdr[3];
+	rs->ni = hdr[4];
+	rs->encoding = hdr[5];
+	if (fread(&rs->errbound, sizeof(double), 1, rs->fp) != 1 ||
+		fread(ids, sizeof(int), rs->nd + rs->ni, rs->fp) != (size_t)(rs->nd + rs->ni)){
+		return 2;
+	}
+	for (k = 0; k < rs->nd; k++){
+		rs->did[k] = ids[k];
+	}
+	for (k = 0; k < rs->ni; k++){
+		rs->iid[k] = ids[rs->nd + k];
+	}
+	rstore_sizes(rs);
+	return 0;
+}
+
+// Copies n bytes at offset off of the store into dst.  Returns 0 on success.
+static int rstore_get(rstore *rs, long long off, void *dst, size_t n){
+	if (rs->map != NULL){
+		if (off < 0 || off + (long long)n > (long long)rs->maplen){
+			return 1;
+		}
+		memcpy(dst, rs->map + off, n);
+		return 0;
+	}
+	if (rs_fseek(rs->fp, off, SEEK_SET) != 0 || fread(dst, 1, n, rs->fp) != n){
+		return 1;
+	}
+	return 0;
+}
+
+// Counts the complete records of a file of len bytes.  Encoded records are
+// walked one by one and their offsets kept in rs->recoff if index is 1.
+// Returns 0 if the file ends on a record boundary, 4 if the last record is
+// incomplete and 1 if the index could not be allocated.
+static int rstore_count(rstore *rs, long long len, int index){
+	long long pos, cap = 0;
+	int nbytes;
+
+	if (len < rs->hdrsize){
+		return 2;
+	}
+	if (rs->encoding == ENC_RAW){
+		rs->nrec = (len - rs->hdrsize) / rs->recsize;
+		return (((len - rs->hdrsize) % rs->recsize) == 0) ? 0 : 4;
+	}
+
+	rs->nrec = 0;
+	for (pos = rs->hdrsize; pos + RS_RECHDR <= len; pos += RS_RECHDR + nbytes){
+		if (rstore_get(rs, pos + sizeof(long long) + sizeof(int), &nbytes, sizeof(int)) ||
+			nbytes < 0 || pos + RS_RECHDR + nbytes > len){
+			return 4;
+		}
+		if (index){
+			if (rs->nrec == cap){
+				long long *tmp;
+				cap = (cap == 0) ? 1024 : 2*cap;
+				tmp = realloc(rs->recoff, cap*sizeof(long long));
+				if (tmp == NULL){
+					return 1;
+				}
+				rs->recoff = tmp;
+			}
+			rs->recoff[rs->nrec] = pos;
+		}
+		rs->nrec++;
+	}
+	return (pos == len) ? 0 : 4;
+}
+
+// Offset of record rec.
+static long long rstore_recpos(rstore *rs, long long rec){
+	if (rs->encoding == ENC_RAW){
+		return rs->hdrsize + rec*rs->recsize;
+	}
+	return rs->recoff[rec];
+}
+
+// Size of the file of an open store.
+static long long rstore_filesize(rstore *rs){
+	if (rs_fseek(rs->fp, 0, SEEK_END) != 0){
+		return -1;
+	}
+	return rs_ftell(rs->fp);
+}
+
+/// rstore_open() opens a result store for appending.  A new file is
+/// created with the fields that are not NULL in fields.  An existing file
+/// must have been created with the same lenvars and fields; its encoding and
+/// error bound are kept, whatever encoding and errbound are.
+///
+/// \param rs       returns the open store
+/// \param file     name of the store
+/// \param lenvars  values per column (steps*years+1)
+/// \param fields   output arrays, only used to select the fields
+/// \param encoding ENC_RAW, ENC_EXACT or ENC_QUANT (see encoding.h) of a
+///                 new store
+/// \param errbound error bound of ENC_QUANT relative to the largest
+///                 magnitude in each column of a new store
+///
+/// Returns 0 on success, 1 if the file could not be opened or written, 2 if
+/// it is not a result store, 3 if it has a different version or layout and
+/// 4 if the last record is incomplete.
+///
+int rstore_open(rstore *rs, const char *file, int lenvars, goutput *fields,
+	int encoding, double errbound){
+	int k, err;
+	rstore want;
+
+	memset(rs, 0, sizeof(rstore));
+	memset(&want, 0, sizeof(rstore));
+	want.lenvars = lenvars;
+	want.encoding = encoding;
+	want.errbound = errbound;
+	for (k = 0; k < GF_NDOUBLE; k++){
+		if (fields->v[k] != NULL || fields->f[k] != NULL) want.did[want.nd++] = k;
+	}
+	for (k = 0; k < GI_NINT; k++){
+		if (fields->iv[k] != NULL) want.iid[want.ni++] = k;
+	}
+
+	rs->fp = fopen(file, "rb");
+	if (rs->fp != NULL){
+		// Existing store, check it matches
+		err = rstore_readheader(rs);
+		if (err == 0 && (rs->lenvars != want.lenvars || rs->nd != want.nd ||
+			rs->ni != want.ni ||
+			memcmp(rs->did, want.did, want.nd*sizeof(int)) != 0 ||
+			memcmp(rs->iid, want.iid, want.ni*sizeof(int)) != 0)){
+			err = 3;
+		}
+		if (err == 0){
+			err = rstore_count(rs, rstore_filesize(rs), 0);
+		}
+		fclose(rs->fp);
+		rs->fp = NULL;
+		if (err != 0){
+			return err;
+		}
+		rs->fp = fopen(file, "ab");
+		if (rs->fp == NULL){
+			return 1;
+		}
+	}
+	else{
+		// New store, write the header
+		int hdr[8] = {RSTORE_VERSION, rsendian, lenvars, want.nd, want.ni,
+			encoding, 0, 0};
+		char name[RSTORE_NAMELEN];
+		long long pos;
+
+		*rs = want;
+		rstore_sizes(rs);
+		rs->fp = fopen(file, "wb");
+		if (rs->fp == NULL){
+			return 1;
+		}
+		err = fwrite(rsmagic, 1, 8, rs->fp) != 8 ||
+			fwrite(hdr, sizeof(int), 8, rs->fp) != 8 ||
+			fwrite(&rs->errbound, sizeof(double), 1, rs->fp) != 1 ||
+			fwrite(rs->did, sizeof(int), rs->nd, rs->fp) != (size_t)rs->nd ||
+			fwrite(rs->iid, sizeof(int), rs->ni, rs->fp) != (size_t)rs->ni;
+		for (k = 0; k < rs->nd + rs->ni; k++){
+			memset(name, 0, RSTORE_NAMELEN);
+			strncpy(name, (k < rs->nd) ? gfield_names[rs->did[k]] :
+				gifield_names[rs->iid[k - rs->nd]], RSTORE_NAMELEN - 1);
+			err = err || fwrite(name, 1, RSTORE_NAMELEN, rs->fp) != RSTORE_NAMELEN;
+		}
+		for (pos = rs_ftell(rs->fp); pos < rs->hdrsize; pos++){
+			err = err || fputc(0, rs->fp) == EOF;
+		}
+		if (err){
+			fclose(rs->fp);
+			rs->fp = NULL;
+			return 1;
+		}
+	}
+
+	rs->writable = 1;
+	return 0;
+}
+
+// Output k of out as doubles, single precision outputs (out->f) are
+// widened into wide.
+static double *rstore_widen(goutput *out, int k, int lenvars, double *wide){
+	int j;
+
+	if (out->v[k] != NULL){
+		return out->v[k];
+	}
+	for (j = 0; j < lenvars; j++){
+		wide[j] = out->f[k][j];
+	}
+	return wide;
+}
+
+// Appends one run as encoded chunks.  The chunks are encoded into one
+// buffer by the calling thread and only the write is serialized.
+static int rstore_append_enc(rstore *rs, long long runid, int nstored, goutput *out){
+	int k, err = 0;
+	int nst[2] = {nstored, 0};
+	size_t len = 0, clen;
+	unsigned char *buf;
+	double *wide;
+
+	buf = malloc((rs->nd + rs->ni)*(sizeof(int) + ENC_BOUND(rs->lenvars)));
+	wide = malloc(rs->lenvars*sizeof(double));
+	if (buf == NULL || wide == NULL){
+		free(buf);
+		free(wide);
+		return 1;
+	}
+	for (k = 0; k < rs->nd + rs->ni; k++){
+		if (k < rs->nd){
+			clen = enc_doubles(rstore_widen(out, rs->did[k], rs->lenvars, wide),
+				rs->lenvars, rs->encoding, rs->errbound, buf + len + sizeof(int));
+		}
+		else{
+			clen = enc_ints(out->iv[rs->iid[k - rs->nd]], rs->lenvars,
+				buf + len + sizeof(int));
+		}
+		int ilen = (int)clen;
+		memcpy(buf + len, &ilen, sizeof(int));
+		len += sizeof(int) + clen;
+	}
+	nst[1] = (int)len;
+
+#ifdef _OPENMP
+	#pragma omp critical(rstore)
+#endif
+	{
+		if (rs->writable){
+			err = fwrite(&runid, sizeof(long long), 1, rs->fp) != 1 ||
+				fwrite(nst, sizeof(int), 2, rs->fp) != 2 ||
+				fwrite(buf, 1, len, rs->fp) != len;
+			if (!err){
+				rs->nrec++;
+			}
+			else{
+				rs->writable = 0;
+			}
+		}
+		else{
+			err = 1;
+		}
+	}
+
+	free(buf);
+	free(wide);
+	return err;
+}
+
+/// rstore_append() appends one run to the store.  Safe to call from
+/// several OpenMP threads at once.
+///
+/// \param rs       store opened with rstore_open()
+/// \param runid    id of the run
+/// \param nstored  number of valid values in each column (steps taken + 1)
+/// \param out      output arrays of the run, must hold the store's fields
+///                 (in double or single precision, the store keeps doubles)
+///
+/// Returns 0 on success and 1 if the write failed.
+///
+int rstore_append(rstore *rs, long long runid, int nstored, goutput *out){
+	int k, err = 0;
+	int nst[2] = {nstored, 0};
+	long long pad;
+	double *wide;
+
+	if (rs->encoding != ENC_RAW){
+		return rstore_append_enc(rs, runid, nstored, out);
+	}
+	wide = malloc(rs->lenvars*sizeof(double));
+	if (wide == NULL){
+		return 1;
+	}
+
+	pad = rs->recsize - (sizeof(long long) + 2*sizeof(int) +
+		(long long)rs->lenvars*(rs->nd*sizeof(double) + rs->ni*sizeof(int)));
+
+#ifdef _OPENMP
+	#pragma omp critical(rstore)
+#endif
+	{
+		if (rs->writable){
+			err = fwrite(&runid, sizeof(long long), 1, rs->fp) != 1 ||
+				fwrite(nst, sizeof(int), 2, rs->fp) != 2;
+			for (k = 0; k < rs->nd; k++){
+				err = err || fwrite(rstore_widen(out, rs->did[k], rs->lenvars, wide),
+					sizeof(double), rs->lenvars, rs->fp) != (size_t)rs->lenvars;
+			}
+			for (k = 0; k < rs->ni; k++){
+				err = err || fwrite(out->iv[rs->iid[k]], sizeof(int), rs->lenvars,
+					rs->fp) != (size_t)rs->lenvars;
+			}
+			for (; pad > 0; pad--){
+				err = err || fputc(0, rs->fp) == EOF;
+			}
+			if (!err){
+				rs->nrec++;
+			}
+			else{
+				// A partial record was written, later records would be misaligned
+				rs->writable = 0;
+			}
+		}
+		else{
+			err = 1;
+		}
+	}
+
+	free(wide);
+	return err;
+}
+
+/// rstore_openread() opens a result store for reading.  The file is
+/// memory mapped where possible so single columns can be read without
+/// loading the rest of the file.
+///
+/// Returns 0 on success and the error codes of rstore_open() otherwise.  An
+/// incomplete last record is not an error when reading, it is skipped.
+///
+int rstore_openread(rstore *rs, const char *file){
+	int err;
+	long long len;
+
+	memset(rs, 0, sizeof(rstore));
+	rs->fp = fopen(file, "rb");
+	if (rs->fp == NULL){
+		return 1;
+	}
+	err = rstore_readheader(rs);
+	len = rstore_filesize(rs);
+
+#if !defined(_WIN32)
+	if (err == 0 && len > 0){
+		rs->maplen = len;
+		rs->map = mmap(NULL, rs->maplen, PROT_READ, MAP_SHARED, fileno(rs->fp), 0);
+		if (rs->map == MAP_FAILED){
+			rs->map = NULL;
+		}
+	}
+#endif
+
+	if (err == 0){
+		err = rstore_count(rs, len, 1);
+		if (err == 4){
+			err = 0;
+		}
+	}
+	if (err != 0){
+		rstore_close(rs);
+		return err;
+	}
+	return 0;
+}
+
+/// rstore_runid() returns the run id of record rec (-1 if out of range).
+long long rstore_runid(rstore *rs, long long rec){
+	long long id;
+
+	if (rec < 0 || rec >= rs->nrec ||
+		rstore_get(rs, rstore_recpos(rs, rec), &id, sizeof(long long))){
+		return -1;
+	}
+	return id;
+}
+
+/// rstore_nstored() returns the number of valid values per column in
+/// record rec (-1 if out of range).
+int rstore_nstored(rstore *rs, long long rec){
+	int n;
+
+	if (rec < 0 || rec >= rs->nrec || rstore_get(rs,
+		rstore_recpos(rs, rec) + sizeof(long long), &n, sizeof(int))){
+		return -1;
+	}
+	return n;
+}
+
+// Decodes chunk k (doubles first, then ints) of encoded record rec.
+static int rstore_chunk(rstore *rs, long long rec, int k, double *dst, int *idst){
+	long long pos = rstore_recpos(rs, rec) + RS_RECHDR;
+	int j, len = 0, err;
+	unsigned char *buf;
+
+	for (j = 0; j <= k; j++){
+		if (rstore_get(rs, pos, &len, sizeof(int)) || len < 0){
+			return 1;
+		}
+		if (j < k){
+			pos += sizeof(int) + len;
+		}
+	}
+	pos += sizeof(int);
+
+	if (rs->map != NULL){
+		if (pos + len > (long long)rs->maplen){
+			return 1;
+		}
+		buf = (unsigned char *)rs->map + pos;
+	}
+	else{
+		buf = malloc(len);
+		if (buf == NULL || rstore_get(rs, pos, buf, len)){
+			free(buf);
+			return 1;
+		}
+	}
+	err = (dst != NULL) ? dec_doubles(buf, len, dst, rs->lenvars) :
+		dec_ints(buf, len, idst, rs->lenvars);
+	if (rs->map == NULL){
+		free(buf);
+	}
+	return err;
+}
+
+/// rstore_column() copies the column chunk of double field k (index into
+/// rs->did) of record rec to dst (lenvars values).  Returns 0 on success.
+int rstore_column(rstore *rs, long long rec, int k, double *dst){
+	if (rec < 0 || rec >= rs->nrec || k < 0 || k >= rs->nd){
+		return 1;
+	}
+	if (rs->encoding != ENC_RAW){
+		return rstore_chunk(rs, rec, k, dst, NULL);
+	}
+	return rstore_get(rs, rstore_recpos(rs, rec) + RS_RECHDR +
+		(long long)k*rs->lenvars*sizeof(double), dst,
+		rs->lenvars*sizeof(double));
+}
+
+/// rstore_icolumn() copies the column chunk of integer field k (index into
+/// rs->iid) of record rec to dst (lenvars values).  Returns 0 on success.
+int rstore_icolumn(rstore *rs, long long rec, int k, int *dst){
+	if (rec < 0 || rec >= rs->nrec || k < 0 || k >= rs->ni){
+		return 1;
+	}
+	if (rs->encoding != ENC_RAW){
+		return rstore_chunk(rs, rec, rs->nd + k, NULL, dst);
+	}
+	return rstore_get(rs, rstore_recpos(rs, rec) + RS_RECHDR +
+		(long long)rs->lenvars*(rs->nd*sizeof(double) + k*sizeof(int)), dst,
+		rs->lenvars*sizeof(int));
+}
+
+/// rstore_close() closes a store opened for reading or writing.
+void rstore_close(rstore *rs){
+#if !defined(_WIN32)
+	if (rs->map != NULL){
+		munmap(rs->map, rs->maplen);
+	}
+#endif
+	if (rs->fp != NULL){
+		fclose(rs->fp);
+	}
+	free(rs->recoff);
+	memset(rs, 0, sizeof(rstore));
+}
@@ -0,0 +1,64 @@
+/// \file rng.c
+/// \brief xoshiro256** random number generator (Blackman and Vigna 2018)
+/// with uniform and normal draws.  Used instead of rand() so chains running
+/// in different threads have independent, reproducible streams.
+///
+/// \author Michael Fell
+
+#include <stdint.h>
+#include <math.h>
+
+#include "head_files/rng.h"
+
+static uint64_t rotl(const uint64_t x, int k){
+  return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64, used to fill the state from a single seed
+static uint64_t splitmix64(uint64_t *x){
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/// rng_seed() seeds the generator.  Different streams of the same seed give
+/// independent sequences (e.g., one stream per chain).
+///
+/// \param rng      generator state
+/// \param seed     seed
+/// \param stream   stream number
+///
+void rng_seed(rngstate *rng, uint64_t seed, uint64_t stream){
+  uint64_t x = seed ^ (stream * 0xd1342543de82ef95ULL);
+  for(int k = 0; k < 4; k++){
+    rng->s[k] = splitmix64(&x);
+  }
+}
+
+/// rng_next() returns the next 64 random bits.
+uint64_t rng_next(rngstate *rng){
+  uint64_t *s = rng->s;
+  const uint64_t result = rotl(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+/// rng_unif() returns a uniform draw on (0, 1).
+double rng_unif(rngstate *rng){
+  return ((rng_next(rng) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+/// rng_norm() returns a standard normal draw (Box-Muller).
+double rng_norm(rngstate *rng){
+  double u1 = rng_unif(rng), u2 = rng_unif(rng);
+  return sqrt(-2.0*log(u1)) * cos(6.283185307179586*u2);
+}
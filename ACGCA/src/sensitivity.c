@@ -0,0 +1,319 @@
+/// \file sensitivity.c
+/// \brief Global sensitivity analysis of scalar outputs (e.g., final DBH,
+/// time of death, biomass) to a set of species parameters, each varied over
+/// a range.
+///
+/// sa_sobol() estimates first order and total Sobol indices from the
+/// Saltelli design (matrices A, B and A with column k from B, Saltelli et
+/// al. 2010) and sa_morris() the elementary effects of Morris (1991) from
+/// random one at a time trajectories on a grid.  The design is generated in
+/// blocks of rows, the runs of a block are done in parallel and their
+/// outputs go into running (streaming) estimators, so memory does not grow
+/// with the number of samples and only the indices are returned.  Results
+/// do not depend on the number of threads.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/rng.h"
+#include "head_files/sensitivity.h"
+
+/// Rows of the design simulated per block.
+#define SA_BLOCK 256
+
+/// sa_eval() simulates the tree with the varied parameters at u (each in
+/// [0, 1] over its range) and returns the outputs in y.  Returns 1 if an
+/// output is not finite, 0 otherwise.
+int sa_eval(const satarget *t, const double *u, double *y){
+  sparms p = t->p;
+  gparms gp = t->gp;
+  gforcing f = t->f;
+  gcheckpoint ck;
+  goutput out;
+  double r0 = t->r0, v[GF_NDOUBLE];
+  int j, k, dead = 0, bad = 0;
+
+  for(k = 0; k < t->npar; k++){
+    sparms_set(&p, t->park[k], t->lo[k] + u[k]*(t->hi[k] - t->lo[k]), 0);
+  }
+
+  // Only the state at the end is needed
+  memset(&out, 0, sizeof(goutput));
+  growthloop_init(&p, &gp, &r0, &ck);
+  for(j = 1; j <= t->nsteps && !dead; j++){
+    dead = growthloop_step(&gp, &ck, t->ps, &f, &out, j);
+  }
+  for(k = 0; k < GF_NDOUBLE; k++){
+    out.v[k] = &v[k];
+  }
+  growthloop_store(&ck, &gp, &out, 0);
+
+  for(k = 0; k < t->nout; k++){
+    switch(t->out[k]){
+    case SA_DEATH:
+      y[k] = t->mult[k]*ck.step*gp.deltat;
+      break;
+    case SA_BIOMASS:
+      y[k] = t->mult[k]*(v[GF_bl] + v[GF_br] + v[GF_bt] + v[GF_bo]);
+      break;
+    default:
+      y[k] = t->mult[k]*v[t->out[k]];
+    }
+    if(!isfinite(y[k])){
+      bad = 1;
+    }
+  }
+  return bad;
+}
+
+// Runs the nrun points u[i*npar] of a block into y[i*nout].  A point whose
+// outputs are not finite gets NAN outputs.
+static void sa_block(const satarget *t, int nrun, const double *u, double *y,
+  int nthreads){
+
+  int i, k;
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads) private(k)
+#endif
+  for(i = 0; i < nrun; i++){
+    if(sa_eval(t, u + (size_t)i*t->npar, y + (size_t)i*t->nout) != 0){
+      for(k = 0; k < t->nout; k++){
+        y[(size_t)i*t->nout + k] = NAN;
+      }
+    }
+  }
+}
+
+static int sa_threads(int nthreads){
+#ifdef _OPENMP
+  return (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+  (void)nthreads;
+  return 1;
+#endif
+}
+
+// Welford update of a running mean and sum of squares with the n-th value.
+static void sa_welford(double *mean, double *m2, long n, double x){
+  double dx = x - *mean;
+  *mean += dx/n;
+  *m2 += dx*(x - *mean);
+}
+
+/// sa_sobol() estimates Sobol indices from n rows of the Saltelli design,
+/// n*(npar + 2) runs in all.  S1 uses the estimator of Saltelli et al.
+/// (2010) and ST that of Jansen (1999), both divided by the variance of the
+/// outputs of A and B.  Returns 1 if memory could not be allocated.
+int sa_sobol(const satarget *t, long n, uint64_t seed, int nthreads,
+  sasobol *r){
+
+  int d = t->npar, no = t->nout, nr = d + 2, i, k, m, o, nb, ok;
+  long row, nv = 0;
+  double *u, *y, *shift, *ms, *m2s, *mt, *m2t, *mean, *m2, fa, fb, fab;
+  rngstate rng;
+
+  nthreads = sa_threads(nthreads);
+  u = malloc((size_t)SA_BLOCK*nr*d*sizeof(double));
+  y = malloc((size_t)SA_BLOCK*nr*no*sizeof(double));
+  ms = calloc((size_t)4*no*d + 3*no, sizeof(double));
+  if(u == NULL || y == NULL || ms == NULL){
+    free(u);
+    free(y);
+    free(ms);
+    return 1;
+  }
+  m2s = ms + no*d;
+  mt = m2s + no*d;
+  m2t = mt + no*d;
+  mean = m2t + no*d;
+  m2 = mean + no;
+  shift = m2 + no;
+
+  rng_seed(&rng, seed, 0);
+  r->n = 0;
+  r->nskip = 0;
+  for(row = 0; row < n; row += nb){
+    nb = (n - row < SA_BLOCK) ? (int)(n - row) : SA_BLOCK;
+
+    // Rows of A and B, then A with column k from B
+    for(i = 0; i < nb; i++){
+      double *a = u + (size_t)i*nr*d, *b = a + d;
+      for(k = 0; k < d; k++){
+        a[k] = rng_unif(&rng);
+      }
+      for(k = 0; k < d; k++){
+        b[k] = rng_unif(&rng);
+      }
+      for(k = 0; k < d; k++){
+        memcpy(a + (size_t)(2 + k)*d, a, d*sizeof(double));
+        a[(size_t)(2 + k)*d + k] = b[k];
+      }
+    }
+    sa_block(t, nb*nr, u, y, nthreads);
+
+    // Streaming estimators, in row order
+    for(i = 0; i < nb; i++){
+      const double *yi = y + (size_t)i*nr*no;
+      for(m = 0, ok = 1; m < nr*no; m++){
+        ok = ok && isfinite(yi[m]);
+      }
+      if(!ok){
+        r->nskip++;
+        continue;
+      }
+      r->n++;
+      nv += 2;
+      for(o = 0; o < no; o++){
+        fa = yi[o];
+        fb = yi[no + o];
+        // The estimators are centred on the first output to limit rounding
+        if(r->n == 1){
+          shift[o] = fa;
+        }
+        sa_welford(&mean[o], &m2[o], nv - 1, fa);
+        sa_welford(&mean[o], &m2[o], nv, fb);
+        for(k = 0; k < d; k++){
+          fab = yi[(2 + k)*no + o];
+          sa_welford(&ms[o*d + k], &m2s[o*d + k], r->n,
+            (fb - shift[o])*(fab - fa));
+          sa_welford(&mt[o*d + k], &m2t[o*d + k], r->n, 0.5*(fa - fab)*(fa - fab));
+        }
+      }
+    }
+  }
+
+  for(o = 0; o < no; o++){
+    double v = (nv > 1) ? m2[o]/(nv - 1) : NAN;
+    r->mean[o] = (nv > 0) ? mean[o] : NAN;
+    r->var[o] = v;
+    for(k = 0; k < d; k++){
+      m = o*d + k;
+      r->S1[m] = ms[m]/v;
+      r->ST[m] = mt[m]/v;
+      if(r->S1se != NULL){
+        r->S1se[m] = (r->n > 1) ? sqrt(m2s[m]/(r->n - 1)/r->n)/v : NAN;
+      }
+      if(r->STse != NULL){
+        r->STse[m] = (r->n > 1) ? sqrt(m2t[m]/(r->n - 1)/r->n)/v : NAN;
+      }
+    }
+  }
+
+  free(u);
+  free(y);
+  free(ms);
+  return 0;
+}
+
+/// sa_morris() computes elementary effects from n trajectories of npar + 1
+/// runs on a grid with levels (even) levels per parameter and steps of
+/// levels/(2*(levels - 1)) (Morris 1991).  Each trajectory starts at a
+/// random grid point and changes the parameters one at a time in random
+/// order and direction.  Effects are on the unit scale of each range (the
+/// change of the output per full range).  Returns 1 if memory could not be
+/// allocated and 2 for invalid levels.
+int sa_morris(const satarget *t, long n, int levels, uint64_t seed,
+  int nthreads, samorris *r){
+
+  int d = t->npar, no = t->nout, nr = d + 1, i, k, m, o, nb, ok;
+  int *perm, *dir;
+  long row;
+  double *u, *y, *mu, *m2, *mus, delta, ee;
+  rngstate rng;
+
+  if(levels < 2 || levels % 2 != 0){
+    return 2;
+  }
+  delta = levels/(2.0*(levels - 1));
+
+  nthreads = sa_threads(nthreads);
+  u = malloc((size_t)SA_BLOCK*nr*d*sizeof(double));
+  y = malloc((size_t)SA_BLOCK*nr*no*sizeof(double));
+  mu = calloc((size_t)3*no*d, sizeof(double));
+  perm = malloc((size_t)2*SA_BLOCK*d*sizeof(int));
+  if(u == NULL || y == NULL || mu == NULL || perm == NULL){
+    free(u);
+    free(y);
+    free(mu);
+    free(perm);
+    return 1;
+  }
+  m2 = mu + no*d;
+  mus = m2 + no*d;
+  dir = perm + SA_BLOCK*d;
+
+  rng_seed(&rng, seed, 0);
+  r->n = 0;
+  r->nskip = 0;
+  for(row = 0; row < n; row += nb){
+    nb = (n - row < SA_BLOCK) ? (int)(n - row) : SA_BLOCK;
+
+    for(i = 0; i < nb; i++){
+      double *x = u + (size_t)i*nr*d;
+      int *pi = perm + i*d, *di = dir + i*d;
+      // Base point on the grid and directions, the start is the upper end
+      // for parameters that move down
+      for(k = 0; k < d; k++){
+        x[k] = floor(rng_unif(&rng)*(levels/2))/(levels - 1);
+        di[k] = (rng_unif(&rng) < 0.5) ? -1 : 1;
+        if(di[k] < 0){
+          x[k] += delta;
+        }
+        pi[k] = k;
+      }
+      // Random order (Fisher-Yates)
+      for(k = d - 1; k > 0; k--){
+        m = (int)(rng_unif(&rng)*(k + 1));
+        o = pi[k]; pi[k] = pi[m]; pi[m] = o;
+      }
+      for(m = 0; m < d; m++){
+        memcpy(x + (size_t)(m + 1)*d, x + (size_t)m*d, d*sizeof(double));
+        x[(size_t)(m + 1)*d + pi[m]] += di[pi[m]]*delta;
+      }
+    }
+    sa_block(t, nb*nr, u, y, nthreads);
+
+    for(i = 0; i < nb; i++){
+      const double *yi = y + (size_t)i*nr*no;
+      const int *pi = perm + i*d, *di = dir + i*d;
+      for(m = 0, ok = 1; m < nr*no; m++){
+        ok = ok && isfinite(yi[m]);
+      }
+      if(!ok){
+        r->nskip++;
+        continue;
+      }
+      r->n++;
+      for(m = 0; m < d; m++){
+        k = pi[m];
+        for(o = 0; o < no; o++){
+          ee = (yi[(m + 1)*no + o] - yi[m*no + o])/(di[k]*delta);
+          sa_welford(&mu[o*d + k], &m2[o*d + k], r->n, ee);
+          mus[o*d + k] += (fabs(ee) - mus[o*d + k])/r->n;
+        }
+      }
+    }
+  }
+
+  for(m = 0; m < no*d; m++){
+    r->mu[m] = (r->n > 0) ? mu[m] : NAN;
+    r->mustar[m] = (r->n > 0) ? mus[m] : NAN;
+    r->sigma[m] = (r->n > 1) ? sqrt(m2[m]/(r->n - 1)) : NAN;
+  }
+
+  free(u);
+  free(y);
+  free(mu);
+  free(perm);
+  return 0;
+}
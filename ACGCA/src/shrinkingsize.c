@@ -9,6 +9,8 @@
 
 #include "head_files/shrinkingsize.h"
 #include "head_files/misc_growth_funcs.h"
+#include "head_files/gprofile.h"
+#include "head_files/gtrace.h"
 #include <math.h>
 
 /*! 
@@ -34,18 +36,18 @@
  *
  * \date 12-06-2010
  */
-void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, double *deltaw, double *pnet){
+void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, greal *deltaw, greal *pnet){
 
     bioms bio;
     
     // Before dropping extra tissues have:
-    double nuost=fmaxmacro(0,(p->so*gp->deltat-1.0)*(p->lamdas*st->bts*st->boh-p->lamdah*st->bth*st->bos)/ 
+    greal nuost=fmaxmacro(0,(p->so*gp->deltat-1.0)*(p->lamdas*st->bts*st->boh-p->lamdah*st->bth*st->bos)/ 
                   (st->bos*(p->lamdah*st->bth+p->lamdas*(1.0+st->deltas)*st->bts)*gp->deltat)); 
     bio.blst =st->bl-p->sl*st->bl*gp->deltat;
     bio.brst =st->br-p->sr*st->br*gp->deltat;
     bio.bohst=st->boh+gp->deltat*(nuost*(1.0+st->deltas)*st->bos-p->so*st->boh);
     bio.bosst=st->bos-(p->so+nuost)*st->bos*gp->deltat;
-    double csst =st->cs+gp->deltat*(st->ex-st->deltas*(nuost+p->so)*st->bos);
+    greal csst =st->cs+gp->deltat*(st->ex-st->deltas*(nuost+p->so)*st->bos);
     
     // Determine BOS equivalents:
     bio.bosl=bio.blst*p->sla*p->lamdas*st->bts/(p->f2*st->sa);
@@ -67,12 +69,10 @@ void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, double *deltaw, do
       else{
         bio.bosmid=bio.bosr;
       }
-    shrinkingsizeA(p,st,gp,i,deltaw,&bio,&csst,pnet);
-    //printf("ShrinkingSizeA \n");
+    GPROF_CALL(GP_shrinkingsizeA, shrinkingsizeA(p,st,gp,i,deltaw,&bio,&csst,pnet));
   }
   else if ((csst+p->deltal*bio.blst+p->deltar*bio.brst)>0.0){
-    shrinkingsizeB(p,st,gp,i,deltaw,&bio,&csst,pnet);
-    //printf("ShrinkingSizeB \n");
+    GPROF_CALL(GP_shrinkingsizeB, shrinkingsizeB(p,st,gp,i,deltaw,&bio,&csst,pnet));
   }
   else { // tree dies   
     st->status=0;
@@ -106,11 +106,11 @@ void shrinkingsize(sparms *p, gparms *gp, tstates *st, int i, double *deltaw, do
  * \date 12-07-2010
  */
 void shrinkingsizeA(sparms *p, tstates *st, gparms *gp, int i,
-                    double *deltaw, bioms *bio, double *csst,
-                    double *pnet){
+                    greal *deltaw, bioms *bio, greal *csst,
+                    greal *pnet){
 
   //local variables
-  double eo=0,el=0,er=0,sigr=0,sigl=0,sigo=0,nuoht=0,denom;
+  greal eo=0,el=0,er=0,sigr=0,sigl=0,sigo=0,nuoht=0,denom;
   nuoht = 0 * nuoht; //This does nothing but removes an error;
   sigo = 0 * sigo; //This does nothing but removes an error;
   
@@ -385,11 +385,11 @@ void shrinkingsizeA(sparms *p, tstates *st, gparms *gp, int i,
 /// \date 12-07-2010
 ///
 void shrinkingsizeB(sparms *p, tstates *st, gparms *gp, int i,  
-                    double *deltaw, bioms *bio, double *csst, 
-                    double *pnet){
+                    greal *deltaw, bioms *bio, greal *csst, 
+                    greal *pnet){
 
   // set all "excess" senescence at zero.
-  double eo=0,el=0,er=0,ce,sigr=0,sigl=0,Al,Ar,denom, new_bl, new_br; // removed ,nuoht=0 on 2/20/18
+  greal eo=0,el=0,er=0,ce,sigr=0,sigl=0,Al,Ar,denom, new_bl, new_br; // removed ,nuoht=0 on 2/20/18
  
   // if-else block
   if (bio->bosr > bio->bosl){
@@ -440,7 +440,7 @@ void shrinkingsizeB(sparms *p, tstates *st, gparms *gp, int i,
   // Now need to determine BOS.
   st->bos=new_bl*p->sla*p->lamdas*st->bts/(p->f2*st->sa);  // bos that matches new_bl; bos if need to drop bos.
  
-  double nuoht=0.0;
+  greal nuoht=0.0;
   nuoht = 0*nuoht; //This does nothing but removes an error;
   
   //eo=0.0;
@@ -480,7 +480,6 @@ void shrinkingsizeB(sparms *p, tstates *st, gparms *gp, int i,
 
     // Allocation fractions.
     denom=er+el+eo;
-    //printf("denom=%g \n",denom);
     st->ft=0.0;
     if(denom==0.0){
       st->fr=0.0;
@@ -502,7 +501,7 @@ void shrinkingsizeB(sparms *p, tstates *st, gparms *gp, int i,
   // - net photsynthetic input (Pg - Rm):
   st->rfs = fminmacro(st->cs,denom*gp->deltat - st->rfl - st->rfr - (*pnet)*gp->deltat);
   if (st->cs < (denom*gp->deltat - st->rfl - st->rfr - (*pnet)*gp->deltat)){
-    //printf("retranslocation does not balance \n");
+    GTRACE(GT_fault, 151, st->r, st->h, st->ex);
   }
 
   st->bl=new_bl;
@@ -0,0 +1,494 @@
+/// \file simcache.c
+/// \brief Content addressed cache of simulation results.  Identical calls
+/// of runacgca() (same species parameters, light, forcing and settings)
+/// are answered from the cache instead of being simulated again.
+///
+/// The key is a 128 bit hash of the packed species parameters, r0, the
+/// simulation settings, the forcing vectors and the model version
+/// (SIMCACHE_MODEL).  Results are kept in memory with least recently used
+/// eviction within a byte budget and, if a directory is set, also written
+/// to one file per key:
+///   char magic[8]        "ACGCASC"
+///   int  hdr[8]          version, byte order marker, lenvars, t,
+///                        GF_NDOUBLE, GI_NINT, 0, 0
+///   uint64_t key[2]
+///   double column[GF_NDOUBLE][lenvars]
+///   int    column[GI_NINT][lenvars]
+/// Files are written under a temporary name and renamed so a partly
+/// written file is never read, and are memory mapped when read where
+/// available.  Files on disk are never evicted.
+///
+/// The cache is only used from the R main thread (Rgrowthloop()) and is
+/// not thread safe.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/simcache.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char scmagic[8] = "ACGCASC";
+static const int scendian = 0x01020304;
+
+// Bytes of the header of a cache file.
+#define SC_HDRSIZE (8 + 8*sizeof(int) + 2*sizeof(uint64_t))
+
+// Number of hash buckets of the in memory table (a power of 2).
+#define SC_NBUCKET 4096
+
+// An entry in memory, followed by its columns.
+typedef struct scentry{
+	simkey key;
+	int lenvars;
+	int t;
+	long long bytes;
+	struct scentry *prev, *next; // least recently used list, head is newest
+	struct scentry *chain;       // next entry in the same bucket
+} scentry;
+
+static scentry *scbucket[SC_NBUCKET];
+static scentry *schead = NULL, *sctail = NULL;
+static simstats scstats = {0, 0, 0, 0, 0, 0, SIMCACHE_DEFSIZE};
+static char *scdir = NULL;
+
+///////////////////////////////////////////////////////////////////////////////
+// Hashing
+///////////////////////////////////////////////////////////////////////////////
+
+// Finalizer of MurmurHash3.
+static uint64_t sc_fmix(uint64_t h){
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Mixes one 64 bit word into both halves of the key.
+static void sc_word(simkey *k, uint64_t w){
+	k->h[0] = sc_fmix((k->h[0] ^ w) * 0x9e3779b97f4a7c15ULL);
+	k->h[1] = sc_fmix((k->h[1] + ((w << 31) | (w >> 33))) * 0x87c37b91114253d5ULL);
+}
+
+// Hashes n doubles by their bit patterns, preceded by n.
+static void sc_doubles(simkey *k, const double *x, long n){
+	uint64_t w;
+
+	sc_word(k, (uint64_t)n);
+	for (long i = 0; i < n; i++){
+		memcpy(&w, &x[i], sizeof(uint64_t));
+		sc_word(k, w);
+	}
+}
+
+static void sc_ints(simkey *k, const int *x, long n){
+	sc_word(k, (uint64_t)n);
+	for (long i = 0; i < n; i++){
+		sc_word(k, (uint64_t)(uint32_t)x[i]);
+	}
+}
+
+/// simcache_key() returns the key of a call of Rgrowthloop() with these
+/// inputs (see Rgrowthloop.c).  gp2 holds deltat, T, tolerance and BH, the
+/// forcing vectors have lenvars values.
+simkey simcache_key(const double *gp2, const double *r0, int lenvars,
+	const double *Io, const double *Hc, const double *LAIF, const double *kF,
+	const double *intF, const double *slopeF, const double *sparms2,
+	const int *startIndex, const int *parameterLength){
+
+	simkey k = {{0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL}};
+	const char *model = SIMCACHE_MODEL;
+	long nsp = 0;
+	int i;
+
+	for (i = 0; model[i] != '\0'; i++){
+		sc_word(&k, (uint64_t)(unsigned char)model[i]);
+	}
+	sc_doubles(&k, gp2, 4);
+	sc_doubles(&k, r0, 1);
+	sc_doubles(&k, Io, lenvars);
+	sc_doubles(&k, Hc, lenvars);
+	sc_doubles(&k, LAIF, lenvars);
+	sc_doubles(&k, kF, 1);
+	sc_doubles(&k, intF, 1);
+	sc_doubles(&k, slopeF, 1);
+	for (i = 0; i < NSPARMS; i++){
+		if (startIndex[i] + parameterLength[i] > nsp){
+			nsp = startIndex[i] + parameterLength[i];
+		}
+	}
+	sc_ints(&k, startIndex, NSPARMS);
+	sc_ints(&k, parameterLength, NSPARMS);
+	sc_doubles(&k, sparms2, nsp);
+	return k;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Entries in memory
+///////////////////////////////////////////////////////////////////////////////
+
+static long long sc_datasize(int lenvars){
+	return (long long)lenvars*(GF_NDOUBLE*sizeof(double) + GI_NINT*sizeof(int));
+}
+
+static int sc_complete(goutput *out){
+	int k;
+
+	for (k = 0; k < GF_NDOUBLE; k++){
+		if (out->v[k] == NULL){
+			return 0;
+		}
+	}
+	for (k = 0; k < GI_NINT; k++){
+		if (out->iv[k] == NULL){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Copies the columns of out to data and back.
+static void sc_pack(char *data, int lenvars, goutput *out){
+	size_t dlen = lenvars*sizeof(double), ilen = lenvars*sizeof(int);
+	int k;
+
+	for (k = 0; k < GF_NDOUBLE; k++, data += dlen){
+		memcpy(data, out->v[k], dlen);
+	}
+	for (k = 0; k < GI_NINT; k++, data += ilen){
+		memcpy(data, out->iv[k], ilen);
+	}
+}
+
+static void sc_unpack(const char *data, int lenvars, goutput *out){
+	size_t dlen = lenvars*sizeof(double), ilen = lenvars*sizeof(int);
+	int k;
+
+	for (k = 0; k < GF_NDOUBLE; k++, data += dlen){
+		if (out->v[k] != NULL){
+			memcpy(out->v[k], data, dlen);
+		}
+	}
+	for (k = 0; k < GI_NINT; k++, data += ilen){
+		if (out->iv[k] != NULL){
+			memcpy(out->iv[k], data, ilen);
+		}
+	}
+}
+
+static char *sc_data(scentry *e){
+	return (char *)e + sizeof(scentry);
+}
+
+static void sc_unlink(scentry *e){
+	if (e->prev != NULL){
+		e->prev->next = e->next;
+	}else{
+		schead = e->next;
+	}
+	if (e->next != NULL){
+		e->next->prev = e->prev;
+	}else{
+		sctail = e->prev;
+	}
+	e->prev = e->next = NULL;
+}
+
+static void sc_pushfront(scentry *e){
+	e->prev = NULL;
+	e->next = schead;
+	if (schead != NULL){
+		schead->prev = e;
+	}
+	schead = e;
+	if (sctail == NULL){
+		sctail = e;
+	}
+}
+
+static scentry *sc_find(const simkey *key){
+	scentry *e;
+
+	for (e = scbucket[key->h[0] & (SC_NBUCKET - 1)]; e != NULL; e = e->chain){
+		if (e->key.h[0] == key->h[0] && e->key.h[1] == key->h[1]){
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void sc_remove(scentry *e){
+	scentry **pp = &scbucket[e->key.h[0] & (SC_NBUCKET - 1)];
+
+	while (*pp != e){
+		pp = &(*pp)->chain;
+	}
+	*pp = e->chain;
+	sc_unlink(e);
+	scstats.entries--;
+	scstats.bytes -= e->bytes;
+	free(e);
+}
+
+// Drops the least recently used entries until the cache is within budget.
+static void sc_trim(void){
+	while (sctail != NULL && scstats.bytes > scstats.maxbytes){
+		sc_remove(sctail);
+		scstats.evictions++;
+	}
+}
+
+// Adds the columns in data to memory (if they fit in the budget).
+static void sc_insert(const simkey *key, int lenvars, int t, const char *data){
+	long long bytes = (long long)sizeof(scentry) + sc_datasize(lenvars);
+	scentry *e;
+
+	if (bytes > scstats.maxbytes || sc_find(key) != NULL){
+		return;
+	}
+	e = malloc(bytes);
+	if (e == NULL){
+		return;
+	}
+	e->key = *key;
+	e->lenvars = lenvars;
+	e->t = t;
+	e->bytes = bytes;
+	memcpy(sc_data(e), data, sc_datasize(lenvars));
+	e->chain = scbucket[key->h[0] & (SC_NBUCKET - 1)];
+	scbucket[key->h[0] & (SC_NBUCKET - 1)] = e;
+	sc_pushfront(e);
+	scstats.entries++;
+	scstats.bytes += bytes;
+	sc_trim();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Files on disk
+///////////////////////////////////////////////////////////////////////////////
+
+// Name of the file of key in the cache directory (the caller frees it).
+static char *sc_path(const simkey *key, const char *suffix){
+	size_t len = strlen(scdir) + 32 + 16 + strlen(suffix);
+	char *path = malloc(len);
+
+	if (path != NULL){
+		snprintf(path, len, "%s/%016llx%016llx.acgc%s", scdir,
+			(unsigned long long)key->h[0], (unsigned long long)key->h[1], suffix);
+	}
+	return path;
+}
+
+static void sc_header(char *hdr, const simkey *key, int lenvars, int t){
+	int h[8] = {SIMCACHE_VERSION, scendian, lenvars, t, GF_NDOUBLE, GI_NINT, 0, 0};
+
+	memcpy(hdr, scmagic, 8);
+	memcpy(hdr + 8, h, sizeof(h));
+	memcpy(hdr + 8 + sizeof(h), key->h, 2*sizeof(uint64_t));
+}
+
+// Checks the header of a cache file and returns the stored t (-1 if the
+// file does not belong to key or has another layout).
+static int sc_checkheader(const char *hdr, const simkey *key, int lenvars){
+	int h[8];
+	uint64_t k[2];
+
+	memcpy(h, hdr + 8, sizeof(h));
+	memcpy(k, hdr + 8 + sizeof(h), sizeof(k));
+	if (memcmp(hdr, scmagic, 8) != 0 || h[0] != SIMCACHE_VERSION ||
+		h[1] != scendian || h[2] != lenvars || h[4] != GF_NDOUBLE ||
+		h[5] != GI_NINT || k[0] != key->h[0] || k[1] != key->h[1]){
+		return -1;
+	}
+	return h[3];
+}
+
+// Reads the entry of key from disk into out and memory.  Returns 0 if
+// found.
+static int sc_read(const simkey *key, int lenvars, goutput *out, int *t){
+	long long len = SC_HDRSIZE + sc_datasize(lenvars);
+	char *path, *buf = NULL;
+	FILE *fp;
+	int tk = -1, mapped = 0;
+
+	path = sc_path(key, "");
+	if (path == NULL){
+		return 1;
+	}
+	fp = fopen(path, "rb");
+	free(path);
+	if (fp == NULL){
+		return 1;
+	}
+
+#if !defined(_WIN32)
+	struct stat st;
+	if (fstat(fileno(fp), &st) == 0 && (long long)st.st_size == len){
+		buf = mmap(NULL, len, PROT_READ, MAP_SHARED, fileno(fp), 0);
+		if (buf == MAP_FAILED){
+			buf = NULL;
+		}else{
+			mapped = 1;
+		}
+	}
+#endif
+	if (buf == NULL){
+		buf = malloc(len);
+		if (buf != NULL && fread(buf, 1, len, fp) != (size_t)len){
+			free(buf);
+			buf = NULL;
+		}
+	}
+	fclose(fp);
+	if (buf == NULL){
+		return 1;
+	}
+
+	tk = sc_checkheader(buf, key, lenvars);
+	if (tk >= 0){
+		*t = tk;
+		sc_unpack(buf + SC_HDRSIZE, lenvars, out);
+		sc_insert(key, lenvars, tk, buf + SC_HDRSIZE);
+	}
+
+#if !defined(_WIN32)
+	if (mapped){
+		munmap(buf, len);
+		buf = NULL;
+	}
+#endif
+	free(buf);
+	return (tk >= 0) ? 0 : 1;
+}
+
+// Writes the entry of key to disk.  Failures are ignored, the entry is
+// then simply not cached on disk.
+static void sc_write(const simkey *key, int lenvars, int t, const char *data){
+	char hdr[SC_HDRSIZE], *path, *tmp;
+	FILE *fp;
+	int ok;
+
+	path = sc_path(key, "");
+	tmp = sc_path(key, ".tmp");
+	if (path == NULL || tmp == NULL){
+		free(path);
+		free(tmp);
+		return;
+	}
+	fp = fopen(tmp, "wb");
+	if (fp != NULL){
+		sc_header(hdr, key, lenvars, t);
+		ok = fwrite(hdr, 1, SC_HDRSIZE, fp) == SC_HDRSIZE &&
+			fwrite(data, 1, sc_datasize(lenvars), fp) == (size_t)sc_datasize(lenvars);
+		ok = (fclose(fp) == 0) && ok;
+		if (!ok || rename(tmp, path) != 0){
+			remove(tmp);
+		}
+	}
+	free(path);
+	free(tmp);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Interface
+///////////////////////////////////////////////////////////////////////////////
+
+/// simcache_get() looks key up in memory and then on disk and copies the
+/// cached outputs to the non NULL columns of out and the last step to t.
+///
+/// Returns 0 if found in memory, 1 if found on disk and -1 if not found.
+int simcache_get(const simkey *key, int lenvars, goutput *out, int *t){
+	scentry *e = sc_find(key);
+
+	if (e != NULL && e->lenvars == lenvars){
+		sc_unlink(e);
+		sc_pushfront(e);
+		*t = e->t;
+		sc_unpack(sc_data(e), lenvars, out);
+		scstats.hits++;
+		return 0;
+	}
+	if (scdir != NULL && sc_read(key, lenvars, out, t) == 0){
+		scstats.dhits++;
+		return 1;
+	}
+	scstats.misses++;
+	return -1;
+}
+
+/// simcache_put() adds the outputs of a run (all columns of out have to be
+/// set) with last step t to memory and, if a directory is set, to disk.
+void simcache_put(const simkey *key, int lenvars, int t, goutput *out){
+	char *data;
+
+	if (!sc_complete(out)){
+		return;
+	}
+	data = malloc(sc_datasize(lenvars));
+	if (data == NULL){
+		return;
+	}
+	sc_pack(data, lenvars, out);
+	sc_insert(key, lenvars, t, data);
+	if (scdir != NULL){
+		sc_write(key, lenvars, t, data);
+	}
+	free(data);
+}
+
+/// simcache_config() sets the memory budget (maxbytes < 0 keeps it, 0
+/// disables the cache in memory) and the directory of the cache on disk
+/// (NULL keeps it, "" disables the cache on disk).
+///
+/// Returns 0 on success and 1 if the directory could not be used.
+int simcache_config(long long maxbytes, const char *dir){
+	if (maxbytes >= 0){
+		scstats.maxbytes = maxbytes;
+		sc_trim();
+	}
+	if (dir != NULL){
+		free(scdir);
+		scdir = NULL;
+		if (dir[0] != '\0'){
+#if !defined(_WIN32)
+			struct stat st;
+			if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)){
+				return 1;
+			}
+#endif
+			scdir = malloc(strlen(dir) + 1);
+			if (scdir == NULL){
+				return 1;
+			}
+			strcpy(scdir, dir);
+		}
+	}
+	return 0;
+}
+
+/// simcache_clear() drops all entries in memory and resets the counters.
+/// Files on disk are kept.
+void simcache_clear(void){
+	while (schead != NULL){
+		sc_remove(schead);
+	}
+	scstats.hits = scstats.dhits = scstats.misses = scstats.evictions = 0;
+}
+
+/// simcache_stats() returns the counters of the cache.
+void simcache_stats(simstats *s){
+	*s = scstats;
+}
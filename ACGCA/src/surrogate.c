@@ -0,0 +1,452 @@
+/// \file surrogate.c
+/// \brief Emulates yearly DBH and survival of the model over a box of
+/// species parameters with a polynomial chaos expansion (Legendre
+/// polynomials of the position of each parameter in its range, up to a
+/// total degree), so they can be predicted in microseconds instead of
+/// simulated.
+///
+/// sg_train() runs the points of a Sobol design (explore.c) in parallel
+/// blocks and fits the coefficients of all outputs at once by least squares
+/// (Householder QR).  The leave one out error of each output comes from the
+/// hat matrix without refitting (Blatman and Sudret 2010).  sg_predict()
+/// evaluates the expansion and runs the model instead for points outside
+/// the box.  Survival is emulated as the 0/1 indicator, its prediction is
+/// clipped to [0, 1] and read as a probability.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/explore.h"
+#include "head_files/surrogate.h"
+
+/// Points simulated per block.
+#define SG_BLOCK 256
+
+/// sg_nbasis() returns the number of polynomials of total degree at most
+/// deg in npar variables, choose(npar + deg, deg).
+int sg_nbasis(int npar, int deg){
+  double c = 1;
+  int k;
+
+  for(k = 1; k <= deg; k++){
+    c = c*(npar + k)/k;
+  }
+  return (int)(c + 0.5);
+}
+
+/// sg_multiindex() returns the degrees alpha[b*npar + k] of the polynomials
+/// in graded order (the constant first, then degree 1, ...).
+void sg_multiindex(int npar, int deg, int *alpha){
+  int a[NSPARMS], b = 0, d, k, rest;
+
+  for(d = 0; d <= deg; d++){
+    // All a with sum d, last variable fastest
+    memset(a, 0, sizeof(a));
+    a[0] = d;
+    while(1){
+      memcpy(alpha + (size_t)b*npar, a, npar*sizeof(int));
+      b++;
+      // Next composition of d: move one unit from the last nonzero entry
+      // before the end to its right neighbour and collect the tail there
+      for(k = npar - 2; k >= 0 && a[k] == 0; k--);
+      if(k < 0){
+        break;
+      }
+      rest = a[npar - 1];
+      a[npar - 1] = 0;
+      a[k]--;
+      a[k + 1] = rest + 1;
+    }
+  }
+}
+
+// Position in [-1, 1] of parameter value x in the range lo to hi on the
+// given scale (inverse of ex_scale() in explore.c).
+static double sg_xi(int scale, double lo, double hi, double x){
+  double a, b;
+
+  switch(scale){
+  case EX_LOG:
+    return 2*(log(x) - log(lo))/(log(hi) - log(lo)) - 1;
+  case EX_LOGIT:
+    a = log(lo/(1 - lo));
+    b = log(hi/(1 - hi));
+    return 2*(log(x/(1 - x)) - a)/(b - a) - 1;
+  default:
+    return 2*(x - lo)/(hi - lo) - 1;
+  }
+}
+
+// Values of the nbasis polynomials at xi (npar values) into phi.
+static void sg_basis(const sgmodel *m, const double *xi, double *phi){
+  double L[NSPARMS][SG_MAXDEG + 1];
+  int b, d, k;
+
+  // Orthonormal Legendre polynomials for the uniform density on [-1, 1]
+  for(k = 0; k < m->npar; k++){
+    double p0 = 1, p1 = xi[k], p2;
+    L[k][0] = 1;
+    for(d = 1; d <= m->deg; d++){
+      L[k][d] = sqrt(2.0*d + 1)*p1;
+      p2 = ((2.0*d + 1)*xi[k]*p1 - d*p0)/(d + 1);
+      p0 = p1;
+      p1 = p2;
+    }
+  }
+  for(b = 0; b < m->nbasis; b++){
+    const int *a = m->alpha + (size_t)b*m->npar;
+    phi[b] = 1;
+    for(k = 0; k < m->npar; k++){
+      if(a[k] > 0){
+        phi[b] *= L[k][a[k]];
+      }
+    }
+  }
+}
+
+/// sg_sim() simulates the tree with the varied parameters x (values, not
+/// positions) and returns in y the DBH (2*rBH) and alive (1 or 0) every
+/// every steps, DBH first.  rbh holds nsteps + 1 values.  Returns the steps
+/// taken.
+int sg_sim(const extarget *t, int every, const double *x, double *rbh,
+  double *y){
+  sparms p = t->p;
+  gparms gp = t->gp;
+  gforcing f = t->f;
+  gcheckpoint ck;
+  goutput out;
+  double r0 = t->r0;
+  int j, k, n, dead, ny = t->nsteps/every + 1;
+
+  for(k = 0; k < t->npar; k++){
+    sparms_set(&p, t->park[k], x[k], 0);
+  }
+
+  memset(&out, 0, sizeof(goutput));
+  memset(rbh, 0, (t->nsteps + 1)*sizeof(double));
+  out.v[GF_rBH] = rbh;
+  growthloop_init(&p, &gp, &r0, &ck);
+  growthloop_store(&ck, &gp, &out, 0);
+  n = growthloop_run(&gp, &ck, t->ps, &f, &out, t->nsteps);
+  dead = (ck.st.status == 0);
+
+  // Outputs are 0 from the step the tree died
+  for(k = 0; k < ny; k++){
+    j = k*every;
+    y[ny + k] = (!dead || j < n) ? 1 : 0;
+    y[k] = y[ny + k]*2*rbh[j];
+  }
+  return n;
+}
+
+static int sg_threads(int nthreads){
+#ifdef _OPENMP
+  return (nthreads > 0) ? nthreads : omp_get_max_threads();
+#else
+  (void)nthreads;
+  return 1;
+#endif
+}
+
+// Householder QR of the n x p matrix A (column major, n >= p) applied to
+// the n x q right hand sides Y.  On return the upper triangle of A holds R
+// and the first p rows of Y hold Q'Y.  Returns 1 if A is rank deficient.
+static int sg_qr(double *A, int n, int p, double *Y, int q){
+  int i, j, k;
+  double norm, s, alpha, *a;
+
+  for(k = 0; k < p; k++){
+    a = A + (size_t)k*n;
+    for(norm = 0, i = k; i < n; i++){
+      norm += a[i]*a[i];
+    }
+    norm = sqrt(norm);
+    if(norm == 0){
+      return 1;
+    }
+    alpha = (a[k] > 0) ? -norm : norm;
+    // v = a[k:] - alpha e_k, stored in place, with v'v = 2 norm (norm + |a[k]|)
+    a[k] -= alpha;
+    s = norm*(norm + fabs(a[k] + alpha));
+    for(j = k + 1; j < p; j++){
+      double *c = A + (size_t)j*n, dot = 0;
+      for(i = k; i < n; i++){
+        dot += a[i]*c[i];
+      }
+      dot /= s;
+      for(i = k; i < n; i++){
+        c[i] -= dot*a[i];
+      }
+    }
+    for(j = 0; j < q; j++){
+      double *c = Y + (size_t)j*n, dot = 0;
+      for(i = k; i < n; i++){
+        dot += a[i]*c[i];
+      }
+      dot /= s;
+      for(i = k; i < n; i++){
+        c[i] -= dot*a[i];
+      }
+    }
+    // R on the diagonal, the Householder vector is not needed below it
+    a[k] = alpha;
+  }
+  for(k = 0; k < p; k++){
+    if(fabs(A[(size_t)k*n + k]) < 1e-10*fabs(A[0])){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Solves R'z = b in place (R upper triangular in the first p rows of A).
+static void sg_rtsolve(const double *A, int n, int p, double *b){
+  int i, k;
+
+  for(k = 0; k < p; k++){
+    for(i = 0; i < k; i++){
+      b[k] -= A[(size_t)k*n + i]*b[i];
+    }
+    b[k] /= A[(size_t)k*n + k];
+  }
+}
+
+/// sg_train() fits an emulator (npar, deg, nbasis, nout and alpha set in
+/// m, coef allocated) from the first n points of a Sobol design over the
+/// ranges of t.  loo returns the leave one out mean squared error of each
+/// output divided by its variance (NaN for outputs that do not vary).
+/// Returns 1 if memory could not be allocated, 3 for an invalid design and
+/// 4 if n is too small for the number of polynomials or the fit is
+/// singular.
+int sg_train(const extarget *t, int every, long long n, uint64_t seed,
+  int nthreads, sgmodel *m, double *loo){
+
+  exdesign d;
+  int nb = m->nbasis, no = m->nout, np = t->npar, i, k, o, nr, err = 0;
+  long long row;
+  double *A, *Y, *Y0, *u, *x, *rbh, *yb, *z, *mean, *m2, *press;
+
+  if(no != 2*(t->nsteps/every + 1) || ex_design(&d, EX_SOBOL, n, seed, np)){
+    return 3;
+  }
+  if(n <= nb || n > 0x7fffffffLL){
+    return 4;
+  }
+
+  nthreads = sg_threads(nthreads);
+  A = malloc((size_t)n*nb*sizeof(double));
+  Y = malloc((size_t)2*n*no*sizeof(double));
+  u = malloc((size_t)SG_BLOCK*np*sizeof(double));
+  x = malloc((size_t)SG_BLOCK*np*sizeof(double));
+  rbh = malloc((size_t)SG_BLOCK*(t->nsteps + 1)*sizeof(double));
+  yb = malloc((size_t)SG_BLOCK*no*sizeof(double));
+  z = calloc((size_t)nb + 3*no, sizeof(double));
+  if(A == NULL || Y == NULL || u == NULL || x == NULL || rbh == NULL ||
+    yb == NULL || z == NULL){
+    err = 1;
+    goto done;
+  }
+  Y0 = Y + (size_t)n*no;
+  mean = z + nb;
+  m2 = mean + no;
+  press = m2 + no;
+
+  // Simulations, the basis of point i in row i of A and output o in Y[o*n + i]
+  for(row = 0; row < n; row += nr){
+    nr = (n - row < SG_BLOCK) ? (int)(n - row) : SG_BLOCK;
+    for(i = 0; i < nr; i++){
+      double *ui = u + (size_t)i*np, xi[NSPARMS];
+      ex_point(&d, row + i, ui);
+      for(k = 0; k < np; k++){
+        x[(size_t)i*np + k] = ex_scale(t->scale[k], t->lo[k], t->hi[k], ui[k]);
+        xi[k] = 2*ui[k] - 1;
+      }
+      sg_basis(m, xi, z);
+      for(k = 0; k < nb; k++){
+        A[(size_t)k*n + row + i] = z[k];
+      }
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for(i = 0; i < nr; i++){
+      sg_sim(t, every, x + (size_t)i*np, rbh + (size_t)i*(t->nsteps + 1),
+        yb + (size_t)i*no);
+    }
+    for(i = 0; i < nr; i++){
+      for(o = 0; o < no; o++){
+        Y[(size_t)o*n + row + i] = yb[(size_t)i*no + o];
+      }
+    }
+  }
+  memcpy(Y0, Y, (size_t)n*no*sizeof(double));
+
+  // Least squares fit of all outputs, the coefficients solve R c = Q'y
+  if(sg_qr(A, (int)n, nb, Y, no)){
+    err = 4;
+    goto done;
+  }
+  for(o = 0; o < no; o++){
+    double *c = Y + (size_t)o*n;
+    for(k = nb - 1; k >= 0; k--){
+      for(i = k + 1; i < nb; i++){
+        c[k] -= A[(size_t)i*n + k]*c[i];
+      }
+      c[k] /= A[(size_t)k*n + k];
+      m->coef[(size_t)k*no + o] = c[k];
+    }
+  }
+
+  // Leave one out residuals e_i/(1 - h_i) with the leverage h_i =
+  // |R^-T phi_i|^2.  The basis of point i is recomputed since A now holds
+  // the factorization.
+  for(row = 0; row < n; row++){
+    double xi[NSPARMS], h = 0, fit, e;
+    ex_point(&d, row, u);
+    for(k = 0; k < np; k++){
+      xi[k] = 2*u[k] - 1;
+    }
+    sg_basis(m, xi, z);
+    for(o = 0; o < no; o++){
+      for(fit = 0, k = 0; k < nb; k++){
+        fit += z[k]*m->coef[(size_t)k*no + o];
+      }
+      yb[o] = fit;
+    }
+    sg_rtsolve(A, (int)n, nb, z);
+    for(k = 0; k < nb; k++){
+      h += z[k]*z[k];
+    }
+    for(o = 0; o < no; o++){
+      double y = Y0[(size_t)o*n + row], dy = y - mean[o];
+      e = (y - yb[o])/(1 - h);
+      press[o] += e*e;
+      mean[o] += dy/(row + 1);
+      m2[o] += dy*(y - mean[o]);
+    }
+  }
+  for(o = 0; o < no; o++){
+    loo[o] = (m2[o] > 0) ? press[o]/m2[o] : NAN;
+  }
+
+done:
+  free(A);
+  free(Y);
+  free(u);
+  free(x);
+  free(rbh);
+  free(yb);
+  free(z);
+  return err;
+}
+
+/// sg_predict() returns the outputs of the nx points x[i*npar + k]
+/// (parameter values) in y[i*nout + o].  Points outside the ranges of the
+/// emulator are simulated if fallback is 1 (sim[i] = 1) and extrapolated
+/// if it is 0, all points are simulated if it is 2.  Predicted survival is
+/// clipped to [0, 1] and DBH to >= 0.
+/// Returns 1 if memory could not be allocated.
+int sg_predict(const extarget *t, int every, const sgmodel *m,
+  long long nx, const double *x, int fallback, int nthreads, double *y,
+  int *sim){
+
+  int np = m->npar, no = m->nout, ny = no/2;
+  long long i;
+  double *phi, *rbh;
+
+  nthreads = sg_threads(nthreads);
+  phi = malloc((size_t)nthreads*m->nbasis*sizeof(double));
+  rbh = malloc((size_t)nthreads*(t->nsteps + 1)*sizeof(double));
+  if(phi == NULL || rbh == NULL){
+    free(phi);
+    free(rbh);
+    return 1;
+  }
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 64) num_threads(nthreads)
+#endif
+  for(i = 0; i < nx; i++){
+    const double *xi = x + (size_t)i*np;
+    double *yi = y + (size_t)i*no, pos[NSPARMS], *ph;
+    int k, o, b, inside = 1, th = 0;
+#ifdef _OPENMP
+    th = omp_get_thread_num();
+#endif
+    ph = phi + (size_t)th*m->nbasis;
+
+    for(k = 0; k < np; k++){
+      pos[k] = sg_xi(t->scale[k], t->lo[k], t->hi[k], xi[k]);
+      // NaN positions (e.g., log of a negative value) are outside
+      inside = inside && (pos[k] >= -1 && pos[k] <= 1);
+    }
+    sim[i] = (fallback == 2 || (!inside && fallback == 1));
+    if(sim[i]){
+      sg_sim(t, every, xi, rbh + (size_t)th*(t->nsteps + 1), yi);
+      continue;
+    }
+    sg_basis(m, pos, ph);
+    for(o = 0; o < no; o++){
+      yi[o] = 0;
+      for(b = 0; b < m->nbasis; b++){
+        yi[o] += ph[b]*m->coef[(size_t)b*no + o];
+      }
+      if(o >= ny){
+        yi[o] = (yi[o] < 0) ? 0 : ((yi[o] > 1) ? 1 : yi[o]);
+      }else if(yi[o] < 0){
+        yi[o] = 0;
+      }
+    }
+  }
+
+  free(phi);
+  free(rbh);
+  return 0;
+}
+
+/// sg_validate() predicts and simulates the nval points of the Sobol design
+/// that follow the n training points, into ypred and ytrue [nval*nout].
+/// Returns 1 if memory could not be allocated and 3 for an invalid design.
+int sg_validate(const extarget *t, int every, const sgmodel *m, long long n,
+  long long nval, uint64_t seed, int nthreads, double *ypred, double *ytrue){
+
+  exdesign d;
+  long long i;
+  int k, err, *sim;
+  double *x;
+
+  if(ex_design(&d, EX_SOBOL, n + nval, seed, t->npar)){
+    return 3;
+  }
+  x = malloc((size_t)nval*t->npar*sizeof(double));
+  sim = malloc((size_t)nval*sizeof(int));
+  if(x == NULL || sim == NULL){
+    free(x);
+    free(sim);
+    return 1;
+  }
+  for(i = 0; i < nval; i++){
+    double *xi = x + (size_t)i*t->npar;
+    ex_point(&d, n + i, xi);
+    for(k = 0; k < t->npar; k++){
+      xi[k] = ex_scale(t->scale[k], t->lo[k], t->hi[k], xi[k]);
+    }
+  }
+  err = sg_predict(t, every, m, nval, x, 0, nthreads, ypred, sim);
+  if(err == 0){
+    err = sg_predict(t, every, m, nval, x, 2, nthreads, ytrue, sim);
+  }
+  free(x);
+  free(sim);
+  return err;
+}
@@ -0,0 +1,799 @@
+/// \file acgcasim.c
+/// \brief Command line simulator for the ACGCA model.  Runs single runs or
+/// batches without R and writes CSV or result store output.
+///
+/// Usage: acgcasim config [key=value ...]
+///
+/// The config file holds one "key = value" per line, # starts a comment.
+/// Values given on the command line replace the ones in the file.  See
+/// example.cfg for all keys.  Species parameters use the names of the sparms
+/// lists in R (hmax, phih, ..., rho, ..., K, ...) and may be given as
+/// "@file" to read a time varying parameter with one value per line
+/// (steps*years+1 values).  parmax may be given the same way.
+///
+/// A batch file is a CSV file with a header of parameter names (any species
+/// parameter, r0, parmax or runid) and one run per row.  Runs are spread
+/// over threads with OpenMP.
+///
+/// With recorder = K the inputs of the last K steps of a run are kept and
+/// written to recfile (may hold %d for the run id) if the run fails.  With
+/// replay = file the steps in such a file are run again one by one instead
+/// of simulating, and written as CSV with a column match that is 1 if a
+/// step gave the recorded result.
+///
+/// With profile = TRUE the hardware events of the runs (gperf.h) are
+/// counted and written to the standard error, per branch of the time step
+/// if built with PROFILE=1.
+///
+/// \author Michael Fell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "head_files/misc_growth_funcs.h"
+#include "head_files/growthloop.h"
+#include "head_files/checkpoint.h"
+#include "head_files/flightrec.h"
+#include "head_files/gperf.h"
+#include "head_files/gprofile.h"
+#include "head_files/encoding.h"
+#include "head_files/resultstore.h"
+
+#define MAXLINE 65536
+#define MAXCOLS 64
+
+/// \brief A parameter value, either a constant or a series of len values.
+typedef struct{
+  double *v;
+  int len;
+  int set;
+} cfgval;
+
+/// \brief Everything read from the config file and command line.
+typedef struct{
+  cfgval sp[NSPARMS];     ///< species parameters
+  cfgval parmax;          ///< PARmax
+  double r0;
+  int years, steps;
+  double BH, tolerance;
+  int gapsim, gt, ct, tbg;
+  double kF, HFmax, LAIFmax, intF, slopeF;
+  char output[1024];      ///< output file ("-" for stdout)
+  int format;             ///< 0 csv, 1 result store
+  int encoding;           ///< ENC_* for the result store
+  double errbound;
+  int thin;               ///< keep every steps-th row in csv output
+  int fields[GF_NDOUBLE]; ///< 1 if the field is written
+  int mixed;              ///< 1 to store the outputs of gfield_single as float
+  char batch[1024];       ///< batch file ("" for a single run)
+  char restart[1024];     ///< checkpoint to start from ("" for none)
+  char savestate[1024];   ///< checkpoint to save to, may hold %d for the run id
+  int recorder;           ///< steps kept by the flight recorder (0 for none)
+  char recfile[1024];     ///< replay file of failed runs, may hold %d for the run id
+  char replay[1024];      ///< replay file to run again ("" to simulate)
+  int profile;            ///< 1 to count hardware events
+  int threads;
+  int runid;
+} cfgopts;
+
+static void die(const char *msg, const char *arg){
+  fprintf(stderr, "acgcasim: %s%s%s\n", msg, arg ? " " : "", arg ? arg : "");
+  exit(1);
+}
+
+static char *trim(char *s){
+  char *e;
+  while (isspace((unsigned char)*s)) s++;
+  e = s + strlen(s);
+  while (e > s && isspace((unsigned char)e[-1])) e--;
+  *e = '\0';
+  return s;
+}
+
+static double todouble(const char *s, const char *key){
+  char *end;
+  double v = strtod(s, &end);
+  while (isspace((unsigned char)*end)) end++;
+  if (end == s || *end != '\0'){
+    die("not a number for", key);
+  }
+  return v;
+}
+
+static int tobool(const char *s){
+  return (strcmp(s, "TRUE") == 0 || strcmp(s, "true") == 0 ||
+    strcmp(s, "1") == 0 || strcmp(s, "yes") == 0);
+}
+
+// Reads a series with one value per line.
+static void readseries(const char *file, cfgval *cv){
+  FILE *fp = fopen(file, "r");
+  char line[256];
+  int cap = 1024;
+
+  if (fp == NULL){
+    die("could not open", file);
+  }
+  free(cv->v);
+  cv->v = malloc(cap*sizeof(double));
+  cv->len = 0;
+  while (fgets(line, sizeof(line), fp) != NULL){
+    char *s = trim(line);
+    if (*s == '\0' || *s == '#'){
+      continue;
+    }
+    if (cv->len == cap){
+      cap *= 2;
+      cv->v = realloc(cv->v, cap*sizeof(double));
+    }
+    cv->v[cv->len++] = todouble(s, file);
+  }
+  fclose(fp);
+  cv->set = 1;
+}
+
+static void setval(cfgval *cv, const char *val, const char *key){
+  if (val[0] == '@'){
+    readseries(val + 1, cv);
+    return;
+  }
+  free(cv->v);
+  cv->v = malloc(sizeof(double));
+  cv->v[0] = todouble(val, key);
+  cv->len = 1;
+  cv->set = 1;
+}
+
+// Sets the parameters of the R sparms lists from a built in species.
+static void setspecies(cfgopts *o, const char *name){
+  double v[NSPARMS];
+  int k;
+
+  if (species_parms(name, v) != 0){
+    die("unknown species (use acru or pita):", name);
+  }
+  for (k = 0; k < 32; k++){
+    free(o->sp[k].v);
+    o->sp[k].v = malloc(sizeof(double));
+    o->sp[k].v[0] = v[k];
+    o->sp[k].len = 1;
+    o->sp[k].set = 1;
+  }
+}
+
+static void setfields(cfgopts *o, char *val){
+  char *tok;
+  int k;
+
+  if (strcmp(val, "all") == 0){
+    for (k = 0; k < GF_NDOUBLE; k++) o->fields[k] = 1;
+    return;
+  }
+  for (k = 0; k < GF_NDOUBLE; k++) o->fields[k] = 0;
+  for (tok = strtok(val, ", "); tok != NULL; tok = strtok(NULL, ", ")){
+    for (k = 0; k < GF_NDOUBLE && strcmp(tok, gfield_names[k]) != 0; k++);
+    if (k == GF_NDOUBLE){
+      die("unknown output field", tok);
+    }
+    o->fields[k] = 1;
+  }
+}
+
+// Applies one key = value setting.
+static void setopt(cfgopts *o, char *key, char *val){
+  int k = sparms_index(key);
+
+  if (k >= 0){
+    setval(&o->sp[k], val, key);
+  }
+  else if (strcmp(key, "species") == 0){
+    setspecies(o, val);
+  }
+  else if (strcmp(key, "parmax") == 0) setval(&o->parmax, val, key);
+  else if (strcmp(key, "r0") == 0) o->r0 = todouble(val, key);
+  else if (strcmp(key, "years") == 0) o->years = (int)todouble(val, key);
+  else if (strcmp(key, "steps") == 0) o->steps = (int)todouble(val, key);
+  else if (strcmp(key, "breast.height") == 0) o->BH = todouble(val, key);
+  else if (strcmp(key, "tolerance") == 0) o->tolerance = todouble(val, key);
+  else if (strcmp(key, "gapsim") == 0) o->gapsim = tobool(val);
+  else if (strcmp(key, "gt") == 0) o->gt = (int)todouble(val, key);
+  else if (strcmp(key, "ct") == 0) o->ct = (int)todouble(val, key);
+  else if (strcmp(key, "tbg") == 0) o->tbg = (int)todouble(val, key);
+  else if (strcmp(key, "kF") == 0) o->kF = todouble(val, key);
+  else if (strcmp(key, "HFmax") == 0) o->HFmax = todouble(val, key);
+  else if (strcmp(key, "LAIFmax") == 0) o->LAIFmax = todouble(val, key);
+  else if (strcmp(key, "intF") == 0) o->intF = todouble(val, key);
+  else if (strcmp(key, "slopeF") == 0) o->slopeF = todouble(val, key);
+  else if (strcmp(key, "output") == 0) snprintf(o->output, sizeof(o->output), "%s", val);
+  else if (strcmp(key, "format") == 0){
+    if (strcmp(val, "csv") == 0) o->format = 0;
+    else if (strcmp(val, "store") == 0) o->format = 1;
+    else die("unknown format (use csv or store):", val);
+  }
+  else if (strcmp(key, "storeenc") == 0){
+    if (strcmp(val, "raw") == 0) o->encoding = ENC_RAW;
+    else if (strcmp(val, "exact") == 0) o->encoding = ENC_EXACT;
+    else if (strcmp(val, "quantized") == 0) o->encoding = ENC_QUANT;
+    else die("unknown storeenc (use raw, exact or quantized):", val);
+  }
+  else if (strcmp(key, "errbound") == 0) o->errbound = todouble(val, key);
+  else if (strcmp(key, "precision") == 0){
+    if (strcmp(val, "double") == 0) o->mixed = 0;
+    else if (strcmp(val, "mixed") == 0) o->mixed = 1;
+    else die("unknown precision (use double or mixed):", val);
+  }
+  else if (strcmp(key, "thin") == 0) o->thin = tobool(val);
+  else if (strcmp(key, "fields") == 0) setfields(o, val);
+  else if (strcmp(key, "batch") == 0) snprintf(o->batch, sizeof(o->batch), "%s", val);
+  else if (strcmp(key, "restart") == 0) snprintf(o->restart, sizeof(o->restart), "%s", val);
+  else if (strcmp(key, "savestate") == 0) snprintf(o->savestate, sizeof(o->savestate), "%s", val);
+  else if (strcmp(key, "recorder") == 0) o->recorder = (int)todouble(val, key);
+  else if (strcmp(key, "recfile") == 0) snprintf(o->recfile, sizeof(o->recfile), "%s", val);
+  else if (strcmp(key, "replay") == 0) snprintf(o->replay, sizeof(o->replay), "%s", val);
+  else if (strcmp(key, "profile") == 0) o->profile = tobool(val);
+  else if (strcmp(key, "threads") == 0) o->threads = (int)todouble(val, key);
+  else if (strcmp(key, "runid") == 0) o->runid = (int)todouble(val, key);
+  else die("unknown key", key);
+}
+
+// Splits "key = value" and applies it.  Returns 0 for blank lines.
+static int parseline(cfgopts *o, char *line){
+  char *eq, *hash;
+
+  hash = strchr(line, '#');
+  if (hash != NULL) *hash = '\0';
+  line = trim(line);
+  if (*line == '\0'){
+    return 0;
+  }
+  eq = strchr(line, '=');
+  if (eq == NULL){
+    die("expected key = value, got", line);
+  }
+  *eq = '\0';
+  setopt(o, trim(line), trim(eq + 1));
+  return 1;
+}
+
+static void defaults(cfgopts *o){
+  double v[NSPARMS];
+  int k;
+  memset(o, 0, sizeof(cfgopts));
+  // The defaults of runacgca()
+  o->r0 = 0.05;
+  o->years = 50;
+  o->steps = 16;
+  o->BH = 1.37;
+  o->tolerance = 0.00001;
+  o->gt = 50; o->ct = 10; o->tbg = 200;
+  o->kF = 0.6; o->HFmax = 40; o->LAIFmax = 6.0; o->intF = 3.4; o->slopeF = -5.5;
+  o->errbound = 1e-6;
+  o->thin = 1;
+  snprintf(o->output, sizeof(o->output), "-");
+  setval(&o->parmax, "2060", "parmax");
+  for (k = 0; k < GF_NDOUBLE; k++) o->fields[k] = 1;
+  // gammaw, drinit and drcrit as set by runacgca(), rhomin follows rho
+  species_parms("acru", v);
+  for (k = 33; k < NSPARMS; k++){
+    o->sp[k].v = malloc(sizeof(double));
+    o->sp[k].v[0] = v[k];
+    o->sp[k].len = 1;
+    o->sp[k].set = 1;
+  }
+}
+
+/// Gap forcing as computed by HcLAIFcalc() in R.
+static void gapforcing(cfgopts *o, double *Hc, double *LAIF, int n){
+  int per = o->tbg*o->steps, open = o->gt*o->steps, ramp = o->steps*o->ct;
+  double byH = o->HFmax/(o->steps*o->ct), byL = o->LAIFmax/(o->steps*o->ct);
+  int i, k;
+
+  if (o->tbg - (o->gt + o->ct) < 0){
+    die("the closed period of the gap cycle is negative", NULL);
+  }
+  for (i = 0; i < n; i++){
+    k = i % per;
+    if (k < open){
+      Hc[i] = 0;
+      LAIF[i] = 0;
+    }
+    else if (k < open + ramp){
+      // seq(by, max, by) in R
+      Hc[i] = byH + (k - open)*byH;
+      LAIF[i] = byL + (k - open)*byL;
+    }
+    else{
+      Hc[i] = o->HFmax;
+      LAIF[i] = o->LAIFmax;
+    }
+  }
+}
+
+/// \brief One run: parameter values that differ from the config.
+typedef struct{
+  int runid;
+  double r0;
+  double vals[MAXCOLS];
+} runspec;
+
+// Reads the batch file.  Returns the number of runs and sets the column keys.
+static int readbatch(const char *file, char keys[MAXCOLS][64], int *ncol,
+  runspec **runs){
+  FILE *fp = fopen(file, "r");
+  char *line = malloc(MAXLINE), *tok;
+  int nrun = 0, cap = 64, c;
+
+  if (fp == NULL){
+    die("could not open", file);
+  }
+  if (fgets(line, MAXLINE, fp) == NULL){
+    die("empty batch file", file);
+  }
+  *ncol = 0;
+  for (tok = strtok(line, ",\n\r"); tok != NULL; tok = strtok(NULL, ",\n\r")){
+    if (*ncol == MAXCOLS){
+      die("too many columns in", file);
+    }
+    snprintf(keys[(*ncol)++], 64, "%s", trim(tok));
+  }
+  *runs = malloc(cap*sizeof(runspec));
+  while (fgets(line, MAXLINE, fp) != NULL){
+    if (*trim(line) == '\0'){
+      continue;
+    }
+    if (nrun == cap){
+      cap *= 2;
+      *runs = realloc(*runs, cap*sizeof(runspec));
+    }
+    for (c = 0, tok = strtok(line, ",\n\r"); tok != NULL && c < *ncol;
+      tok = strtok(NULL, ",\n\r"), c++){
+      (*runs)[nrun].vals[c] = todouble(trim(tok), keys[c]);
+    }
+    if (c != *ncol){
+      die("wrong number of values in a row of", file);
+    }
+    nrun++;
+  }
+  fclose(fp);
+  free(line);
+  return nrun;
+}
+
+// Writes the rows of one run to a csv file (all steps*years+1 rows as
+// runacgca() returns them, zero after the tree died).
+static void writecsv(FILE *fp, cfgopts *o, int runid, goutput *out, int n){
+  int i, k;
+  for (i = 0; i < n; i++){
+    if (o->thin && (i % o->steps) != 0){
+      continue;
+    }
+    fprintf(fp, "%d,%d", runid, i);
+    for (k = 0; k < GF_NDOUBLE; k++){
+      if (!o->fields[k]) continue;
+      // single precision outputs with the 9 digits that identify a float
+      if (out->v[k] != NULL) fprintf(fp, ",%.17g", out->v[k][i]);
+      else fprintf(fp, ",%.9g", out->f[k][i]);
+    }
+    for (k = 0; k < GI_NINT; k++){
+      fprintf(fp, ",%d", out->iv[k][i]);
+    }
+    fprintf(fp, "\n");
+  }
+}
+
+// Runs the steps of a replay file again and writes them as csv.
+static void replayfile(cfgopts *o){
+  gflightrec rec;
+  gparms gp;
+  Forestparms fp;
+  gcheckpoint ck;
+  goutput out;
+  double v[GF_NDOUBLE];
+  int iv[GI_NINT], k, m, match, nf;
+  FILE *csv;
+
+  if (flightrec_read(o->replay, &gp, &fp, &rec) != 0){
+    die("could not read replay file", o->replay);
+  }
+  csv = (strcmp(o->output, "-") == 0) ? stdout : fopen(o->output, "w");
+  if (csv == NULL){
+    die("could not open", o->output);
+  }
+  fprintf(csv, "frame,index,match");
+  for (k = 0; k < GF_NDOUBLE; k++){
+    if (o->fields[k]) fprintf(csv, ",%s", gfield_names[k]);
+  }
+  for (k = 0; k < GI_NINT; k++){
+    fprintf(csv, ",%s", gifield_names[k]);
+  }
+  fprintf(csv, "\n");
+
+  memset(&out, 0, sizeof(goutput));
+  for (k = 0; k < GF_NDOUBLE; k++) out.v[k] = &v[k];
+  for (k = 0; k < GI_NINT; k++) out.iv[k] = &iv[k];
+  nf = flightrec_count(&rec);
+  for (m = 0; m < nf; m++){
+    memset(v, 0, sizeof(v));
+    memset(iv, 0, sizeof(iv));
+    match = flightrec_replay(&gp, &fp, &rec, m, &ck, &out);
+    fprintf(csv, "%d,%d,%d", m, flightrec_frame(&rec, m)->j, match);
+    for (k = 0; k < GF_NDOUBLE; k++){
+      if (o->fields[k]) fprintf(csv, ",%.17g", v[k]);
+    }
+    for (k = 0; k < GI_NINT; k++){
+      fprintf(csv, ",%d", iv[k]);
+    }
+    fprintf(csv, "\n");
+  }
+  if (csv != stdout){
+    fclose(csv);
+  }
+  free(rec.frame);
+}
+
+// Writes the hardware counts of all runs and, if the branches are profiled,
+// of each branch (counts since calls0 and bhw0).
+static void perfreport(FILE *fp, int avail, double *hw, double steps,
+  double *calls0, double *bhw0){
+  double calls[GP_NBRANCH], ticks[GP_NBRANCH], trans[GP_NSTATE*GP_NSTATE];
+  double bhw[GP_NBRANCH*GPERF_N];
+  int j, k;
+
+  fprintf(fp, "%-20s %16s %14s\n", "counter", "total", "per step");
+  for (k = 0; k < GPERF_N; k++){
+    if (avail & (1 << k)){
+      fprintf(fp, "%-20s %16.0f %14.1f\n", gperf_names[k], hw[k],
+        hw[k]/((steps > 0) ? steps : 1));
+    }
+    else{
+      fprintf(fp, "%-20s %16s %14s\n", gperf_names[k], "NA", "NA");
+    }
+  }
+  if (avail == 0){
+    fprintf(fp, "hardware counters not available (perf_event_open)\n");
+  }
+  gprof_read(calls, ticks, trans);
+  if (!gprof_readhw(bhw)){
+    return;
+  }
+  fprintf(fp, "\n%-20s %12s", "branch", "calls");
+  for (k = 0; k < GPERF_N; k++){
+    fprintf(fp, " %14s", gperf_names[k]);
+  }
+  fprintf(fp, "\n");
+  for (j = 0; j < GP_NBRANCH; j++){
+    fprintf(fp, "%-20s %12.0f", gprof_names[j], calls[j] - calls0[j]);
+    for (k = 0; k < GPERF_N; k++){
+      if (avail & (1 << k)){
+        fprintf(fp, " %14.0f", bhw[j*GPERF_N + k] - bhw0[j*GPERF_N + k]);
+      }
+      else{
+        fprintf(fp, " %14s", "NA");
+      }
+    }
+    fprintf(fp, "\n");
+  }
+}
+
+int main(int argc, char **argv){
+  cfgopts o;
+  FILE *fp, *csv = NULL;
+  char *line;
+  char keys[MAXCOLS][64];
+  int colk[MAXCOLS];
+  int ncol = 0, nrun, n, nsteps, i, k, err = 0;
+  int rhominfree;  // rhomin follows rho, also a batch column of rho
+  runspec *runs = NULL;
+  gcheckpoint ckin;
+  rstore rs;
+  gparms gp;
+  Forestparms ForParms;
+  double *Hc, *LAIF;
+  double hwtot[GPERF_N] = {0}, hwsteps = 0;
+  double calls0[GP_NBRANCH], ticks0[GP_NBRANCH], trans0[GP_NSTATE*GP_NSTATE];
+  double bhw0[GP_NBRANCH*GPERF_N];
+  int hwavail = (1 << GPERF_N) - 1;
+
+  if (argc < 2){
+    fprintf(stderr, "usage: acgcasim config [key=value ...]\n");
+    return 1;
+  }
+
+  defaults(&o);
+  line = malloc(MAXLINE);
+  if (strcmp(argv[1], "-") != 0){
+    fp = fopen(argv[1], "r");
+    if (fp == NULL){
+      die("could not open", argv[1]);
+    }
+    while (fgets(line, MAXLINE, fp) != NULL){
+      parseline(&o, line);
+    }
+    fclose(fp);
+  }
+  for (i = 2; i < argc; i++){
+    snprintf(line, MAXLINE, "%s", argv[i]);
+    parseline(&o, line);
+  }
+  free(line);
+
+  if (o.replay[0] != '\0'){
+    replayfile(&o);
+    return 0;
+  }
+
+  // Check the inputs as runacgca() does
+  n = o.steps*o.years + 1;
+  rhominfree = !o.sp[32].set;
+  for (k = 0; k < NSPARMS; k++){
+    if (k == 32 && !o.sp[k].set){
+      o.sp[k] = o.sp[6];  // rhomin = rho
+    }
+    if (!o.sp[k].set){
+      die("missing species parameter", sparms_names[k]);
+    }
+    if (o.sp[k].len != 1 && o.sp[k].len != n){
+      die("time varying parameters need steps*years+1 values:", sparms_names[k]);
+    }
+  }
+  if (o.parmax.len == 1){
+    double v = o.parmax.v[0];
+    o.parmax.v = realloc(o.parmax.v, n*sizeof(double));
+    for (i = 0; i < n; i++) o.parmax.v[i] = v;
+    o.parmax.len = n;
+  }
+  else if (o.parmax.len != n){
+    die("parmax needs 1 or steps*years+1 values", NULL);
+  }
+
+  gp.deltat = 1.0/o.steps;
+  gp.T = o.years;
+  gp.tolerance = o.tolerance;
+  gp.BH = o.BH;
+  nsteps = (int)ceil(gp.T/gp.deltat);
+
+  ForParms.kF = o.kF;
+  ForParms.intF = o.intF;
+  ForParms.slopeF = o.slopeF;
+
+  Hc = malloc(n*sizeof(double));
+  LAIF = malloc(n*sizeof(double));
+  if (o.gapsim){
+    gapforcing(&o, Hc, LAIF, n);
+  }
+  else{
+    for (i = 0; i < n; i++){
+      Hc[i] = -99;
+      LAIF[i] = 0;
+    }
+  }
+
+  if (o.restart[0] != '\0'){
+    if ((err = checkpoint_read(o.restart, &ckin)) != 0){
+      die("could not read checkpoint", o.restart);
+    }
+    if (fabs(ckin.deltat - gp.deltat) > 1e-12){
+      die("the checkpoint was simulated with a different number of steps:", o.restart);
+    }
+  }
+
+  // Runs
+  if (o.batch[0] != '\0'){
+    nrun = readbatch(o.batch, keys, &ncol, &runs);
+    for (k = 0; k < ncol; k++){
+      colk[k] = sparms_index(keys[k]);
+      if (colk[k] == 32) rhominfree = 0;
+      if (colk[k] < 0 && strcmp(keys[k], "r0") != 0 &&
+        strcmp(keys[k], "parmax") != 0 && strcmp(keys[k], "runid") != 0){
+        die("unknown batch column", keys[k]);
+      }
+    }
+  }
+  else{
+    nrun = 1;
+    runs = malloc(sizeof(runspec));
+  }
+  for (i = 0; i < nrun; i++){
+    runs[i].runid = o.runid + i;
+    runs[i].r0 = o.r0;
+    for (k = 0; k < ncol; k++){
+      if (strcmp(keys[k], "runid") == 0) runs[i].runid = (int)runs[i].vals[k];
+      if (strcmp(keys[k], "r0") == 0) runs[i].r0 = runs[i].vals[k];
+    }
+  }
+  if (nrun > 1 && o.savestate[0] != '\0' && strstr(o.savestate, "%d") == NULL){
+    die("savestate needs %d (the run id) for batches", NULL);
+  }
+  if (o.recorder > 0 && o.recfile[0] == '\0'){
+    die("the recorder needs a recfile", NULL);
+  }
+  if (nrun > 1 && o.recorder > 0 && strstr(o.recfile, "%d") == NULL){
+    die("recfile needs %d (the run id) for batches", NULL);
+  }
+
+  // Output
+  if (o.format == 1){
+    goutput sel;
+    memset(&sel, 0, sizeof(goutput));
+    for (k = 0; k < GF_NDOUBLE; k++) if (o.fields[k]) sel.v[k] = Hc;
+    for (k = 0; k < GI_NINT; k++) sel.iv[k] = (int *)Hc;
+    if (strcmp(o.output, "-") == 0){
+      die("the result store needs an output file", NULL);
+    }
+    if ((err = rstore_open(&rs, o.output, n, &sel, o.encoding, o.errbound)) != 0){
+      die("could not open the result store", o.output);
+    }
+  }
+  else{
+    csv = (strcmp(o.output, "-") == 0) ? stdout : fopen(o.output, "w");
+    if (csv == NULL){
+      die("could not open", o.output);
+    }
+    fprintf(csv, "run,index");
+    for (k = 0; k < GF_NDOUBLE; k++){
+      if (o.fields[k]) fprintf(csv, ",%s", gfield_names[k]);
+    }
+    for (k = 0; k < GI_NINT; k++){
+      fprintf(csv, ",%s", gifield_names[k]);
+    }
+    fprintf(csv, "\n");
+  }
+
+  if (o.profile){
+    gprof_read(calls0, ticks0, trans0);
+    gprof_readhw(bhw0);
+  }
+
+#ifdef _OPENMP
+  if (o.threads > 0){
+    omp_set_num_threads(o.threads);
+  }
+  #pragma omp parallel for schedule(dynamic) ordered reduction(|:err)
+#endif
+  for (i = 0; i < nrun; i++){
+    int j, c, t, totlen = 0, start[NSPARMS], plen[NSPARMS];
+    double *sparms2, *Io = o.parmax.v;
+    sparms p;
+    pschedule ps;
+    gforcing forc;
+    goutput out;
+    gcheckpoint ck;
+    gflightrec rec;
+    unsigned long long hw0[GPERF_N], hw1[GPERF_N];
+    int avail = 0, h, nd = 0, nf = 0;
+    double *dbuf;
+    float *fbuf;
+    int *ibuf = calloc((size_t)GI_NINT*n, sizeof(int));
+
+    // With precision = mixed the outputs of gfield_single are kept as float
+    memset(&out, 0, sizeof(goutput));
+    for (k = 0; k < GF_NDOUBLE; k++){
+      if (o.mixed && gfield_single[k]) nf++;
+      else nd++;
+    }
+    dbuf = calloc((size_t)nd*n, sizeof(double));
+    fbuf = calloc((size_t)((nf > 0) ? nf : 1)*n, sizeof(float));
+    for (k = 0, nd = 0, nf = 0; k < GF_NDOUBLE; k++){
+      if (o.mixed && gfield_single[k]) out.f[k] = fbuf + (size_t)(nf++)*n;
+      else out.v[k] = dbuf + (size_t)(nd++)*n;
+    }
+
+    // Pack the parameters of this run (batch columns replace the config)
+    for (k = 0; k < NSPARMS; k++){
+      plen[k] = o.sp[k].len;
+      for (c = 0; c < ncol; c++){
+        if (colk[c] == k || (k == 32 && colk[c] == 6 && rhominfree)) plen[k] = 1;
+      }
+      start[k] = totlen;
+      totlen += plen[k];
+    }
+    sparms2 = malloc(totlen*sizeof(double));
+    for (k = 0; k < NSPARMS; k++){
+      memcpy(sparms2 + start[k], o.sp[k].v, plen[k]*sizeof(double));
+      for (c = 0; c < ncol; c++){
+        if (colk[c] == k || (k == 32 && colk[c] == 6 && rhominfree)){
+          sparms2[start[k]] = runs[i].vals[c];
+        }
+      }
+    }
+    for (c = 0; c < ncol; c++){
+      if (strcmp(keys[c], "parmax") == 0){
+        Io = malloc(n*sizeof(double));
+        for (j = 0; j < n; j++) Io[j] = runs[i].vals[c];
+      }
+    }
+    growthloop_unpack(sparms2, start, plen, &p, &ps);
+
+    forc.Io = Io;
+    forc.Hc = Hc;
+    forc.LAIF = LAIF;
+    forc.ForParms = &ForParms;
+    forc.drref = NULL;
+    for (k = 0; k < GI_NINT; k++) out.iv[k] = ibuf + (size_t)k*n;
+    if (o.recorder > 0){
+      growthloop_recinit(&rec, malloc(o.recorder*sizeof(gframe)), o.recorder);
+      out.fr = &rec;
+    }
+
+    if (o.profile){
+      avail = gprof_hwstart();
+      gprof_hwnow(hw0);
+    }
+    if (o.restart[0] != '\0'){
+      ck = ckin;
+      t = growthloop_resume(&p, &gp, &ck, &ps, &forc, &out, nsteps);
+    }
+    else{
+      growthloop_init(&p, &gp, &runs[i].r0, &ck);
+      growthloop_store(&ck, &gp, &out, 0);
+      out.v[GF_APAR][0] = 0;
+      out.iv[GI_growth_st][0] = 0;
+      if (nsteps > 0){
+        out.v[GF_r][1] = out.v[GF_r][0];
+        out.v[GF_h][1] = out.v[GF_h][0];
+        out.v[GF_rBH][1] = out.v[GF_rBH][0];
+      }
+      t = growthloop_run(&gp, &ck, &ps, &forc, &out, nsteps);
+    }
+    if (o.profile){
+      gprof_hwnow(hw1);
+#ifdef _OPENMP
+      #pragma omp critical
+#endif
+      {
+        for (h = 0; h < GPERF_N; h++) hwtot[h] += (double)(hw1[h] - hw0[h]);
+        hwsteps += t;
+        hwavail &= avail;
+      }
+    }
+
+    if (o.savestate[0] != '\0'){
+      char file[1100];
+      snprintf(file, sizeof(file), o.savestate, runs[i].runid);
+      err |= (checkpoint_write(file, &ck) != 0);
+    }
+    if (out.fr != NULL){
+      if (rec.fail >= 0){
+        char file[1100];
+        snprintf(file, sizeof(file), o.recfile, runs[i].runid);
+        err |= (flightrec_write(file, &gp, &ForParms, &rec) != 0);
+      }
+      free(rec.frame);
+    }
+    if (o.format == 1){
+      err |= rstore_append(&rs, runs[i].runid, t + 1, &out);
+    }
+#ifdef _OPENMP
+    #pragma omp ordered
+#endif
+    if (o.format == 0){
+      writecsv(csv, &o, runs[i].runid, &out, n);
+    }
+
+    if (Io != o.parmax.v) free(Io);
+    free(sparms2);
+    free(dbuf);
+    free(fbuf);
+    free(ibuf);
+  }
+
+  if (o.format == 1){
+    rstore_close(&rs);
+  }
+  else if (csv != stdout){
+    fclose(csv);
+  }
+  if (o.profile){
+    perfreport(stderr, hwavail, hwtot, hwsteps, calls0, bhw0);
+  }
+  if (err){
+    die("could not write all outputs", NULL);
+  }
+  return 0;
+}
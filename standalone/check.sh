@@ -0,0 +1,276 @@
+#!/bin/sh
+# Golden trajectory and timing checks of the growth model, run with acgcasim.
+# The scenarios, golden outputs and tolerances are shared with the testthat
+# tests of the R package (../ACGCA/tests/testthat/golden).
+#
+#   ./check.sh check     runs each scenario of scenarios.csv and compares its
+#                        outputs with the golden file, variable by variable,
+#                        using the tolerances of tolerance.csv, and checks
+#                        that runs set up in different ways agree exactly
+#                        (see consistency)
+#   ./check.sh bench     times the benchmarks of bench.csv (median of
+#                        BENCH_REPS=5 repetitions) and fails if one is more
+#                        than BENCH_SLOWDOWN=20 percent slower than its
+#                        baseline in bench_baseline.csv
+#   ./check.sh record    rewrites the golden outputs after an intended change
+#                        of the model (except the legacy reference
+#                        testrout_highres_dt32.csv)
+#   ./check.sh baseline  records the timing baselines of this machine
+#
+# check.sh bench is the slowdown check of the model; the R tests do not
+# time anything.  The committed bench_baseline.csv was recorded with gcc 12.2
+# (makefile flags) on one core of an Intel Xeon; record new baselines with
+# ./check.sh baseline before benchmarking on another machine.
+#
+# PRECISION=mixed runs the scenarios with precision = mixed (float storage
+# of the outputs of gfield_single).  PRECISION=mixed ./check.sh check passes
+# with the tolerances of the double outputs.  Largest difference from
+# precision = double, relative to the largest value of the output:
+#
+#   scenario    worst float output   other outputs
+#   acru_open   deltas  5.9e-08      identical
+#   acru_gap    rfr     5.6e-08      identical
+#   pita_open   rfs     4.8e-08      identical
+#   pita_gap    la      5.2e-08      identical
+#
+# The model runs in double in both modes, so only the 14 float outputs
+# (sa, la, ra, xa, fl, fr, ft, fo, rfl, rfr, rfs, nut, deltas, LAI) differ.
+# Mixed precision is only available in acgcasim; runacgca() in R has no
+# precision option and always stores doubles.
+#
+# Exits with 1 if a check fails.
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+SIM=${SIM:-$here/acgcasim}
+GOLDEN=${GOLDEN:-$here/../ACGCA/tests/testthat/golden}
+BASELINE=${BASELINE:-$here/bench_baseline.csv}
+REPS=${BENCH_REPS:-5}
+SLOWDOWN=${BENCH_SLOWDOWN:-20}
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# Prints column $2 of scenario $1 (or of benchmark $1 with $3 = bench.csv).
+column(){
+  awk -F, -v s="$1" -v col="$2" '
+    NR == 1 { for (i = 1; i <= NF; i++) c[$i] = i; next }
+    $1 == s { print $c[col]; found = 1; exit }
+    END { exit !found }' "$GOLDEN/${3:-scenarios.csv}"
+}
+
+# Prints the acgcasim settings of scenario $1.
+settings(){
+  for key in species gapsim gt ct tbg years steps parmax r0 thin; do
+    printf '%s=%s ' "$key" "$(column "$1" "$key")"
+  done
+  printf 'precision=%s ' "${PRECISION:-double}"
+}
+
+scenarios(){
+  awk -F, 'NR > 1 && $1 != "" { print $1 }' "$GOLDEN/$1"
+}
+
+# Runs scenario $1 with all output fields and writes the csv to $2.
+runscenario(){
+  "$SIM" - $(settings "$1") fields=all threads=1 output="$2"
+}
+
+# Compares the outputs $2 of scenario $1 with its golden file.  A value
+# passes if it is within atol + rtol*max|golden| of the golden value, the
+# maximum taken over the variable (column).
+compare(){
+  awk -F, -v scen="$1" -v fields="$(column "$1" fields)" '
+    function unq(x){ gsub(/"/, "", x); return x }
+    function abs(x){ return (x < 0) ? -x : x }
+    FNR == 1 { file++ }
+    file == 1 && FNR > 1 { rtol[$1, $2] = $3; atol[$1, $2] = $4; next }
+    file == 2 {
+      if (FNR == 1){
+        # R vectors written with write.csv: row names and a column "x"
+        skip = (unq($1) == "") ? 1 : 0
+        for (i = 1 + skip; i <= NF; i++){
+          v = unq($i)
+          gname[i - skip] = (v == "x" && NF - skip == 1) ? fields : v
+        }
+        ng = NF - skip
+        next
+      }
+      ngr++
+      for (i = 1; i <= ng; i++) g[ngr, i] = $(i + skip)
+      next
+    }
+    file == 3 {
+      if (FNR == 1){
+        for (i = 1; i <= NF; i++) oc[$i] = i
+        next
+      }
+      nor++
+      for (i = 1; i <= ng; i++) o[nor, i] = $(oc[gname[i]])
+    }
+    END {
+      if (nor != ngr){
+        printf "  %s: %d rows, golden has %d\n", scen, nor, ngr
+        exit 1
+      }
+      bad = 0
+      for (i = 1; i <= ng; i++){
+        v = gname[i]
+        if (!(v in oc)){
+          printf "  %s: no output %s\n", scen, v
+          bad = 1
+          continue
+        }
+        # the most specific row of tolerance.csv
+        if ((scen, v) in rtol) { s = scen; w = v }
+        else if ((scen, "*") in rtol) { s = scen; w = "*" }
+        else if (("*", v) in rtol) { s = "*"; w = v }
+        else { s = "*"; w = "*" }
+        scale = 0
+        for (r = 1; r <= ngr; r++) if (abs(g[r, i]) > scale) scale = abs(g[r, i])
+        tol = atol[s, w] + rtol[s, w]*scale
+        nfail = 0; worst = 0; wrow = 0
+        for (r = 1; r <= ngr; r++){
+          d = abs(o[r, i] - g[r, i])
+          if (d > tol){
+            nfail++
+            if (d > worst){ worst = d; wrow = r }
+          }
+        }
+        if (nfail > 0){
+          printf "  %s: %s differs in %d rows, worst row %d: %.10g (golden %.10g, tolerance %g)\n",
+            scen, v, nfail, wrow, o[wrow, i], g[wrow, i], tol
+          bad = 1
+        }
+      }
+      exit bad
+    }' "$GOLDEN/tolerance.csv" "$GOLDEN/$(column "$1" golden)" "$2"
+}
+
+# Writes the outputs $2 of scenario $1 as its golden file.
+record(){
+  awk -F, -v fields="$(column "$1" fields)" '
+    NR == 1 {
+      for (i = 3; i <= NF; i++) if (fields == "all" || $i == fields) keep[++n] = i
+    }
+    {
+      for (k = 1; k <= n; k++){
+        v = $(keep[k])
+        if (NR > 1) v = sprintf("%.10g", v)
+        printf "%s%s", v, (k < n) ? "," : "\n"
+      }
+    }' "$2" > "$GOLDEN/$(column "$1" golden)"
+}
+
+# Compares the outputs $2 and $3 of check $1 exactly, ignoring the run id.
+same(){
+  cut -d, -f2- "$2" > "$tmp/same1.csv"
+  cut -d, -f2- "$3" > "$tmp/same2.csv"
+  if cmp -s "$tmp/same1.csv" "$tmp/same2.csv"; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1"
+    status=1
+  fi
+}
+
+# Runs that must give identical outputs although they are set up in
+# different ways.
+consistency(){
+  run="$SIM - species=acru years=30 fields=all threads=1"
+
+  # a batch column of rho also sets rhomin, as rho does in the config
+  printf 'runid,rho\n1,300000\n' > "$tmp/batch.csv"
+  $run batch="$tmp/batch.csv" output="$tmp/a.csv"
+  $run rho=300000 output="$tmp/b.csv"
+  same batch_rho "$tmp/a.csv" "$tmp/b.csv"
+
+  # a run saved after 10 years and restarted for 20 continues the 30 year
+  # run bit for bit.  parmax varies with the step, the restarted run reads
+  # it from the checkpoint step on.  The first row of the restarted run is
+  # the saved state (with growth_st 0, as at a start) and is not compared.
+  awk 'BEGIN { for (i = 0; i <= 480; i++) printf "%.6f\n", 2060 + 300*sin(i/7) }' > "$tmp/parmax"
+  head -n 161 "$tmp/parmax" > "$tmp/parmax1"
+  tail -n +161 "$tmp/parmax" > "$tmp/parmax2"
+  $run thin=FALSE years=30 parmax=@"$tmp/parmax" output="$tmp/a.csv"
+  $run thin=FALSE years=10 parmax=@"$tmp/parmax1" savestate="$tmp/ck.bin" output=/dev/null
+  $run thin=FALSE years=20 parmax=@"$tmp/parmax2" restart="$tmp/ck.bin" output="$tmp/b.csv"
+  awk -F, -v OFS=, 'NR == 1 || $2 > 160 { if (NR > 1) $2 -= 160; print }' "$tmp/a.csv" > "$tmp/a2.csv"
+  awk -F, 'NR == 1 || $2 > 0' "$tmp/b.csv" > "$tmp/b2.csv"
+  same restart "$tmp/a2.csv" "$tmp/b2.csv"
+}
+
+# Prints the median time in seconds of REPS runs of benchmark $1.
+timebench(){
+  scen=$(column "$1" scenario bench.csv)
+  runs=$(column "$1" runs bench.csv)
+  awk -v n="$runs" 'BEGIN { print "runid"; for (i = 1; i <= n; i++) print i }' > "$tmp/batch.csv"
+  for rep in $(seq "$REPS"); do
+    t0=$(date +%s%N)
+    "$SIM" - $(settings "$scen") fields=r threads=1 batch="$tmp/batch.csv" output=/dev/null
+    t1=$(date +%s%N)
+    echo $((t1 - t0))
+  done | sort -n | awk '{ t[NR] = $1 } END { printf "%.4f\n", t[int((NR + 1)/2)]/1e9 }'
+}
+
+status=0
+case "${1:-check}" in
+  check)
+    for s in $(scenarios scenarios.csv); do
+      runscenario "$s" "$tmp/out.csv"
+      if compare "$s" "$tmp/out.csv"; then
+        echo "ok   $s"
+      else
+        echo "FAIL $s"
+        status=1
+      fi
+    done
+    consistency
+    ;;
+  record)
+    for s in $(scenarios scenarios.csv); do
+      if [ "$(column "$s" golden)" = testrout_highres_dt32.csv ]; then
+        continue
+      fi
+      runscenario "$s" "$tmp/out.csv"
+      record "$s" "$tmp/out.csv"
+      echo "recorded $s"
+    done
+    ;;
+  bench)
+    if [ ! -f "$BASELINE" ]; then
+      echo "no baselines in $BASELINE, record them with ./check.sh baseline"
+      exit 1
+    fi
+    for b in $(scenarios bench.csv); do
+      t=$(timebench "$b")
+      base=$(awk -F, -v b="$b" '$1 == b { print $2 }' "$BASELINE")
+      if [ -z "$base" ]; then
+        echo "---- $b ${t}s (no baseline)"
+        continue
+      fi
+      if awk -v t="$t" -v b="$base" -v x="$SLOWDOWN" 'BEGIN { exit !(t <= b*(1 + x/100)) }'; then
+        echo "ok   $b ${t}s (baseline ${base}s)"
+      else
+        echo "FAIL $b ${t}s, more than $SLOWDOWN% slower than the baseline ${base}s"
+        status=1
+      fi
+    done
+    ;;
+  baseline)
+    echo "name,seconds" > "$tmp/baseline.csv"
+    for b in $(scenarios bench.csv); do
+      t=$(timebench "$b")
+      echo "$b,$t" >> "$tmp/baseline.csv"
+      echo "$b ${t}s"
+    done
+    cp "$tmp/baseline.csv" "$BASELINE"
+    ;;
+  *)
+    echo "usage: $0 [check|bench|record|baseline]" >&2
+    exit 2
+    ;;
+esac
+
+exit $status